@@ -19,9 +19,24 @@ Author: Antonako1
 #include <string>
 #include <vector>
 #include <cstdint>
-#include <iostream>
+#include <cassert>
+#include <iosfwd>
 #include <algorithm>
-#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <memory>
+#include <functional>
+#include <limits>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <new>
+
+// Build modes. By default the header is self-contained: it includes the implementation, Arghand.inl,
+// and every function is inline. Define ARGHAND_SEPARATE_COMPILATION everywhere to leave the implementation
+// out of the header and compile it once, from src/Arghand.cpp. The header then holds the declarations and
+// the small inline accessors only, and pulls in neither iostreams, SIMD intrinsics nor platform headers.
 
 /// Converts enum class to uint64_t
 template<typename E>
@@ -38,6 +53,11 @@ enum class CmdOptionFlags : uint64_t {
     IsHelpOption =      0x00000080,     // Option is a help option. Logs help information and returns from parser with a custom status.
     IsVersionOption =   0x00000100,     // Option is a version option. Logs version information and returns from parser with a custom status.
     IsRequired =       0x00000200,      // Option is required. Will help with help message auto generation and parsing.
+    IsInteger =         0x00000400,     // Values are 64-bit integers, converted and checked during the parse (see Arghand::Get)
+    IsDouble =          0x00000800,     // Values are doubles, converted and checked during the parse
+    IsBoolean =         0x00001000,     // Values are booleans ("true", "1", "yes", "on", ...), a flag without a value is true when given
+    IsEnum =            0x00002000,     // Values are one of the allowed names, stored as their index
+    IsPositional =      0x00004000,     // Positional slot named by long_name, see PositionalDefault
 };
 
 // Convenience defines for common command option flags
@@ -46,6 +66,14 @@ enum class CmdOptionFlags : uint64_t {
 #define NoInputDefault QSTU64(CmdOptionFlags::None)
 #define InputDefault QSTU64(CmdOptionFlags::IsValueRequired) | QSTU64(CmdOptionFlags::IsRequired)
 #define ListInputDefault QSTU64(CmdOptionFlags::IsList) | QSTU64(CmdOptionFlags::IsRequired)
+// Positional slots take the positional arguments in declaration order and are queried by their long name.
+// A required slot without a default value must be given. An IsList slot is the tail: it takes all positional
+// arguments after the other slots, one value each. A typed tail converts every one of them like any typed value.
+// The parse keeps the tail as views over the arguments, GetValue/GetValues copy it on their first call.
+// Without a tail, positional arguments beyond the slots are an error.
+// Usage: CMD_OPTION("", "source", PositionalDefault, "", "Source file"), CMD_OPTION("", "files", PositionalListDefault, "", "Input files")
+#define PositionalDefault QSTU64(CmdOptionFlags::IsPositional) | QSTU64(CmdOptionFlags::IsRequired)
+#define PositionalListDefault QSTU64(CmdOptionFlags::IsPositional) | QSTU64(CmdOptionFlags::IsList)
 
 // Command option structure
 typedef struct _CMD_Option {
@@ -55,12 +83,84 @@ typedef struct _CMD_Option {
     uint64_t options;       // Flags for the option (e.g., IsValueRequired, IsList, IsHelpOption)
     std::string DefaultValue; // Default value for the option if not provided
     std::string description;  // Description of the option for help messages
+    std::string environment;  // Environment variable used when the option is not on the command line, or empty
+    std::string configKey;    // Config file key ("key" or "section.key") used when neither is set, or empty
+    std::string allowed;      // Allowed values of a typed option: "a|b|c" for IsEnum, "min..max" (either bound optional) for IsInteger and IsDouble
 } CmdOption, *PCmdOption;
 
 // Macro to define a command option with short and long names, flags, default value, and description
 // Usage: CMD_OPTION("h", "help", HelpOptionDefault, "", "Display help
 #define CMD_OPTION(short_name, long_name, flags, defaultValue, description) \
-    { short_name, long_name, std::string(short_name) + "," + std::string(long_name), flags, defaultValue, description }
+    { short_name, long_name, std::string(short_name) + "," + std::string(long_name), flags, defaultValue, description, "", "", "" }
+
+// Macro to define a command option that falls back to an environment variable and a config file key,
+// in this order, before its default value. Either may be "" to skip that source.
+// Usage: CMD_OPTION_BOUND("o", "output", InputDefault, "out.txt", "Output file", "APP_OUTPUT", "paths.output")
+#define CMD_OPTION_BOUND(short_name, long_name, flags, defaultValue, description, environment, configKey) \
+    { short_name, long_name, std::string(short_name) + "," + std::string(long_name), flags, defaultValue, description, environment, configKey, "" }
+
+// Macro to define a typed option (IsInteger, IsDouble, IsBoolean or IsEnum in flags) with its allowed values.
+// Usage: CMD_OPTION_TYPED("m", "mode", InputDefault | QSTU64(CmdOptionFlags::IsEnum), "fast", "Mode", "fast|safe|off")
+//        CMD_OPTION_TYPED("j", "jobs", InputDefault | QSTU64(CmdOptionFlags::IsInteger), "4", "Jobs", "1..64")
+#define CMD_OPTION_TYPED(short_name, long_name, flags, defaultValue, description, allowed) \
+    { short_name, long_name, std::string(short_name) + "," + std::string(long_name), flags, defaultValue, description, "", "", allowed }
+
+// Command option structure for compile-time option tables (see Arghand::Static).
+// All fields are plain string literals so a table of these can be constexpr and needs no heap.
+typedef struct StaticCmdOption {
+    const char* short_name;     // Short name of the option (e.g., "h")
+    const char* long_name;      // Long name of the option (e.g., "help")
+    uint64_t options;           // Flags for the option (e.g., IsValueRequired, IsList, IsHelpOption)
+    const char* DefaultValue;   // Default value for the option if not provided
+    const char* description;    // Description of the option for help messages
+} StaticCmdOption, *PStaticCmdOption;
+
+// Macro to define a compile-time command option, same arguments as CMD_OPTION
+// Usage: static constexpr StaticCmdOption table[] = { STATIC_CMD_OPTION("o", "output", InputDefault, "out.txt", "Output file") };
+#define STATIC_CMD_OPTION(short_name, long_name, flags, defaultValue, description) \
+    { short_name, long_name, flags, defaultValue, description }
+
+/// Compile-time FNV-1a hash of a string, e.g. for switch labels over option names.
+constexpr uint32_t ArghandHash(const char* str, uint32_t hash = 2166136261u) {
+    return *str ? ArghandHash(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 16777619u) : hash;
+}
+
+/// Smallest power of two that is at least n.
+constexpr size_t ArghandNextPow2(size_t n, size_t p = 1) {
+    return p >= n ? p : ArghandNextPow2(n, p * 2);
+}
+
+/// Compile-time index sequence 0..N-1, for building constexpr arrays element by element.
+template<size_t... I> struct ArghandIndices {};
+template<typename Head, typename Tail> struct ArghandJoinIndices;
+template<size_t... Head, size_t... Tail>
+struct ArghandJoinIndices<ArghandIndices<Head...>, ArghandIndices<Tail...>> {
+    typedef ArghandIndices<Head..., (sizeof...(Head) + Tail)...> type;
+};
+// Halves N at each step so long tables stay far from the template depth limit
+template<size_t N> struct ArghandMakeIndices {
+    typedef typename ArghandJoinIndices<typename ArghandMakeIndices<N / 2>::type, typename ArghandMakeIndices<N - N / 2>::type>::type type;
+};
+template<> struct ArghandMakeIndices<0> { typedef ArghandIndices<> type; };
+template<> struct ArghandMakeIndices<1> { typedef ArghandIndices<0> type; };
+
+/// Finds the first c in [first, last), a whole vector of bytes at a time past the first 8.
+/// @return Pointer to the match, or last if there is none
+const char* ArghandFindCharBlocks(const char* first, const char* last, char c);
+
+/// Finds the first c in [first, last).
+/// @return Pointer to the match, or last if there is none
+inline const char* ArghandFindChar(const char* first, const char* last, char c) {
+    // Short elements are common, check a few bytes before paying for the vector setup
+    for (const char* head = first + std::min<ptrdiff_t>(last - first, 8); first != head; ++first) {
+        if (*first == c) return first;
+    }
+    return first == last ? last : ArghandFindCharBlocks(first, last, c);
+}
+
+/// Splits data on separator, appending the end offset of every element to ends.
+/// Element i spans [i ? ends[i - 1] + 1 : 0, ends[i]), the last end is always size. 4 bytes per element.
+void ArghandSplitOffsets(const char* data, size_t size, char separator, std::vector<uint32_t>& ends);
 
 // Parsed option structure
 typedef struct ParsedOption {
@@ -69,6 +169,143 @@ typedef struct ParsedOption {
     std::vector<std::string> values;
 } ParsedOption, *PParsedOption;
 
+// Non-owning view of a string, C++11 stand-in for std::string_view.
+// Used by the zero-copy accessors, points directly into argv or the option table.
+typedef struct ArgView {
+    const char* data;   // First character, not necessarily NUL-terminated
+    size_t size;        // Number of characters
+
+    ArgView() : data(""), size(0) {}
+    ArgView(const char* str) : data(str), size(std::strlen(str)) {}
+    ArgView(const char* str, size_t length) : data(str), size(length) {}
+    ArgView(const std::string& str) : data(str.data()), size(str.size()) {}
+
+    bool empty() const { return size == 0; }
+    const char* begin() const { return data; }
+    const char* end() const { return data + size; }
+    char operator[](size_t i) const { return data[i]; }
+
+    /// Checks if the view starts with the given prefix
+    bool StartsWith(const ArgView& prefix) const {
+        return size >= prefix.size && std::memcmp(data, prefix.data, prefix.size) == 0;
+    }
+    bool operator==(const ArgView& other) const {
+        return size == other.size && std::memcmp(data, other.data, size) == 0;
+    }
+    bool operator!=(const ArgView& other) const { return !(*this == other); }
+    /// Orders views bytewise, like std::string::compare
+    bool operator<(const ArgView& other) const {
+        int cmp = std::memcmp(data, other.data, std::min(size, other.size));
+        return cmp != 0 ? cmp < 0 : size < other.size;
+    }
+
+    /// Copies the viewed characters into a std::string
+    std::string str() const { return std::string(data, size); }
+} ArgView, *PArgView;
+
+template<typename CharT, typename Traits>
+inline std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const ArgView& view) {
+    return os.write(view.data, static_cast<std::ptrdiff_t>(view.size));
+}
+
+// Read-only range of views, e.g. the values of a list option
+typedef struct ArgViewList {
+    const ArgView* items;   // First view
+    size_t count;           // Number of views
+
+    ArgViewList() : items(nullptr), count(0) {}
+    ArgViewList(const ArgView* first, size_t length) : items(first), count(length) {}
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    const ArgView* begin() const { return items; }
+    const ArgView* end() const { return items + count; }
+    const ArgView& operator[](size_t i) const { return items[i]; }
+} ArgViewList, *PArgViewList;
+
+// Lazy view of a separated list, split while iterating without storing the elements.
+// Each step finds the next separator with a vectorized scan, so a full iteration is one pass over the value.
+// Iterating an empty value gives one empty element, like Arghand::ToList, a default constructed view gives none.
+// A view over several values, such as the positional arguments of a tail slot, walks them in turn in place.
+typedef struct ArgSplitView {
+    ArgView value;      // The unsplit value, the first one of several
+    ArgViewList more;   // The values after the first, split the same way
+    char separator;     // Character between elements
+    bool split;         // False to treat each value as a single element
+
+    ArgSplitView() : separator(','), split(true) {}
+    ArgSplitView(const ArgView& list, char sep, bool is_list = true) : value(list), separator(sep), split(is_list) {}
+    ArgSplitView(const ArgViewList& values, char sep, bool is_list = true) : separator(sep), split(is_list) {
+        if (values.empty()) return;
+        value = values[0];
+        more = ArgViewList(values.begin() + 1, values.size() - 1);
+    }
+
+    class iterator {
+    public:
+        iterator() : first(nullptr), stop(nullptr), last(nullptr), next(nullptr), nextEnd(nullptr), separator(0), split(true) {}
+        iterator(const ArgSplitView& view) : first(view.value.data), last(view.value.end()), next(view.more.begin()), nextEnd(view.more.end()),
+                                             separator(view.separator), split(view.split) {
+            stop = first ? Find(first) : nullptr;
+        }
+
+        ArgView operator*() const { return ArgView(first, static_cast<size_t>(stop - first)); }
+        iterator& operator++() {
+            if (stop == last && next != nextEnd) {
+                first = next->data ? next->data : "";
+                last = first + next->size;
+                ++next;
+                stop = Find(first);
+            } else if (stop == last) {
+                first = stop = nullptr;
+            } else {
+                first = stop + 1;
+                stop = Find(first);
+            }
+            return *this;
+        }
+        iterator operator++(int) { iterator old = *this; ++*this; return old; }
+        bool operator==(const iterator& other) const { return first == other.first; }
+        bool operator!=(const iterator& other) const { return first != other.first; }
+
+    private:
+        const char* Find(const char* from) const { return split ? ArghandFindChar(from, last, separator) : last; }
+
+        const char* first;  // Start of the current element, null at the end
+        const char* stop;   // End of the current element
+        const char* last;   // End of the value
+        const ArgView* next;    // Next of the further values
+        const ArgView* nextEnd;
+        char separator;
+        bool split;
+    };
+
+    iterator begin() const { return iterator(*this); }
+    iterator end() const { return iterator(); }
+    bool empty() const { return value.data == nullptr; }
+    /// Counts the elements, one pass over the values.
+    size_t size() const {
+        if (!value.data) return 0;
+        if (!split) return 1 + more.size();
+        size_t count = Count(value);
+        for (const ArgView& item : more) count += Count(item);
+        return count;
+    }
+    /// Appends the end offset of every element of the first value to ends, see ArghandSplitOffsets.
+    void Offsets(std::vector<uint32_t>& ends) const {
+        if (!value.data) return;
+        if (split) ArghandSplitOffsets(value.data, value.size, separator, ends);
+        else ends.push_back(static_cast<uint32_t>(value.size));
+    }
+
+private:
+    size_t Count(const ArgView& item) const {
+        size_t count = 1;
+        for (const char* c = item.begin(); (c = ArghandFindChar(c, item.end(), separator)) != item.end(); ++c) ++count;
+        return count;
+    }
+} ArgSplitView, *PArgSplitView;
+
 
 /// Parser options for the Arghand library.
 /// These options control the behavior of the argument parser and the whole argument handler.
@@ -83,6 +320,11 @@ enum class ParserOptions : uint64_t {
     HelpDisplayFooter = 0x00000080,     // Display footer in help output
     VersionDisplayFooter = 0x00000100,  // Display footer in version output
     HelpAutoGenerateArgumentUsageText = 0x00000200, // Automatically generate argument usage text in help output
+    ZeroCopy = 0x00000400,      // Keep parse results only as views into argv, see GetValueView/GetValuesView. argv must outlive the results
+    ResponseFiles = 0x00000800, // Expand @path arguments with the whitespace-separated, optionally quoted arguments in the file
+    LazyLists = 0x00001000,     // Keep list values unsplit while parsing, GetValues/GetValuesView then see one value. Split with GetListView
+    AllowAbbreviations = 0x00002000,    // Accept unambiguous prefixes of long option names, e.g. --out for --output
+    EndOfOptions = 0x00004000,  // A lone "--" ends the options, the arguments after it are positional and not matched. Opt-in, without it "--" is an unknown option
 
     // Display all help information
     HelpDisplayAll = QSTU64(HelpDisplayLicense) | QSTU64(HelpDisplayHeader) | QSTU64(HelpDisplayFooter) | QSTU64(HelpAutoGenerateArgumentUsageText),
@@ -93,8 +335,8 @@ enum class ParserOptions : uint64_t {
 
 // Helper function to convert enum class to underlying type
 template<typename Enum>
-constexpr auto to_underlying(Enum e) noexcept {
-    return static_cast<std::underlying_type_t<Enum>>(e);
+constexpr typename std::underlying_type<Enum>::type to_underlying(Enum e) noexcept {
+    return static_cast<typename std::underlying_type<Enum>::type>(e);
 }
 
 // Overloaded operators for ParserOptions to allow bitwise operations
@@ -112,12 +354,8 @@ inline ParserOptions operator~(ParserOptions e) {
 class Arghand {
 public:
     /// Default constructor
-    Arghand() {
-        SetParserOptions(ParserOptions::DefaultOptions);
-        SetSeparator(',');
-        this->args.clear();
-        this->cmdOptions.clear();
-        this->parsedOptions.clear();
+    Arghand() : ListSeparator(','), parserOptions(ParserOptions::DefaultOptions) {
+        RebuildSpec(std::vector<CmdOption>());
     }
     /// Destructor...
     ~Arghand() {}
@@ -131,391 +369,800 @@ public:
         SuccessWithVersion  // Parsing was successful and version was displayed
     };
 
-    /// Parses command-line arguments
-    /// @param argc Number of command-line arguments
-    /// @param argv Array of command-line arguments
-    /// @return ParseResult indicating the result of the parsing operation
-    ParseResult parse(int argc, char* argv[]) {
-        bool use_unix_style = (QSTU64(parserOptions) & QSTU64(ParserOptions::StyleUnix)) != 0;
-        bool ignore_case = (QSTU64(parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0;
+    /// Enum class for value conversion results
+    enum class ConvertResult {
+        Success,            // Conversion was successful
+        Empty,              // The value or a list element was empty
+        Invalid,            // The value is not in the expected format
+        OutOfRange          // The value does not fit the target type
+    };
 
-        std::string prefix_lng = use_unix_style ? "--" : "/";
-        std::string prefix_sht = use_unix_style ? "-" : "/";
+    /// Handle to an option, its index in the command options. Resolve it once with GetOptionId
+    /// and use it with the ID overloads below to skip the name lookup.
+    typedef int32_t OptionId;
 
-        parsedOptions.clear();
-        args = CreateVector(argc, argv);
+    /// Value of a typed option, converted once during the parse. Both representations are stored,
+    /// so reading it as any type is a single load.
+    struct TypedValue {
+        int64_t integer;    // The integer, 0 or 1 for booleans, the index of the name for enums, truncated for doubles
+        double real;        // The value as a double
+    };
 
-        for (size_t i = 1; i < args.size(); ++i) {
-            std::string arg = args[i];
-            std::string match_arg = arg;
+    /// Converts a typed value to T: floating point types read the double, all others the integer.
+    template<typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, T>::type FromTyped(const TypedValue& value) {
+        return static_cast<T>(value.real);
+    }
+    template<typename T>
+    static typename std::enable_if<std::is_same<T, bool>::value, T>::type FromTyped(const TypedValue& value) {
+        return value.integer != 0;
+    }
+    template<typename T>
+    static typename std::enable_if<(std::is_integral<T>::value || std::is_enum<T>::value) && !std::is_same<T, bool>::value, T>::type
+    FromTyped(const TypedValue& value) {
+        return static_cast<T>(value.integer);
+    }
 
-            if (ignore_case) {
-                std::transform(match_arg.begin(), match_arg.end(), match_arg.begin(),
-                            [](unsigned char c) { return std::tolower(c); });
-            }
+    /// Converted elements of a typed list option, see GetList. Valid as long as the results it came from.
+    template<typename T>
+    class TypedList {
+    public:
+        class const_iterator {
+        public:
+            explicit const_iterator(const TypedValue* pos) : pos(pos) {}
+            T operator*() const { return FromTyped<T>(*pos); }
+            const_iterator& operator++() { ++pos; return *this; }
+            bool operator==(const const_iterator& other) const { return pos == other.pos; }
+            bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+        private:
+            const TypedValue* pos;
+        };
+
+        TypedList() : first(nullptr), count(0) {}
+        TypedList(const TypedValue* values, size_t size) : first(values), count(size) {}
+
+        T operator[](size_t i) const { return FromTyped<T>(first[i]); }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const_iterator begin() const { return const_iterator(first); }
+        const_iterator end() const { return const_iterator(first + count); }
+
+    private:
+        const TypedValue* first;
+        size_t count;
+    };
 
-            bool matched = false;
-            for (const auto& option : cmdOptions) {
-                std::string long_name = option.long_name;
-                std::string short_name = option.short_name;
+    /// Role of a token, as reported to the trace callback
+    enum class TokenKind {
+        Option,             // A known option name
+        Value,              // The value of the option before it
+        Positional,         // Neither an option nor an option value
+        Unknown,            // Looks like an option but matches none
+        Command,            // Names a subcommand, only reported by Session
+        EndOfOptions        // The "--" ending the options, see ParserOptions::EndOfOptions
+    };
 
-                if (ignore_case) {
-                    std::transform(long_name.begin(), long_name.end(), long_name.begin(),
-                                [](unsigned char c) { return std::tolower(c); });
-                    std::transform(short_name.begin(), short_name.end(), short_name.begin(),
-                                [](unsigned char c) { return std::tolower(c); });
-                }
+    /// Instrumentation of one parse, collected only when enabled with EnableStats.
+    /// Allocations and bytes count what the parser requests itself: buffer growth, token arena
+    /// chunks and owning value copies. Buffer growth is estimated as one allocation per doubling,
+    /// and strings short enough for the small string buffer are free.
+    struct ParseStats {
+        uint64_t ingestNs;      // Reading arguments: tokenizing, response files, everything but matching
+        uint64_t matchNs;       // Matching tokens against the options
+        uint64_t extractNs;     // Copying values into owning strings, zero with ParserOptions::ZeroCopy
+        uint64_t resolveNs;     // Building the query table, with defaults for options not given
+        uint64_t tokens;        // Tokens matched, including those read from response files
+        uint64_t options;       // Options matched
+        uint64_t positionals;   // Positional arguments
+        uint64_t allocations;   // Heap allocations made by the parse
+        uint64_t bytes;         // Bytes allocated by the parse
+    };
 
-                if (match_arg == prefix_lng + long_name || match_arg == prefix_sht + short_name) {
-                    matched = true;
+    /// Called for every token matched, with the option it names or completes, or -1.
+    typedef std::function<void(const ArgView& token, TokenKind kind, OptionId id)> TraceCallback;
+
+    /// Kind of problem a Diagnostic reports
+    enum class DiagnosticCode {
+        UnknownOption,      // A token looks like an option but names none
+        AmbiguousOption,    // An abbreviation matches several long names
+        MissingValue,       // An option needs a value and has neither one nor a default
+        MissingListValue,   // A list option has neither a value nor a default
+        ResponseFileDepth,  // Response files are nested too deeply
+        VersionNotSet,      // Version output was printed without a version set
+        InvalidValue,       // A typed option's value does not convert, or is not one of its allowed names
+        ValueOutOfRange,    // A typed option's value does not fit its type or its allowed range
+        MemoryExhausted,    // The result's MemoryResource ran out of memory
+        MissingPositional,  // A required positional slot was not given, the token is its name
+        UnexpectedPositional    // A positional argument beyond the declared slots, which have no tail
+    };
 
-                    // Handle special options
-                    if (option.options & QSTU64(CmdOptionFlags::IsHelpOption)) {
-                        PrintHelp();
-                        return ParseResult::SuccessWithHelp;
-                    }
+    /// A parse error as a record, see Result::CollectDiagnostics and FormatDiagnostic for the message.
+    struct Diagnostic {
+        DiagnosticCode code;
+        size_t index;       // Argument index: in argv (0 is the program name), in the argument list or among the
+                            // tokens of a command string. Tokens of a response file carry the index of the @file argument.
+        ArgView token;      // The offending argument, or list element, valid as long as the values of the parse.
+                            // Invalid environment, config or default values carry index 0 and the value as token.
+        OptionId option;    // The option concerned, or -1 for unknown and ambiguous options
+    };
 
-                    if (option.options & QSTU64(CmdOptionFlags::IsVersionOption)) {
-                        PrintVersion(true);
-                        return ParseResult::SuccessWithVersion;
-                    }
+    /// Called for every diagnostic of a parse, in order. The token view is only valid during the call.
+    typedef std::function<void(const Diagnostic& diagnostic)> DiagnosticCallback;
 
-                    ParsedOption parsed;
-                    parsed.short_name = option.short_name;
-                    parsed.long_name = option.long_name;
-
-                    // Handle required value
-                    if (option.options & QSTU64(CmdOptionFlags::IsValueRequired)) {
-                        if (i + 1 < args.size()) {
-                            std::string next = args[i + 1];
-                            bool next_is_option = next.rfind(prefix_lng, 0) == 0 || next.rfind(prefix_sht, 0) == 0;
-
-                            if (!next_is_option) {
-                                parsed.values.push_back(next);
-                                ++i; // Skip the value
-                            }
-                            else {
-                                if (!option.DefaultValue.empty()) {
-                                    parsed.values.push_back(option.DefaultValue);
-                                }
-                                else {
-                                    std::cerr << "Missing value for required option: " << arg << std::endl;
-                                    return ParseResult::MissingValue;
-                                }
-                            }
-                        }
-                        else {
-                            if (!option.DefaultValue.empty()) {
-                                parsed.values.push_back(option.DefaultValue);
-                            }
-                            else {
-                                std::cerr << "Missing value for required option: " << arg << std::endl;
-                                return ParseResult::MissingValue;
-                            }
-                        }
-                    }
-                    // Handle list
-                    else if (option.options & QSTU64(CmdOptionFlags::IsList)) {
-                        if (i + 1 < args.size()) {
-                            std::string next = args[i + 1];
-                            bool next_is_option = next.rfind(prefix_lng, 0) == 0 || next.rfind(prefix_sht, 0) == 0;
-
-                            if (!next_is_option) {
-                                parsed.values = ToList(next, ListSeparator);
-                                ++i; // Skip the value
-                            }
-                            else {
-                                if (!option.DefaultValue.empty()) {
-                                    parsed.values = ToList(option.DefaultValue, ListSeparator);
-                                }
-                                else {
-                                    std::cerr << "Missing list value for option: " << arg << std::endl;
-                                    return ParseResult::MissingValue;
-                                }
-                            }
-                        }
-                        else {
-                            if (!option.DefaultValue.empty()) {
-                                parsed.values = ToList(option.DefaultValue, ListSeparator);
-                            }
-                            else {
-                                std::cerr << "Missing list value for option: " << arg << std::endl;
-                                return ParseResult::MissingValue;
-                            }
-                        }
-                    }
-                    // No value needed
-                    else {
-                        if (option.options & QSTU64(CmdOptionFlags::IsRequired)) {
-                            if (!option.DefaultValue.empty()) {
-                                parsed.values.push_back(option.DefaultValue);
-                            }
-                            else {
-                                std::cerr << "Missing value for required option: " << arg << std::endl;
-                                return ParseResult::MissingValue;
-                            }
-                        }
-                        else {
-                            if (!option.DefaultValue.empty())
-                                parsed.values.push_back(option.DefaultValue);
-                            else
-                                parsed.values.push_back(""); // Fallback to empty string
-                        }
-                    }
+    /// Where the value of an option came from, in order of increasing precedence
+    enum class ValueSource {
+        Default,            // The option's DefaultValue
+        ConfigFile,         // The option's configKey in the loaded config file
+        Environment,        // The option's environment variable
+        CommandLine         // The parsed arguments
+    };
 
+    /// Source of the memory a Result parses into instead of the heap, see Result::SetMemory.
+    /// Memory is never freed one allocation at a time, all of it is released at the start of every parse.
+    class MemoryResource {
+    public:
+        virtual ~MemoryResource() {}
+        /// Allocates size bytes aligned to align, a power of two.
+        /// @return The memory, or null if the resource is exhausted, which fails the parse.
+        virtual void* Allocate(size_t size, size_t align) = 0;
+        /// Releases everything allocated, called at the start of every parse into the result using it.
+        virtual void Release() = 0;
+    };
 
-                    parsedOptions.push_back(parsed);
-                    break;
+    /// Bump allocator over blocks of memory, a MemoryResource for one Result.
+    /// Over a caller-provided buffer it never touches the heap and fails what does not fit.
+    /// Over a buffer of its own it allocates that once and, if it may grow, adds a heap block when
+    /// a parse does not fit. Blocks are kept across parses, so once sized for the largest parse,
+    /// e.g. with Spec::RequiredMemory, parsing allocates nothing.
+    /// Usage:
+    ///     static char storage[64 * 1024];
+    ///     Arghand::MonotonicBuffer buffer(storage, sizeof(storage));
+    ///     result.SetMemory(&buffer);
+    class MonotonicBuffer : public MemoryResource {
+    public:
+        /// Allocates from a caller-provided buffer only, which must outlive this.
+        MonotonicBuffer(void* buffer, size_t size) : grow(false) {
+            AddBlock(static_cast<char*>(buffer), size);
+        }
+        /// Allocates from a buffer of its own of size bytes, allocated here.
+        /// @param grow Add heap blocks when the buffer is exhausted, else fail what does not fit
+        explicit MonotonicBuffer(size_t size = 0, bool grow = true) : grow(grow) {
+            if (size) AddOwnedBlock(size);
+        }
+        MonotonicBuffer(const MonotonicBuffer&) = delete;
+        MonotonicBuffer& operator=(const MonotonicBuffer&) = delete;
+
+        void* Allocate(size_t size, size_t align) override {
+            for (;;) {
+                if (current < blocks.size()) {
+                    Block& block = blocks[current];
+                    // The block's own alignment is unknown, align the address rather than the offset
+                    size_t start = used + ((align - (reinterpret_cast<uintptr_t>(block.data + used) & (align - 1))) & (align - 1));
+                    if (start <= block.size && size <= block.size - start) {
+                        consumed += start + size - used;
+                        used = start + size;
+                        peak = std::max(peak, consumed);
+                        return block.data + start;
+                    }
+                    if (current + 1 < blocks.size()) {
+                        consumed += block.size - used;
+                        ++current;
+                        used = 0;
+                        continue;
+                    }
                 }
+                if (!grow) return nullptr;
+                size_t last = blocks.empty() ? 0 : blocks.back().size;
+                if (current < blocks.size()) consumed += blocks[current].size - used;
+                AddOwnedBlock(std::max(size + align, std::max<size_t>(last * 2, 4096)));
+                current = blocks.size() - 1;
+                used = 0;
             }
+        }
 
-            // If unmatched and looks like an option
-            if (!matched && (arg.rfind(prefix_lng, 0) == 0 || arg.rfind(prefix_sht, 0) == 0)) {
-                std::cerr << "Unknown option: " << arg << std::endl;
-                return ParseResult::Error;
-            }
+        void Release() override {
+            current = 0;
+            used = 0;
+            consumed = 0;
+        }
+
+        /// Gets the bytes in all blocks.
+        size_t GetCapacity() const {
+            size_t capacity = 0;
+            for (const Block& block : blocks) capacity += block.size;
+            return capacity;
+        }
+        /// Gets the most bytes a parse consumed, padding and skipped block tails included.
+        size_t GetPeak() const { return peak; }
+
+    private:
+        struct Block {
+            char* data;
+            size_t size;
+        };
+
+        void AddBlock(char* data, size_t size) {
+            Block block;
+            block.data = data;
+            block.size = size;
+            blocks.push_back(block);
+        }
+        void AddOwnedBlock(size_t size) {
+            owned.push_back(std::unique_ptr<char[]>(new char[size]));
+            AddBlock(owned.back().get(), size);
         }
 
-        return ParseResult::Success;
+        std::vector<Block> blocks;                  // Blocks in allocation order
+        std::vector<std::unique_ptr<char[]>> owned; // Blocks allocated by the buffer itself
+        size_t current = 0;                         // Block being allocated from
+        size_t used = 0;                            // Bytes used in the current block
+        size_t consumed = 0;                        // Bytes used since the last Release, in all blocks
+        size_t peak = 0;                            // Most bytes used between two releases
+        bool grow;                                  // Add heap blocks when exhausted
+    };
+
+    /// Parsed key=value config file, defined below.
+    class Config;
+    /// Immutable, compiled option definition that can be shared across threads, defined below.
+    class Spec;
+    /// Results of one parse, defined below.
+    class Result;
+    /// Push-style parser for unbounded argument sequences, defined below the class.
+    class Stream;
+    /// Incrementally re-parsed command line with completion, for interactive shells, defined below the class.
+    class Session;
+
+    /// Outcome of one command line of a batch parse, see Spec::ParseBatch.
+    struct BatchResult {
+        ParseResult result;     // Result of the parse
+        uint32_t options;       // Options matched
+        uint32_t positionals;   // Positional arguments
+        Diagnostic diagnostic;  // First error unless the parse succeeded, rendered on demand by Spec::FormatDiagnostic.
+                                // Its token is empty where the parse rewrote it (quoted, or read from a response file).
+    };
+
+    /// Called on a worker thread for every command line of a batch parse, with its index and results.
+    typedef std::function<void(size_t index, const Result& result)> BatchVisitor;
+
+    /// Parses command-line arguments
+    /// @param argc Number of command-line arguments
+    /// @param argv Array of command-line arguments
+    /// @return ParseResult indicating the result of the parsing operation
+    ParseResult parse(int argc, char* argv[]) {
+        PrepareCommands();
+        ParseResult res = spec->parse(argc, argv, result);
+        if (res == ParseResult::Success && result.command >= 0) {
+            // The subcommand name takes the place of the program name in its arguments
+            return Dispatch(result.command).parse(argc - static_cast<int>(result.commandArg), argv + result.commandArg);
+        }
+        return Report(res);
+    }
+
+    /// Parses a command string holding the arguments without the program name, see Spec::parse(command, result).
+    /// @param command The command string
+    /// @return ParseResult indicating the result of the parsing operation
+    ParseResult parse(const ArgView& command) {
+        PrepareCommands();
+        ParseResult res = spec->parse(command, result);
+        if (res == ParseResult::Success && result.command >= 0) {
+            return Dispatch(result.command).parse(result.commandRest);
+        }
+        return Report(res);
+    }
+
+    /// Sets up the handler of a subcommand, called the first time a parse reaches it.
+    /// The handler comes configured like its parent and named "<application> <subcommand>".
+    typedef std::function<void(Arghand& command)> CommandFactory;
+
+    /// Adds a subcommand with its own options, help and nested subcommands, git style.
+    /// The first positional argument, if it names a subcommand, ends this handler's arguments and
+    /// the rest are parsed by the subcommand's handler, which then holds the results.
+    /// The handler is only built, through factory, when a parse dispatches to it, so a run pays
+    /// for this option table and the one subcommand it uses.
+    /// @param name The subcommand name as given on the command line
+    /// @param description Description for the commands section of the help
+    /// @param factory Sets the options, and possibly subcommands, of the subcommand's handler
+    void AddSubcommand(const std::string& name, const std::string& description, const CommandFactory& factory) {
+        subcommands.push_back(Subcommand(name, description, factory));
+        commandsChanged = true;
+        InvalidateText();
     }
 
+    /// Gets the handler of the subcommand the last parse dispatched to, or null.
+    /// Its results, and its own subcommand if it has one, are queried on it.
+    Arghand* GetSubcommand() const { return activeCommand >= 0 ? subcommands[activeCommand].handler.get() : nullptr; }
+    /// Gets the name of the subcommand the last parse dispatched to, or an empty string.
+    const std::string& GetSubcommandName() const { return activeCommand >= 0 ? subcommands[activeCommand].name : EmptyString(); }
+
     /// Converts a string to a boolean value.
     /// @param value The string value to convert
     /// @return True if the string represents a true value, false otherwise.
     /// Recognized true values: "true", "1", "yes", "on" (case-insensitive)
-    static bool ToBoolean(std::string& value) {
-        std::string buf = value;
-        std::transform(buf.begin(), buf.end(), buf.begin(),
-                       [](unsigned char c) { return std::tolower(c); });
-        return (buf == "true" || buf == "1" || buf == "yes" || buf == "on");
+    static bool ToBoolean(const std::string& value) {
+        bool result = false;
+        Convert(value, result);
+        return result;
     }
 
     /// Converts a string to an integer value.
+    /// Errors are printed on stderr unless error is given, or use Convert.
     /// @param value The string value to convert
+    /// @param error Receives the result of the conversion instead of a message being printed, or null
     /// @return The integer value if conversion is successful, 0 otherwise.
-    static int ToInteger(std::string& value) {
-        try {
-            return std::stoi(value);
-        } catch (const std::invalid_argument&) {
-            std::cerr << "Invalid integer value: " << value << std::endl;
-            return 0;
-        } catch (const std::out_of_range&) {
-            std::cerr << "Integer value out of range: " << value << std::endl;
-            return 0;
-        }
-    }
+    static int ToInteger(const std::string& value, ConvertResult* error = nullptr);
 
     /// Converts a string to a double value.
+    /// Errors are printed on stderr unless error is given, or use Convert.
     /// @param value The string value to convert
+    /// @param error Receives the result of the conversion instead of a message being printed, or null
     /// @return The double value if conversion is successful, 0.0 otherwise.
-    static double ToDouble(std::string& value) {
-        try {
-            return std::stod(value);
-        } catch (const std::invalid_argument&) {
-            std::cerr << "Invalid double value: " << value << std::endl;
-            return 0.0;
-        } catch (const std::out_of_range&) {
-            std::cerr << "Double value out of range: " << value << std::endl;
-            return 0.0;
+    static double ToDouble(const std::string& value, ConvertResult* error = nullptr);
+
+    /// Converts a value to any integer type, signed or unsigned, of any width.
+    /// Accepts an optional sign and decimal digits, nothing else, not even whitespace.
+    /// Never throws or allocates, and does not depend on the locale.
+    /// @param value The value to convert
+    /// @param out Receives the converted value, left unchanged on error
+    /// @return ConvertResult indicating the result of the conversion
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, ConvertResult>::type
+    Convert(const ArgView& value, T& out) {
+        if (value.empty()) return ConvertResult::Empty;
+        bool negative = false;
+        uint64_t magnitude = 0;
+        const char* stop = ParseDecimal(value.begin(), value.end(), negative, magnitude);
+        if (!stop) return ConvertResult::OutOfRange;
+        if (stop != value.end() || stop == value.begin() || !IsDigit(stop[-1])) return ConvertResult::Invalid;
+        return StoreInteger(negative, magnitude, out);
+    }
+
+    /// Converts a value to a boolean.
+    /// True values are "true", "1", "yes" and "on", false values "false", "0", "no" and "off" (case-insensitive).
+    /// @return ConvertResult indicating the result of the conversion, Invalid for any other value
+    static ConvertResult Convert(const ArgView& value, bool& out);
+
+    /// Converts a value to a double.
+    /// Accepts [sign] digits [. digits] [e [sign] digits], as well as "inf", "infinity" and "nan" (case-insensitive).
+    /// The decimal point is always '.', whatever the locale. Values with up to 15 significant digits and
+    /// small exponents, the common case, are converted exactly without any library call. All others are
+    /// correctly rounded too, on a fixed buffer of digits. Never allocates. Values too small for a double become zero.
+    /// @param value The value to convert
+    /// @param out Receives the converted value, left unchanged on error
+    /// @return ConvertResult indicating the result of the conversion
+    static ConvertResult Convert(const ArgView& value, double& out);
+
+    /// Converts a value to a float, see Convert(value, double&).
+    static ConvertResult Convert(const ArgView& value, float& out);
+
+    /// Converts a duration such as "10ms", "1.5s" or "1h30m" to any std::chrono::duration.
+    /// Units are ns, us, ms, s, m or min, h and d. Every number needs a unit, except for a plain "0".
+    /// Results finer than the target duration are truncated.
+    /// @param value The value to convert
+    /// @param out Receives the converted duration, left unchanged on error
+    /// @return ConvertResult indicating the result of the conversion
+    template<typename Rep, typename Period>
+    static ConvertResult ToDuration(const ArgView& value, std::chrono::duration<Rep, Period>& out) {
+        if (value.empty()) return ConvertResult::Empty;
+        const char* c = value.begin();
+        const char* end = value.end();
+        bool negative = false;
+        if (*c == '+' || *c == '-') negative = *c++ == '-';
+        if (end - c == 1 && *c == '0') {
+            out = std::chrono::duration<Rep, Period>::zero();
+            return ConvertResult::Success;
+        }
+        if (c == end) return ConvertResult::Invalid;
+
+        static const struct { const char* name; uint64_t ns; } units[] = {
+            { "ns", 1ull }, { "us", 1000ull }, { "ms", 1000000ull }, { "s", 1000000000ull },
+            { "m", 60000000000ull }, { "min", 60000000000ull }, { "h", 3600000000000ull }, { "d", 86400000000000ull },
+        };
+        uint64_t total = 0;
+        while (c != end) {
+            uint64_t whole = 0, fraction = 0, scale = 1;
+            const char* stop = ParseNumber(c, end, whole, fraction, scale);
+            if (!stop) return ConvertResult::OutOfRange;
+            if (stop == c) return ConvertResult::Invalid;
+            const char* unit = stop;
+            while (stop != end && *stop >= 'a' && *stop <= 'z') ++stop;
+            size_t length = static_cast<size_t>(stop - unit);
+            uint64_t ns = 0;
+            for (const auto& u : units) {
+                if (std::strlen(u.name) == length && std::memcmp(unit, u.name, length) == 0) ns = u.ns;
+            }
+            if (!ns) return ConvertResult::Invalid;
+            uint64_t part = 0;
+            if (!Scale(whole, fraction, scale, ns, part) || part > std::numeric_limits<uint64_t>::max() - total) return ConvertResult::OutOfRange;
+            total += part;
+            c = stop;
         }
+        if (total > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return ConvertResult::OutOfRange;
+
+        std::chrono::nanoseconds ns(negative ? -static_cast<int64_t>(total) : static_cast<int64_t>(total));
+        std::chrono::duration<double, Period> checked = ns;
+        if (checked.count() > static_cast<double>(std::numeric_limits<Rep>::max()) ||
+            checked.count() < static_cast<double>(std::numeric_limits<Rep>::lowest())) {
+            return ConvertResult::OutOfRange;
+        }
+        out = std::chrono::duration_cast<std::chrono::duration<Rep, Period>>(ns);
+        return ConvertResult::Success;
     }
 
+    /// Converts a size such as "512", "64KB", "4GiB" or "1.5M" to a number of bytes.
+    /// K, M, G, T, P and E (case-insensitive) with an optional "i" or "iB" are powers of 1024,
+    /// with "B" they are powers of 1000 (as in GNU tools). A trailing "B" alone means bytes.
+    /// Fractional bytes are truncated.
+    /// @param value The value to convert
+    /// @param out Receives the number of bytes, left unchanged on error
+    /// @return ConvertResult indicating the result of the conversion
+    static ConvertResult ToSize(const ArgView& value, uint64_t& out);
+
+    /// Converts a whole list to integers in one pass, without splitting it first.
+    /// An empty list gives no elements, an empty element is an error.
+    /// @param list The list, e.g. from GetListView
+    /// @param out Receives the converted elements, appended. On error it holds the elements before the failing one
+    /// @return ConvertResult indicating the result of the conversion, for the first failing element
+    static ConvertResult ToIntegers(const ArgSplitView& list, std::vector<int64_t>& out);
+
+    /// Converts a whole list to doubles, see ToIntegers and Convert(value, double&).
+    static ConvertResult ToDoubles(const ArgSplitView& list, std::vector<double>& out);
+
     /// Converts a string to a list of strings, separated by a specified character.
     /// @param value The string value to convert
     /// @param separator The character used to separate values in the string (default is '|')
     /// @return A vector of strings containing the separated values.
     /// If the string is empty, returns an empty vector.
+    /// Use GetListView or ArgSplitView to split without allocating.
     static std::vector<std::string> ToList(const std::string& value, char separator = '|') {
         std::vector<std::string> list;
-        size_t start = 0;
-        size_t end = value.find(separator);
-        while (end != std::string::npos) {
-            list.push_back(value.substr(start, end - start));
-            start = end + 1;
-            end = value.find(separator, start);
-        }
-        list.push_back(value.substr(start));
+        for (const ArgView& item : ArgSplitView(value, separator)) {
+            list.emplace_back(item.data, item.size);
+        }
         return list;
     }
 
     /// Sets the separator character for list options.
     /// @param separator The character to use as a separator for list options (default is '|')
     /// This character is used to split list values in options that are marked as lists.
-    void SetSeparator(char separator) { ListSeparator = separator; }
+    void SetSeparator(char separator) {
+        ListSeparator = separator;
+        RebuildSpec(spec ? spec->GetCmdOptions() : std::vector<CmdOption>());
+    }
     /// Gets the current separator character for list options.
     /// @return The character used as a separator for list options.
     char GetSeparator() const { return ListSeparator; }
 
     /// Sets the command options for the argument handler.
-    void SetCmdOptions(const std::vector<CmdOption>& options) {cmdOptions = options;}
+    /// Also compiles the spec (lookup indices and split defaults) used by parse().
+    void SetCmdOptions(const std::vector<CmdOption>& options) {
+        RebuildSpec(options);
+    }
     /// Gets the command options currently set in the argument handler.
-    const std::vector<CmdOption>& GetCmdOptions() const {return cmdOptions;}
+    const std::vector<CmdOption>& GetCmdOptions() const { return spec->GetCmdOptions(); }
+
+    /// Option name, short or long, with the environment variable or config key to bind it to
+    typedef std::pair<std::string, std::string> Binding;
+
+    /// Binds an option to an environment variable, used when the option is not on the command line.
+    /// Values are taken from the command line, then the environment, then the config file, then the default.
+    /// The variable is read whenever the spec is rebuilt, i.e. now and by later Set* calls and LoadConfig.
+    /// Every call rebuilds the spec, bind more than a few options with SetEnvironmentVariables or CMD_OPTION_BOUND.
+    /// @param name The name of the option (can be short or long name)
+    /// @param variable The environment variable, empty to unbind
+    /// @return False if there is no such option.
+    bool SetEnvironmentVariable(const ArgView& name, const std::string& variable) {
+        return Bind(std::vector<Binding>(1, Binding(name.str(), variable)), &CmdOption::environment);
+    }
+    /// Binds many options to environment variables with a single rebuild of the spec, see SetEnvironmentVariable.
+    /// @param bindings Option names with their variables, an empty variable unbinds
+    /// @return False if one of the options does not exist, nothing is bound then.
+    bool SetEnvironmentVariables(const std::vector<Binding>& bindings) {
+        return Bind(bindings, &CmdOption::environment);
+    }
+
+    /// Binds an option to a key of the config file loaded with LoadConfig, see SetEnvironmentVariable.
+    /// Every call rebuilds the spec, bind more than a few options with SetConfigKeys or CMD_OPTION_BOUND.
+    /// @param name The name of the option (can be short or long name)
+    /// @param key The key, "key" or "section.key", empty to unbind
+    /// @return False if there is no such option.
+    bool SetConfigKey(const ArgView& name, const std::string& key) {
+        return Bind(std::vector<Binding>(1, Binding(name.str(), key)), &CmdOption::configKey);
+    }
+    /// Binds many options to config keys with a single rebuild of the spec, see SetConfigKey.
+    /// @param bindings Option names with their keys, an empty key unbinds
+    /// @return False if one of the options does not exist, nothing is bound then.
+    bool SetConfigKeys(const std::vector<Binding>& bindings) {
+        return Bind(bindings, &CmdOption::configKey);
+    }
+
+    /// Loads the config file that options bound with SetConfigKey or CMD_OPTION_BOUND fall back to.
+    /// Subcommands built afterwards share it. See Config for the format and the snapshot.
+    /// @param path The config file
+    /// @param snapshot Path of a binary snapshot that caches the parsed file, or empty for none
+    /// @return False if the config file cannot be read, the previous config is kept then.
+    bool LoadConfig(const std::string& path, const std::string& snapshot = std::string()) {
+        std::shared_ptr<Config> loaded = std::make_shared<Config>();
+        if (!loaded->Load(path, snapshot)) return false;
+        config = loaded;
+        RebuildSpec(spec->GetCmdOptions());
+        return true;
+    }
+    /// Gets the config file loaded with LoadConfig, or null.
+    const Config* GetConfig() const { return config.get(); }
+
+    /// Gets the compiled spec of the current configuration.
+    /// The spec never changes once built, so it can be shared with other threads, each parsing
+    /// into its own Result. Set* calls build a new spec and leave the old one untouched.
+    std::shared_ptr<const Spec> GetSpec() const { return spec; }
+    /// Gets the results of the last parse().
+    const Result& GetResult() const { return result; }
+
+    /// Gets the handle of an option by its name.
+    /// @param name The name of the option (can be short or long name)
+    /// @return The option ID, or -1 if no option has that name.
+    OptionId GetOptionId(const ArgView& name) const { return spec->GetOptionId(name); }
 
     /// Checks if an option with the given name exists in the parsed options.
     /// @param name The name of the option to check (can be short or long name)
     /// @return True if the option exists, false otherwise.
-    bool operator[](const std::string& name) const {
-        for (const auto& option : parsedOptions) {
-            if (option.short_name == name || option.long_name == name) {
-                return true;
-            }
-        }
-        return false;
-    }
+    bool operator[](const ArgView& name) const { return result[name]; }
+    /// Checks if the option with the given ID exists in the parsed options.
+    bool IsSet(OptionId id) const { return result.IsSet(id); }
+
     /// Gets the value of an option by its name.
+    /// With ParserOptions::ZeroCopy or SetMemory no owning copies exist: an option that was given asserts,
+    /// and returns an empty string without assertions. Use GetValueView instead.
     /// @param name The name of the option to get the value for (can be short or long name)
-    /// @return The value of the option if it exists, or an empty string if not
-    std::string GetValue(const std::string& name) const {
-        for (const auto& option : parsedOptions) {
-            if (option.short_name == name || option.long_name == name) {
-                if (!option.values.empty()) {
-                    return option.values[0];
-                }
-            }
-        }
-        
-        for (const auto& option : cmdOptions) {
-            if (option.short_name == name || option.long_name == name) {
-                return option.DefaultValue;
-            }
-        }
-        return "";
-    }
+    /// @return The value of the option if it exists, its default value if not, or an empty string if there is no such option
+    const std::string& GetValue(const ArgView& name) const { return result.GetValue(name); }
+    /// Gets the value of an option by its ID, see GetValue(name).
+    const std::string& GetValue(OptionId id) const { return result.GetValue(id); }
 
     /// Gets the values of an option by its name.
+    /// With ParserOptions::ZeroCopy or SetMemory no owning copies exist: an option that was given asserts,
+    /// and returns an empty vector without assertions. Use GetValuesView instead.
     /// @param name The name of the option to get the values for (can be short or long name)
-    /// @return A vector of strings containing the values of the option if it exists, or an empty vector if not
-    std::vector<std::string> GetValues(const std::string& name) {
-        for (auto& option : parsedOptions) {
-            if (option.short_name == name || option.long_name == name) {
-                return option.values;
-            }
-        }
-
-        for (const auto& option : cmdOptions) {
-            if (option.short_name == name || option.long_name == name) {
-                if (option.options & QSTU64(CmdOptionFlags::IsList)) {
-                    std::vector<std::string> list = ToList(option.DefaultValue, ListSeparator);
-                    return list;
-                } else {
-                    static std::vector<std::string> single_value = { option.DefaultValue };
-                    return single_value;
-                }
-            }
-        }
+    /// @return The values of the option if it exists, its (split) default value if not, or an empty vector if there is no such option
+    const std::vector<std::string>& GetValues(const ArgView& name) const { return result.GetValues(name); }
+    /// Gets the values of an option by its ID, see GetValues(name).
+    const std::vector<std::string>& GetValues(OptionId id) const { return result.GetValues(id); }
 
-        static std::vector<std::string> empty;
-        return empty;
+    /// Gets the value of an option by its name, without copying.
+    /// Works in both parse modes and is the accessor to use with ParserOptions::ZeroCopy.
+    /// @param name The name of the option to get the value for (can be short or long name)
+    /// @return A view of the first value of the option, its default value if it was not given, or an empty view.
+    /// The view points into argv or the option table and is valid while both are.
+    ArgView GetValueView(const ArgView& name) const { return result.GetValueView(name); }
+    /// Gets the value of an option by its ID, without copying, see GetValueView(name).
+    ArgView GetValueView(OptionId id) const { return result.GetValueView(id); }
+
+    /// Gets the values of an option by its name, without copying.
+    /// @param name The name of the option to get the values for (can be short or long name)
+    /// @return The views of the option's values, its (split) default value if it was not given, or an empty list.
+    ArgViewList GetValuesView(const ArgView& name) const { return result.GetValuesView(name); }
+    /// Gets the values of an option by its ID, without copying, see GetValuesView(name).
+    ArgViewList GetValuesView(OptionId id) const { return result.GetValuesView(id); }
+
+    /// Gets the values of an option by its name as a lazy list, split on the list separator while iterating.
+    /// Nothing is split or stored up front, so this is the cheapest way to walk very long lists,
+    /// in particular with ParserOptions::LazyLists. Options that are not lists give their value as the only element.
+    /// @param name The name of the option to get the values for (can be short or long name)
+    /// @return The unsplit first value of the option, its default value if it was not given, or an empty view.
+    ArgSplitView GetListView(const ArgView& name) const { return result.GetListView(name); }
+    /// Gets the values of an option by its ID as a lazy list, see GetListView(name).
+    ArgSplitView GetListView(OptionId id) const { return result.GetListView(id); }
+
+    /// Gets the positional arguments, i.e. arguments that are neither options nor option values,
+    /// including those after "--" (see ParserOptions::EndOfOptions) and those bound to positional slots.
+    /// A million of them cost one view each, nothing is copied.
+    /// @return Views into argv, in argument order.
+    ArgViewList GetPositionalViews() const { return result.GetPositionalViews(); }
+
+    /// Gets where the value of an option came from: the command line, its environment variable,
+    /// the config file or its default value. GetValue and the other accessors follow the same order.
+    /// @param name The name of the option (can be short or long name)
+    ValueSource GetSource(const ArgView& name) const { return result.GetSource(name); }
+    /// Gets where the value of an option came from, by its ID.
+    ValueSource GetSource(OptionId id) const { return result.GetSource(id); }
+
+    /// Collects up to capacity parse errors per parse as Diagnostic records instead of printing them
+    /// on stderr, in a buffer allocated here. Subcommands report the same way into their own handler.
+    /// Usage:
+    ///     handler.CollectDiagnostics(4);
+    ///     if (handler.parse(argc, argv) != Arghand::ParseResult::Success) {
+    ///         for (const Arghand::Diagnostic& d : handler.GetDiagnostics()) log(d.code, d.index, handler.FormatDiagnostic(d));
+    ///     }
+    void CollectDiagnostics(size_t capacity) { result.CollectDiagnostics(capacity); }
+    /// Gets the diagnostics of the last parse, and of PrintHelp or PrintVersion since.
+    const std::vector<Diagnostic>& GetDiagnostics() const { return result.GetDiagnostics(); }
+    /// Gets the number of diagnostics of the last parse that did not fit the collected ones.
+    size_t GetDroppedDiagnostics() const { return result.GetDroppedDiagnostics(); }
+    /// Sets the callback called for every diagnostic instead of printing it, an empty function disables it.
+    void SetDiagnosticCallback(const DiagnosticCallback& fn) { result.SetDiagnosticCallback(fn); }
+    /// Enables or disables quiet mode: errors are only returned as the ParseResult.
+    void SetQuiet(bool quiet) { result.SetQuiet(quiet); }
+    /// Renders a diagnostic as the message it replaces, see Spec::FormatDiagnostic.
+    std::string FormatDiagnostic(const Diagnostic& diagnostic) const { return spec->FormatDiagnostic(diagnostic); }
+
+    /// Gets the value of an option declared IsInteger, IsDouble, IsBoolean or IsEnum, as converted and
+    /// checked during the parse, or the converted fallback value if it was not given. The first value of lists.
+    /// By ID this is a single indexed load, so it can be read in hot loops instead of converting strings.
+    /// T can be any arithmetic or enum type: floating point types read the double, others the integer,
+    /// so an IsEnum option reads as the index of its name. Untyped options read as 0.
+    /// Usage:
+    ///     const Arghand::OptionId jobs = handler.GetOptionId("jobs");
+    ///     for (...) { int n = handler.Get<int>(jobs); ... }
+    template<typename T>
+    T Get(OptionId id) const { return result.Get<T>(id); }
+    /// Gets the value of a typed option by name (can be short or long name), see Get(OptionId).
+    template<typename T>
+    T Get(const ArgView& name) const { return result.Get<T>(name); }
+    /// Gets the converted elements of a typed list option, see Get.
+    template<typename T>
+    TypedList<T> GetList(OptionId id) const { return result.GetList<T>(id); }
+    template<typename T>
+    TypedList<T> GetList(const ArgView& name) const { return result.GetList<T>(name); }
+
+    /// Enables or disables collecting phase timings, counts and allocations on the following parses.
+    /// Disabled, instrumentation costs one test per token.
+    void EnableStats(bool enable) { result.EnableStats(enable); }
+    /// Gets the instrumentation of the last parse that ran with stats enabled, all zero before that.
+    const ParseStats& GetStats() const { return result.GetStats(); }
+    /// Sets a callback called for every token of the following parses, e.g. to export a trace.
+    /// An empty function disables it. The token view is only valid during the call.
+    void SetTraceCallback(const TraceCallback& fn) { result.SetTraceCallback(fn); }
+
+    /// Makes the following parses take all their storage from memory instead of the heap, see Result::SetMemory.
+    /// Subcommands parse into results of their own, set their memory in their factory.
+    /// @param memory The resource, which must outlive the parses, or null for the heap
+    void SetMemory(MemoryResource* memory) { result.SetMemory(memory); }
+    /// Gets the memory resource of the parses, or null for the heap.
+    MemoryResource* GetMemory() const { return result.GetMemory(); }
+
+    /// Parses many argument vectors across a thread pool against this handler's options, see Spec::ParseBatch.
+    /// The handler's own results are left untouched.
+    /// @return One BatchResult per argument vector, in input order
+    std::vector<BatchResult> ParseBatch(const ArgViewList* argvs, size_t count, unsigned threads = 0, const BatchVisitor& visitor = BatchVisitor()) const {
+        return spec->ParseBatch(argvs, count, threads, visitor);
+    }
+    /// Parses many command strings across a thread pool against this handler's options, see Spec::ParseBatch.
+    std::vector<BatchResult> ParseBatch(const ArgView* commands, size_t count, unsigned threads = 0, const BatchVisitor& visitor = BatchVisitor()) const {
+        return spec->ParseBatch(commands, count, threads, visitor);
     }
 
 // Macro to check if a specific parser option exists
 #define ParserOptionsExist(x) ((QSTU64(parserOptions) & QSTU64(x)) != 0)
 
-    /// @brief Prints the help information for the command-line options.
-    /// This function generates and displays the help text based on the command options set in the handler
-    void PrintHelp() const {
-        bool use_unix_style = (QSTU64(parserOptions) & QSTU64(ParserOptions::StyleUnix)) != 0;
-        std::string prefix_lng = use_unix_style ? "--" : "/";
-        std::string prefix_sht = use_unix_style ? "-" : "/";
-        if(ParserOptionsExist(ParserOptions::HelpDisplayHeader)) {
-            std::cout << helpHeader << std::endl;
-        }
-        if(ParserOptionsExist(ParserOptions::HelpDisplayAppName)) {
-            std::cout << applicationName << std::endl;
-        }
-        if(ParserOptionsExist(ParserOptions::HelpDisplayVersion)) {
-            PrintVersion(false);
-        }
-
-        if(ParserOptionsExist(ParserOptions::HelpAutoGenerateArgumentUsageText)) {
-            std::cout << "Usage: \n\t" << applicationName << " ";
-            for(const auto& option : cmdOptions) {
-                bool exists_long_name = !option.long_name.empty();
-                bool exists_short_name = !option.short_name.empty();
-                char br_o = ' ';
-                char br_c = ' ';
-                if (option.options & QSTU64(CmdOptionFlags::IsRequired)) {
-                    br_o = '{';
-                    br_c = '}';
-                } else {
-                    br_o = '[';
-                    br_c = ']';
-                }
-                if(option.options & QSTU64(CmdOptionFlags::IsValueRequired) || option.options & QSTU64(CmdOptionFlags::IsList)) std::cout << br_o;
-                std::cout << br_o << (exists_short_name ? prefix_sht + option.short_name : "")
-                            << (exists_short_name && exists_long_name ? " | " : "")
-                            << (exists_long_name ? prefix_lng + option.long_name : "") << br_c;
-                if(option.options & QSTU64(CmdOptionFlags::IsValueRequired)) {
-                    std::cout << " <value>";
-                } else if(option.options & QSTU64(CmdOptionFlags::IsList)) {
-                    std::cout << " <value1" << ListSeparator << "value2" << ">";
-                }
-                if(option.options & QSTU64(CmdOptionFlags::IsValueRequired) || option.options & QSTU64(CmdOptionFlags::IsList)) std::cout << br_c;
-                std::cout <<" ";
-            }
-            std::cout << "\n\n";
+    /// Destination of help, version and license output. Each print is a single write to it.
+    /// Usage:
+    ///     handler.SetOutput(Arghand::Output::ToDescriptor(1));   // or ToStream(std::cerr), ToString(text), ...
+    class Output {
+    public:
+        /// Writes to stdout through stdio, the default.
+        Output() : kind(Kind::File), file(stdout), stream(nullptr), streamWrite(nullptr), fd(-1), text(nullptr), buffer(nullptr), capacity(0), written(nullptr) {}
+
+        /// Writes to a stdio file, e.g. stderr, flushing once per print.
+        static Output ToFile(std::FILE* file) {
+            Output output;
+            output.file = file;
+            return output;
+        }
+        /// Writes to a stream such as std::cerr, flushing once per print.
+        /// A template so this header needs no iostreams, only callers passing a stream do.
+        template<typename Stream>
+        static Output ToStream(Stream& os) {
+            Output output;
+            output.kind = Kind::Stream;
+            output.stream = &os;
+            output.streamWrite = &WriteStream<Stream>;
+            return output;
+        }
+        /// Writes to a file descriptor with write(), e.g. 1 for stdout, bypassing stdio buffers.
+        static Output ToDescriptor(int fd) {
+            Output output;
+            output.kind = Kind::Descriptor;
+            output.fd = fd;
+            return output;
+        }
+        /// Appends to a string.
+        static Output ToString(std::string& text) {
+            Output output;
+            output.kind = Kind::String;
+            output.text = &text;
+            return output;
         }
-        for (const auto& option : cmdOptions) {
-            bool exists_long_name = !option.long_name.empty();
-            bool exists_short_name = !option.short_name.empty();
+        /// Copies into a fixed buffer, truncating what does not fit. Not NUL-terminated.
+        /// @param written Receives the number of bytes copied by the last print
+        static Output ToBuffer(char* data, size_t capacity, size_t* written) {
+            Output output;
+            output.kind = Kind::Buffer;
+            output.buffer = data;
+            output.capacity = capacity;
+            output.written = written;
+            return output;
+        }
+
+        /// Writes data in one call.
+        void Write(const std::string& data) const;
 
-            std::cout << (exists_short_name ? prefix_sht + option.short_name : "    ")
-                      << (exists_short_name && exists_long_name ? ", " : "")
-                      << (exists_long_name ? prefix_lng + option.long_name : "\t")
-                      << "\t\t\t"
-                      << option.description
-                      << (!option.DefaultValue.empty() ? " | Default value: " + option.DefaultValue : "")
-                      << std::endl;
+    private:
+        template<typename Stream>
+        static void WriteStream(void* stream, const char* data, size_t size) {
+            Stream& os = *static_cast<Stream*>(stream);
+            os.write(data, static_cast<std::ptrdiff_t>(size));
+            os.flush();
         }
-        if(ParserOptionsExist(ParserOptions::HelpDisplayFooter)) {
-            std::cout << helpFooter << std::endl;
+
+        enum class Kind { File, Stream, Descriptor, String, Buffer };
+        Kind kind;
+        std::FILE* file;        // Kind::File
+        void* stream;           // Kind::Stream
+        void (*streamWrite)(void* stream, const char* data, size_t size);
+        int fd;                 // Kind::Descriptor
+        std::string* text;      // Kind::String
+        char* buffer;           // Kind::Buffer
+        size_t capacity;
+        size_t* written;
+    };
+
+    /// Sets where PrintHelp, PrintVersion and PrintLicense write to, stdout by default.
+    void SetOutput(const Output& sink) { output = sink; }
+
+    /// @brief Prints the help information for the command-line options.
+    /// This function generates and displays the help text based on the command options set in the handler
+    /// The text is rendered once and cached until the next Set* call, then written in a single call.
+    void PrintHelp() const {
+        if (ParserOptionsExist(ParserOptions::HelpDisplayVersion) && version.empty()) {
+            WarnVersionNotSet();
         }
-        if(ParserOptionsExist(ParserOptions::HelpDisplayLicense))
-            PrintLicense();
+        output.Write(GetHelpText());
     }
 
     /// Prints the version information of the application.
     /// @param prt_lcs If true, prints the license information after the version.
-    /// If the version is not set, it will print an error message.
+    /// If the version is not set, it will report DiagnosticCode::VersionNotSet like a parse error.
     void PrintVersion(bool prt_lcs) const {
         if (version.empty()) {
-            std::cerr << "Version information is not set." << std::endl;
-        } else {
-            // if no application name is set
-            if (applicationName.empty()) {
-                std::cout << "Version " << version << std::endl;
-            }
-            else {
-                std::cout << applicationName << " version " << version << std::endl;
-            }
+            WarnVersionNotSet();
         }
-        
-        if (prt_lcs && ParserOptionsExist(ParserOptions::VersionDisplayFooter)) {
-            std::cout << versionFooter << std::endl;
-        }
-        if (prt_lcs) {
-            PrintLicense();
-        }
-
+        output.Write(prt_lcs ? GetVersionText() : RenderVersion(false));
     }
 
     /// Prints the license information of the application.
     void PrintLicense() const {
-        std::cout << license << std::endl;
+        output.Write(license + "\n");
+    }
+
+    /// Gets the help text as PrintHelp writes it, rendered on first use and cached until the next Set* call.
+    const std::string& GetHelpText() const {
+        if (!helpCached) {
+            helpText = RenderHelp();
+            helpCached = true;
+        }
+        return helpText;
+    }
+
+    /// Gets the version text as PrintVersion(true) writes it, cached like GetHelpText.
+    const std::string& GetVersionText() const {
+        if (!versionCached) {
+            versionText = RenderVersion(true);
+            versionCached = true;
+        }
+        return versionText;
     }
 
     /// Sets the help header text.
-    void SetHelpHeader(const std::string& header) { helpHeader = header; }
+    void SetHelpHeader(const std::string& header) { helpHeader = header; InvalidateText(); }
     /// Gets the help header text.
     const std::string& GetHelpHeader() const { return helpHeader; }
 
     /// Sets the help footer text.
-    void SetHelpFooter(const std::string& footer) { helpFooter = footer; }
+    void SetHelpFooter(const std::string& footer) { helpFooter = footer; InvalidateText(); }
     /// Gets the help footer text.
     const std::string& GetHelpFooter() const { return helpFooter; }
 
     /// Sets the license text.
-    void SetLicense(const std::string& licenseText) { license = licenseText; }
+    void SetLicense(const std::string& licenseText) { license = licenseText; InvalidateText(); }
     /// Gets the license text.
     const std::string& GetLicense() const { return license; }
 
@@ -523,50 +1170,2211 @@ public:
     std::string VersionNumToString(int major, int minor, int patch) const { return std::to_string(major) + "." + std::to_string(minor) + "." + std::to_string(patch); }
 
     /// Sets the version information.
-    void SetVersion(const std::string& versionInfo) { version = versionInfo; }
+    void SetVersion(const std::string& versionInfo) { version = versionInfo; InvalidateText(); }
     /// Gets the version information.
     const std::string& GetVersion() const { return version; }
     /// Sets the parser options for the argument handler.
-    void SetParserOptions(ParserOptions options) { parserOptions = options; }
+    /// Rebuilds the spec, as the prefixes and case folding depend on these options.
+    void SetParserOptions(ParserOptions options) {
+        parserOptions = options;
+        RebuildSpec(spec ? spec->GetCmdOptions() : std::vector<CmdOption>());
+    }
 
     /// Gets the current parser options.
-    void SetApplicationName(const std::string& name) { applicationName = name; }
+    void SetApplicationName(const std::string& name) { applicationName = name; InvalidateText(); }
     /// Gets the application name.
     const std::string& GetApplicationName() const { return applicationName; }
 
     /// Gets the current parser options.
     void SetVersionFooter(const std::string& footer) {
         versionFooter = footer;
+        InvalidateText();
     }
     /// Gets the version footer text.
     const std::string& GetVersionFooter() const {
         return versionFooter;
     }
+
+    /// Matcher of a Static parser, computed from the option table by constexpr functions.
+    /// Declared constexpr next to a constexpr table (see MakeStaticIndex), it is built by the compiler.
+    /// Every name is numbered (option ID << 1 | is long name) and filed under the bucket of its case-folded hash;
+    /// within a bucket names keep table order, so the first option declared under a name wins.
+    template<size_t N>
+    struct StaticIndex {
+        static const size_t Names = 2 * N;
+        static const size_t Buckets = ArghandNextPow2(Names);
+
+        uint32_t hashes[Names];         // Hash() of each name, 0 if the option lacks it
+        bool named[Names];              // Whether the option has each name
+        int32_t entries[Names];         // Name numbers grouped by bucket, -1 past the last name
+        uint32_t first[Buckets + 1];    // Start of each bucket in entries, first[Buckets] is the name count
+
+        /// FNV-1a hash of an option name with ASCII case folded, so IgnoreCase can share the index.
+        static constexpr uint32_t Hash(const char* name, uint32_t hash = 2166136261u) {
+            return *name ? Hash(name + 1, (hash ^ static_cast<unsigned char>(*name >= 'A' && *name <= 'Z' ? *name - 'A' + 'a' : *name)) * 16777619u) : hash;
+        }
+
+        /// Bucket of a name hash.
+        static constexpr uint32_t BucketOf(uint32_t hash) {
+            return hash & static_cast<uint32_t>(Buckets - 1);
+        }
+
+        // Build stages, each one a constant expression over the previous one
+        struct Hashed {
+            uint32_t hashes[Names];
+            bool named[Names];
+        };
+        struct Counted {
+            Hashed names;
+            uint32_t first[Buckets + 1];
+        };
+
+        static constexpr const char* NameOf(const StaticCmdOption* table, size_t name) {
+            return name & 1 ? table[name >> 1].long_name : table[name >> 1].short_name;
+        }
+
+        static constexpr bool IsNamed(const StaticCmdOption* table, size_t name) {
+            return NameOf(table, name) && *NameOf(table, name);
+        }
+
+        // Names in [lo, hi) filed under a bucket below `below`; splits the range so recursion stays log-deep
+        static constexpr uint32_t CountBelow(const Hashed& h, uint32_t below, size_t lo, size_t hi) {
+            return hi - lo == 1 ? (h.named[lo] && BucketOf(h.hashes[lo]) < below ? 1u : 0u)
+                                : CountBelow(h, below, lo, (lo + hi) / 2) + CountBelow(h, below, (lo + hi) / 2, hi);
+        }
+
+        // Names in [lo, hi) filed under bucket
+        static constexpr uint32_t CountIn(const Hashed& h, uint32_t bucket, size_t lo, size_t hi) {
+            return hi - lo == 1 ? (h.named[lo] && BucketOf(h.hashes[lo]) == bucket ? 1u : 0u)
+                                : CountIn(h, bucket, lo, (lo + hi) / 2) + CountIn(h, bucket, (lo + hi) / 2, hi);
+        }
+
+        // The n-th name in [lo, hi) filed under bucket
+        static constexpr int32_t NthIn(const Hashed& h, uint32_t bucket, uint32_t n, size_t lo, size_t hi) {
+            return hi - lo == 1 ? static_cast<int32_t>(lo)
+                 : CountIn(h, bucket, lo, (lo + hi) / 2) > n ? NthIn(h, bucket, n, lo, (lo + hi) / 2)
+                 : NthIn(h, bucket, n - CountIn(h, bucket, lo, (lo + hi) / 2), (lo + hi) / 2, hi);
+        }
+
+        // Bucket holding entry pos: the last bucket in [lo, hi) that starts at or before it
+        static constexpr uint32_t BucketAt(const Counted& c, uint32_t pos, uint32_t lo, uint32_t hi) {
+            return hi - lo == 1 ? lo
+                 : c.first[(lo + hi) / 2] <= pos ? BucketAt(c, pos, (lo + hi) / 2, hi) : BucketAt(c, pos, lo, (lo + hi) / 2);
+        }
+
+        static constexpr int32_t EntryIn(const Counted& c, uint32_t pos, uint32_t bucket) {
+            return NthIn(c.names, bucket, pos - c.first[bucket], 0, Names);
+        }
+
+        static constexpr int32_t EntryAt(const Counted& c, uint32_t pos) {
+            return pos < c.first[Buckets] ? EntryIn(c, pos, BucketAt(c, pos, 0, static_cast<uint32_t>(Buckets))) : -1;
+        }
+
+        template<size_t... I>
+        static constexpr Hashed HashNames(const StaticCmdOption* table, ArghandIndices<I...>) {
+            return Hashed{ { (IsNamed(table, I) ? Hash(NameOf(table, I)) : 0u)... }, { IsNamed(table, I)... } };
+        }
+
+        template<size_t... B>
+        static constexpr Counted CountBuckets(const Hashed& h, ArghandIndices<B...>) {
+            return Counted{ h, { CountBelow(h, static_cast<uint32_t>(B), 0, Names)... } };
+        }
+
+        template<size_t... I, size_t... B>
+        static constexpr StaticIndex Assemble(const Counted& c, ArghandIndices<I...>, ArghandIndices<B...>) {
+            return StaticIndex{ { c.names.hashes[I]... }, { c.names.named[I]... },
+                                { EntryAt(c, static_cast<uint32_t>(I))... }, { c.first[B]... } };
+        }
+
+        /// Builds the index of a table; a constant expression when the table is constexpr.
+        static constexpr StaticIndex Build(const StaticCmdOption* table) {
+            return Assemble(CountBuckets(HashNames(table, typename ArghandMakeIndices<Names>::type()),
+                                     typename ArghandMakeIndices<Buckets + 1>::type()),
+                        typename ArghandMakeIndices<Names>::type(), typename ArghandMakeIndices<Buckets + 1>::type());
+        }
+
+        /// Builds the same index as Build, with a counting sort at run time.
+        static StaticIndex Fill(const StaticCmdOption* table) {
+            StaticIndex index;
+            uint32_t next[Buckets + 1] = {};
+            for (size_t name = 0; name < Names; ++name) {
+                index.named[name] = IsNamed(table, name);
+                index.hashes[name] = index.named[name] ? Hash(NameOf(table, name)) : 0u;
+                index.entries[name] = -1;
+                if (index.named[name]) ++next[BucketOf(index.hashes[name]) + 1];
+            }
+            for (size_t bucket = 0; bucket < Buckets; ++bucket) next[bucket + 1] += next[bucket];
+            for (size_t bucket = 0; bucket <= Buckets; ++bucket) index.first[bucket] = next[bucket];
+            for (size_t name = 0; name < Names; ++name) {
+                if (index.named[name]) index.entries[next[BucketOf(index.hashes[name])]++] = static_cast<int32_t>(name);
+            }
+            return index;
+        }
+    };
+
+    /// Builds the matcher of a Static parser over a table.
+    /// Declare the result static constexpr to have the compiler build it, then pass it to MakeStatic.
+    template<size_t N>
+    static constexpr StaticIndex<N> MakeStaticIndex(const StaticCmdOption (&table)[N]) {
+        return StaticIndex<N>::Build(table);
+    }
+
+    /// Parser over a compile-time option table.
+    /// The table is a constexpr array of StaticCmdOption, and an option's ID is its index in that array.
+    /// The matcher is a StaticIndex built from the table at compile time when it is declared constexpr,
+    /// and the parse results live in fixed-size arrays sized from the table,
+    /// so neither construction nor parse() touch the heap, and nothing is printed.
+    /// Values point directly into argv or into the table's default values.
+    /// Usage:
+    ///     static constexpr StaticCmdOption table[] = { STATIC_CMD_OPTION("o", "output", InputDefault, "out.txt", "Output file") };
+    ///     static constexpr auto index = Arghand::MakeStaticIndex(table);
+    ///     auto parser = Arghand::MakeStatic(table, index);
+    ///     parser.parse(argc, argv);
+    ///     const char* output = parser.GetValue(0);
+    template<size_t N>
+    class Static {
+    public:
+        /// Returned by Find() when a token does not name an option
+        static const size_t npos = N;
+
+        /// Creates the parser over a table and its compile-time matcher.
+        /// @param table The option table, must outlive the parser
+        /// @param index The matcher of the table, from MakeStaticIndex(table)
+        /// @param options Parser options, only StyleUnix/StyleWindows, IgnoreCase and EndOfOptions affect matching
+        Static(const StaticCmdOption (&table)[N], const StaticIndex<N>& index, ParserOptions options = ParserOptions::DefaultOptions)
+            : table(table), index(index), parserOptions(options) {
+            bool use_unix_style = ParserOptionsExist(ParserOptions::StyleUnix);
+            prefix_lng = use_unix_style ? "--" : "/";
+            prefix_sht = use_unix_style ? "-" : "/";
+            prefix_lng_len = std::strlen(prefix_lng);
+            prefix_sht_len = std::strlen(prefix_sht);
+            fold = ParserOptionsExist(ParserOptions::IgnoreCase);
+            Reset();
+        }
+
+        /// Creates the parser over a table, building its matcher at startup.
+        /// Prefer passing a constexpr MakeStaticIndex(table), which is built by the compiler.
+        explicit Static(const StaticCmdOption (&table)[N], ParserOptions options = ParserOptions::DefaultOptions)
+            : Static(table, StaticIndex<N>::Fill(table), options) {
+        }
+
+        /// Parses command-line arguments into the fixed-size result table.
+        /// @param argc Number of command-line arguments
+        /// @param argv Array of command-line arguments, must outlive the results
+        /// @return ParseResult indicating the result of the parsing operation.
+        /// On SuccessWithHelp/SuccessWithVersion the caller prints the output, e.g. with PrintHelp().
+        ParseResult parse(int argc, char* argv[]) {
+            Reset();
+            for (int i = 1; i < argc; ++i) {
+                const char* arg = argv[i];
+                // Positional arguments are not kept, so nothing after "--" matters
+                if (arg[0] == '-' && arg[1] == '-' && arg[2] == '\0' && ParserOptionsExist(ParserOptions::EndOfOptions)) break;
+                size_t id = Find(arg);
+
+                if (id == npos) {
+                    if (IsPrefixed(arg)) {
+                        errorIndex = i;
+                        return ParseResult::Error;
+                    }
+                    continue;
+                }
+
+                const StaticCmdOption& option = table[id];
+                if (option.options & QSTU64(CmdOptionFlags::IsHelpOption)) return ParseResult::SuccessWithHelp;
+                if (option.options & QSTU64(CmdOptionFlags::IsVersionOption)) return ParseResult::SuccessWithVersion;
+
+                const char* value = option.DefaultValue;
+                if (option.options & (QSTU64(CmdOptionFlags::IsValueRequired) | QSTU64(CmdOptionFlags::IsList))) {
+                    if (i + 1 < argc && !IsPrefixed(argv[i + 1])) {
+                        value = argv[++i];
+                    }
+                    else if (!value || !*value) {
+                        errorIndex = i;
+                        return ParseResult::MissingValue;
+                    }
+                }
+                else if (option.options & QSTU64(CmdOptionFlags::IsRequired) && (!value || !*value)) {
+                    errorIndex = i;
+                    return ParseResult::MissingValue;
+                }
+
+                if (!present[id]) {
+                    present[id] = true;
+                    values[id] = value ? value : "";
+                }
+            }
+            return ParseResult::Success;
+        }
+
+        /// Resolves a token such as "--output" to its option ID.
+        /// @return The option ID, or npos if the token does not name an option.
+        size_t Find(const char* token) const {
+            bool is_long = std::strncmp(token, prefix_lng, prefix_lng_len) == 0;
+            bool is_short = std::strncmp(token, prefix_sht, prefix_sht_len) == 0;
+            // With one prefix for both ("/"), a name may be either kind and table order decides
+            if (is_long && is_short && prefix_lng_len == prefix_sht_len) return Lookup(token + prefix_lng_len, 3);
+
+            size_t id = is_long ? Lookup(token + prefix_lng_len, 2) : npos;
+            return id == npos && is_short ? Lookup(token + prefix_sht_len, 1) : id;
+        }
+
+        /// Checks if an option was given on the command line.
+        bool Has(size_t id) const { return id < N && present[id]; }
+
+        /// Gets the value of an option by its ID.
+        /// @return The parsed value, the option's default value if it was not given, or an empty string.
+        const char* GetValue(size_t id) const {
+            if (id >= N) return "";
+            if (present[id]) return values[id];
+            return table[id].DefaultValue ? table[id].DefaultValue : "";
+        }
+
+        /// Gets the argv index of the argument that caused the last Error/MissingValue result, or 0.
+        int GetErrorIndex() const { return errorIndex; }
+
+        /// Prints the option list of the table, one option per line, in a single write to stdout or output.
+        /// Descriptions start in one column past the longest option names, like Arghand's help.
+        void PrintHelp(const Output& output = Output()) const {
+            std::string text;
+            size_t column = 0;
+            for (size_t i = 0; i < N; ++i) {
+                AppendNames(text, table[i]);
+                column = std::max(column, text.size());
+                text.clear();
+            }
+            column += 4;
+            for (size_t i = 0; i < N; ++i) {
+                const StaticCmdOption& option = table[i];
+                size_t start = text.size();
+                AppendNames(text, option);
+                text.append(column - (text.size() - start), ' ');
+                text.append(option.description ? option.description : "");
+                if (option.DefaultValue && *option.DefaultValue) text.append(" | Default value: ").append(option.DefaultValue);
+                text += '\n';
+            }
+            output.Write(text);
+        }
+
+    private:
+        static char FoldChar(char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        // Same as StaticIndex::Hash, as a loop since tokens can be arbitrarily long
+        static uint32_t Hash(const char* str) {
+            uint32_t hash = 2166136261u;
+            for (; *str; ++str) {
+                hash ^= static_cast<unsigned char>(FoldChar(*str));
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        // Finds a name without its prefix among the short (kinds bit 0) and long (kinds bit 1) names
+        size_t Lookup(const char* name, unsigned kinds) const {
+            uint32_t hash = Hash(name);
+            uint32_t bucket = StaticIndex<N>::BucketOf(hash);
+            for (uint32_t pos = index.first[bucket]; pos < index.first[bucket + 1]; ++pos) {
+                int32_t entry = index.entries[pos];
+                if (!(kinds & (1u << (entry & 1))) || index.hashes[entry] != hash) continue;
+
+                const StaticCmdOption& option = table[entry >> 1];
+                if (Matches(name, "", (entry & 1) ? option.long_name : option.short_name)) {
+                    return static_cast<size_t>(entry >> 1);
+                }
+            }
+            return npos;
+        }
+
+        // Compares token against prefix + name without building the concatenation
+        bool Matches(const char* token, const char* prefix, const char* name) const {
+            for (; *prefix; ++prefix, ++token) {
+                if (*token != *prefix) return false;
+            }
+            for (; *name; ++name, ++token) {
+                if (!*token) return false;
+                if (fold ? FoldChar(*token) != FoldChar(*name) : *token != *name) return false;
+            }
+            return *token == '\0';
+        }
+
+        // Appends the names of an option as the help lists them
+        void AppendNames(std::string& text, const StaticCmdOption& option) const {
+            bool exists_short_name = option.short_name && *option.short_name;
+            bool exists_long_name = option.long_name && *option.long_name;
+            if (exists_short_name) text.append(prefix_sht).append(option.short_name);
+            else text += "    ";
+            if (exists_short_name && exists_long_name) text += ", ";
+            if (exists_long_name) text.append(prefix_lng).append(option.long_name);
+        }
+
+        bool IsPrefixed(const char* arg) const {
+            return std::strncmp(arg, prefix_sht, prefix_sht_len) == 0 ||
+                   std::strncmp(arg, prefix_lng, prefix_lng_len) == 0;
+        }
+
+        void Reset() {
+            for (size_t i = 0; i < N; ++i) {
+                present[i] = false;
+                values[i] = nullptr;
+            }
+            errorIndex = 0;
+        }
+
+        const StaticCmdOption* table;   // Option table, indexed by option ID
+        StaticIndex<N> index;           // Matcher over the table's names
+        ParserOptions parserOptions;    // Options for the argument parser
+        const char* prefix_lng;         // Long option prefix, "--" or "/"
+        const char* prefix_sht;         // Short option prefix, "-" or "/"
+        size_t prefix_lng_len;          // Length of prefix_lng
+        size_t prefix_sht_len;          // Length of prefix_sht
+        bool fold;                      // Fold ASCII case when matching
+        const char* values[N];          // Parsed values, indexed by option ID
+        bool present[N];                // Whether each option was given, indexed by option ID
+        int errorIndex;                 // argv index of the last offending argument
+    };
+
+    /// Creates a Static parser, deducing the option count from the table.
+    template<size_t N>
+    static Static<N> MakeStatic(const StaticCmdOption (&table)[N], ParserOptions options = ParserOptions::DefaultOptions) {
+        return Static<N>(table, options);
+    }
+
+    /// Creates a Static parser over a table and its compile-time matcher from MakeStaticIndex(table).
+    template<size_t N>
+    static Static<N> MakeStatic(const StaticCmdOption (&table)[N], const StaticIndex<N>& index, ParserOptions options = ParserOptions::DefaultOptions) {
+        return Static<N>(table, index, options);
+    }
     
 private:
-    /// Creates a vector of strings from command-line arguments.
-    std::vector<std::string> CreateVector(int argc, char* argv[]) {
-        std::vector<std::string> args;
-        for (int i = 0; i < argc; ++i) {
-            args.push_back(argv[i]);
+    /// Nanoseconds elapsed since start.
+    static uint64_t ElapsedNs(const std::chrono::steady_clock::time_point& start);
+
+    static bool IsDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+    /// Compares a value to a lowercase ASCII word, ignoring case.
+    static bool EqualsIgnoreCase(const ArgView& value, const char* word) {
+        size_t i = 0;
+        for (; i < value.size; ++i) {
+            char c = (value[i] >= 'A' && value[i] <= 'Z') ? static_cast<char>(value[i] - 'A' + 'a') : value[i];
+            if (!word[i] || c != word[i]) return false;
         }
-        return args;
+        return !word[i];
     }
 
-    char ListSeparator; // Character used to separate list values in options
-    std::vector<std::string> args;  // Vector to store command-line arguments
-    std::vector<CmdOption> cmdOptions;  // Vector to store command options
-    std::vector<ParsedOption> parsedOptions;    // Vector to store parsed options
+    /// Parses an optional sign and decimal digits from [c, end), stopping at the first other character.
+    /// @return Pointer past the digits (c itself if there are none), or null if the magnitude overflows 64 bits
+    static const char* ParseDecimal(const char* c, const char* end, bool& negative, uint64_t& magnitude);
+
+    /// Stores a parsed sign and magnitude in an integer of any type, checking its range.
+    template<typename T>
+    static ConvertResult StoreInteger(bool negative, uint64_t magnitude, T& out) {
+        if (negative && magnitude != 0) {
+            if (!std::is_signed<T>::value) return ConvertResult::OutOfRange;
+            uint64_t limit = static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1;
+            if (magnitude > limit) return ConvertResult::OutOfRange;
+            out = static_cast<T>(-static_cast<int64_t>(magnitude - 1) - 1);
+            return ConvertResult::Success;
+        }
+        if (magnitude > static_cast<uint64_t>(std::numeric_limits<T>::max())) return ConvertResult::OutOfRange;
+        out = static_cast<T>(magnitude);
+        return ConvertResult::Success;
+    }
 
-    std::string applicationName;    // Name of the application for help and version output
-    std::string helpHeader;     // Header text for help output
-    std::string helpFooter;     // Footer text for help output
-    std::string license;        // License text for the application
-    std::string version;        // Version information for the application
-    std::string versionFooter;  // Footer text for version output
+    /// Parses an unsigned decimal number with an optional fraction, as whole + fraction / scale.
+    /// Fraction digits beyond 18 are ignored.
+    /// @return Pointer past the number (c itself if there is none), or null if the whole part overflows 64 bits
+    static const char* ParseNumber(const char* c, const char* end, uint64_t& whole, uint64_t& fraction, uint64_t& scale);
+
+    /// Computes a * b / c, truncated, for a < c < 2^62. The 128-bit product is never formed: b is
+    /// multiplied in bit by bit, keeping the quotient and a remainder below c.
+    static uint64_t MulDiv(uint64_t a, uint64_t b, uint64_t c) {
+        uint64_t quotient = 0, remainder = 0;
+        for (int bit = 63; bit >= 0; --bit) {
+            quotient <<= 1;
+            remainder <<= 1;
+            if (remainder >= c) { remainder -= c; ++quotient; }
+            if ((b >> bit) & 1) {
+                remainder += a;
+                if (remainder >= c) { remainder -= c; ++quotient; }
+            }
+        }
+        return quotient;
+    }
+
+    /// Computes (whole + fraction / scale) * multiplier exactly, truncated.
+    /// @return False if the result overflows 64 bits
+    static bool Scale(uint64_t whole, uint64_t fraction, uint64_t scale, uint64_t multiplier, uint64_t& out) {
+        if (whole > std::numeric_limits<uint64_t>::max() / multiplier) return false;
+        uint64_t result = whole * multiplier;
+        uint64_t part = fraction ? MulDiv(fraction, multiplier, scale) : 0;
+        if (part > std::numeric_limits<uint64_t>::max() - result) return false;
+        out = result + part;
+        return true;
+    }
+
+    /// Decimal number on a fixed buffer of digits, for the correctly rounded slow path of Convert(value, double&)
+    class Decimal;
+
+    /// Strings stored back to back in one buffer and referred to by offset and size, so a table of
+    /// thousands of names is one allocation instead of one per name. Intern stores equal strings once.
+    /// Views from Get stay valid until the next Append or Intern.
+    class StringPool {
+    public:
+        /// A string in the pool
+        struct Ref {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        /// Removes all strings.
+        void Clear() {
+            text.clear();
+            slots.clear();
+            interned = 0;
+        }
+
+        /// Reserves room for bytes more characters.
+        void Reserve(size_t bytes) { text.reserve(text.size() + bytes); }
+
+        /// Appends prefix followed by str, case-folded if fold_case, without looking for an equal string.
+        Ref Append(const ArgView& prefix, const ArgView& str, bool fold_case = false);
+
+        /// Stores str unless an equal string was interned before.
+        Ref Intern(const ArgView& str);
+
+        /// Drops the interning table once all strings are stored, and trims the buffer if much of it is unused.
+        void Seal() {
+            std::vector<Ref>().swap(slots);
+            if (text.capacity() - text.size() > text.size() / 4) text.shrink_to_fit();
+        }
+
+        /// Drops the strings appended since size was size().
+        void Truncate(size_t size) { text.resize(size); }
+
+        ArgView Get(Ref ref) const { return ArgView(text.data() + ref.offset, ref.size); }
+        size_t size() const { return text.size(); }
+
+        static char FoldChar(char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        // FNV-1a, optionally folding ASCII case on the fly
+        static uint32_t Hash(const char* data, size_t length, bool fold_case) {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < length; ++i) {
+                hash ^= static_cast<unsigned char>(fold_case ? FoldChar(data[i]) : data[i]);
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+    private:
+        static Ref EmptySlot() {
+            Ref ref;
+            ref.offset = UINT32_MAX;
+            ref.size = 0;
+            return ref;
+        }
+
+        void Place(const Ref& ref) {
+            ArgView str = Get(ref);
+            size_t mask = slots.size() - 1;
+            size_t pos = Hash(str.data, str.size, false) & mask;
+            while (slots[pos].offset != EmptySlot().offset) pos = (pos + 1) & mask;
+            slots[pos] = ref;
+        }
+
+        std::string text;               // All strings, back to back
+        std::vector<Ref> slots;         // Open-addressed table of the interned strings, dropped by Seal
+        size_t interned = 0;            // Strings in slots
+    };
+
+    /// Hash index mapping prefixed option names (e.g. "--output", "-o") to their option ID.
+    /// Keys are stored already prefixed and, with IgnoreCase, already case-folded, in one pool,
+    /// so resolving an argument hashes it once and never allocates. Slots carry the hash, so
+    /// probing only reads a key on a hash match.
+    class OptionIndex {
+    public:
+        /// Removes all keys and sets whether lookups fold ASCII case.
+        void Reset(bool fold_case) {
+            fold = fold_case;
+            keys.Clear();
+            entries.clear();
+            slots.clear();
+            mask = 0;
+        }
+
+        /// Adds a key for the given option id. Empty names are skipped and
+        /// the first option registered under a key wins, like the old linear scan.
+        void Insert(const ArgView& prefix, const ArgView& name, int32_t id);
+
+        /// Reserves room for count keys of bytes characters in total, prefixes included,
+        /// so that inserting them allocates nothing more.
+        void Reserve(size_t count, size_t bytes) {
+            keys.Reserve(bytes);
+            entries.reserve(entries.size() + count);
+            size_t capacity = 16;
+            while (capacity < (entries.size() + count) * 2) capacity *= 2;
+            if (capacity > slots.size()) Rehash(capacity);
+        }
+
+        /// Checks if the index has no keys.
+        bool empty() const { return entries.empty(); }
+
+        /// Looks up an argument.
+        /// @return The option id, or -1 if the argument does not name an option.
+        int32_t Find(const char* token, size_t length) const;
+
+    private:
+        struct Entry {
+            StringPool::Ref key;
+            int32_t id;
+        };
+
+        struct Slot {
+            uint32_t hash;      // Hash of the key, compared before the key itself
+            int32_t entry;      // Index into entries, -1 if empty
+        };
+
+        bool Equals(const ArgView& key, const char* token, size_t length) const {
+            if (key.size != length) return false;
+            for (size_t i = 0; i < length; ++i) {
+                char c = fold ? StringPool::FoldChar(token[i]) : token[i];
+                if (key.data[i] != c) return false;
+            }
+            return true;
+        }
+
+        void Place(int32_t index) {
+            ArgView key = keys.Get(entries[index].key);
+            Slot slot;
+            slot.hash = StringPool::Hash(key.data, key.size, false);
+            slot.entry = index;
+            size_t pos = slot.hash & mask;
+            while (slots[pos].entry >= 0) pos = (pos + 1) & mask;
+            slots[pos] = slot;
+        }
+
+        void Rehash(size_t capacity);
+
+        StringPool keys;                // Keys, prefixed and folded
+        std::vector<Entry> entries;     // Keys in insertion order
+        std::vector<Slot> slots;        // Open-addressed table of entries
+        size_t mask = 0;                // slots.size() - 1, slots.size() is a power of two
+        bool fold = false;              // Fold ASCII case when hashing and comparing arguments
+    };
+
+    /// Compressed trie over long option names, for unambiguous prefixes and spelling suggestions.
+    /// Nodes are stored flat, the children of a node next to each other and sorted by their first character,
+    /// and edge labels point into one pool of the names.
+    class NameTrie {
+    public:
+        /// Result of FindPrefix for a prefix shared by several names
+        static const int32_t Ambiguous = -2;
+
+        /// Builds the trie from names with their option IDs. Empty names are skipped and the first ID of a name wins.
+        void Build(const std::vector<std::pair<ArgView, int32_t>>& names, bool fold_case);
+
+        /// Checks if the trie holds no names.
+        bool empty() const { return keys.empty(); }
+
+        /// Finds the option whose name starts with token, in O(token length).
+        /// @return The option ID, Ambiguous if several names start with token, or -1 if none does.
+        int32_t FindPrefix(const char* token, size_t length) const {
+            int32_t node = Walk(token, length);
+            return node < 0 ? -1 : nodes[node].unique;
+        }
+
+        /// Appends the IDs of up to limit names starting with token, in name order.
+        void Candidates(const char* token, size_t length, size_t limit, std::vector<int32_t>& out) const {
+            int32_t node = Walk(token, length);
+            if (node >= 0) Collect(node, limit, out);
+        }
+
+        /// Appends the IDs of up to limit names within maxDistance edits of token, all at the closest distance.
+        /// Walks the trie with one edit distance row per character and prunes subtrees that cannot
+        /// come within maxDistance, so only names close to the token are visited.
+        void Suggest(const char* token, size_t length, size_t maxDistance, size_t limit, std::vector<int32_t>& out) const;
+
+    private:
+        struct Key {
+            uint32_t offset;    // Name in pool
+            uint32_t size;
+            int32_t id;         // Option ID
+            uint32_t order;     // Insertion order, the first of equal names wins
+        };
+
+        struct Node {
+            uint32_t label = 0;         // Edge label leading to this node, in pool
+            uint32_t labelSize = 0;
+            uint32_t firstChild = 0;    // Children are nodes[firstChild, firstChild + childCount)
+            uint32_t childCount = 0;
+            int32_t id = -1;            // Option whose name ends here, or -1
+            int32_t unique = -1;        // The only option in this subtree, Ambiguous, or -1 if there is none
+            char first = 0;             // First character of the label, kept here for the child search
+        };
+
+        static char FoldChar(char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        char At(const Key& key, size_t i) const { return pool[key.offset + i]; }
+
+        int Compare(const Key& a, const Key& b) const {
+            int cmp = pool.compare(a.offset, a.size, pool, b.offset, b.size);
+            return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+        }
+
+        /// Fills node from the sorted keys [first, last), which share their first depth characters.
+        void Fill(size_t node, size_t first, size_t last, size_t depth);
+
+        /// Follows token from the root.
+        /// @return The node at or below which every name starting with token ends, or -1.
+        int32_t Walk(const char* token, size_t length) const;
+
+        void Collect(size_t node, size_t limit, std::vector<int32_t>& out) const {
+            if (out.size() >= limit) return;
+            if (nodes[node].id >= 0) out.push_back(nodes[node].id);
+            for (uint32_t c = 0; c < nodes[node].childCount; ++c) {
+                Collect(nodes[node].firstChild + c, limit, out);
+            }
+        }
+
+        /// Extends the edit distance rows along the children of node, whose row is rows[depth].
+        /// maxDistance drops to the closest distance found, as only the closest names are suggested.
+        void SuggestFrom(size_t node, size_t depth, const char* token, size_t length, uint32_t& maxDistance,
+                         std::vector<uint32_t>& rows, std::vector<std::pair<uint32_t, int32_t>>& found) const;
+
+        std::string pool;               // All names, labels point into it
+        std::vector<Key> keys;          // Names sorted, the trie is built over them
+        std::vector<Node> nodes;        // Node 0 is the root
+        size_t maxLength = 0;           // Longest name, the depth of the edit distance rows
+        bool fold = false;              // Fold ASCII case of names and tokens
+    };
+
+    /// Compact form of the command options, indexed by option ID. The fields matching reads, flags and
+    /// default values, sit in parallel arrays, names and defaults are interned into one pool, and the
+    /// fields only help and the config layers read are kept apart, so that matching a token against
+    /// thousands of options touches a few cache lines instead of the heap blocks of each CmdOption.
+    class OptionTable {
+    public:
+        /// Builds the table from options.
+        void Build(const std::vector<CmdOption>& options);
+
+        size_t size() const { return flags.size(); }
+
+        uint64_t Flags(int32_t id) const { return flags[id]; }
+        ArgView DefaultValue(int32_t id) const { return text.Get(defaults[id]); }
+        ArgView ShortName(int32_t id) const { return text.Get(shortNames[id]); }
+        ArgView LongName(int32_t id) const { return text.Get(longNames[id]); }
+        ArgView Description(int32_t id) const { return coldText.Get(cold[id].description); }
+        ArgView Environment(int32_t id) const { return coldText.Get(cold[id].environment); }
+        ArgView ConfigKey(int32_t id) const { return coldText.Get(cold[id].configKey); }
+        ArgView Allowed(int32_t id) const { return coldText.Get(cold[id].allowed); }
+
+        /// Rebuilds the CmdOption the table was built from.
+        CmdOption GetCmdOption(int32_t id) const;
+
+    private:
+        /// Fields that matching never reads
+        struct Cold {
+            StringPool::Ref name;           // CmdOption::name, if customName
+            StringPool::Ref description;
+            StringPool::Ref environment;
+            StringPool::Ref configKey;
+            StringPool::Ref allowed;
+            bool customName;                // CmdOption::name is not "<short_name>,<long_name>"
+        };
+
+        // Hot, read for every matched option
+        std::vector<uint64_t> flags;                // CmdOption::options
+        std::vector<StringPool::Ref> defaults;      // CmdOption::DefaultValue in text
+        // Warm, read to build the indices and for error hints
+        std::vector<StringPool::Ref> shortNames;    // CmdOption::short_name in text
+        std::vector<StringPool::Ref> longNames;     // CmdOption::long_name in text
+        StringPool text;                            // Names and default values
+        // Cold
+        std::vector<Cold> cold;
+        StringPool coldText;                        // Descriptions, environment variables, config keys and allowed values
+    };
+
+    /// Maximum nesting of @response files, guards against files that include themselves
+    static const int MaxResponseFileDepth = 16;
+
+    /// Read-only memory mapping of a whole file
+    class MappedFile;
+
+    /// Standard allocator over a MemoryResource, or over the heap without one.
+    /// An exhausted resource throws std::bad_alloc, which the parse turns into DiagnosticCode::MemoryExhausted.
+    template<typename T>
+    struct MemoryAllocator {
+        typedef T value_type;
+        // Containers take the resource along when moved, so a result can switch resources
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        MemoryAllocator(MemoryResource* resource = nullptr) : memory(resource) {}
+        template<typename U>
+        MemoryAllocator(const MemoryAllocator<U>& other) : memory(other.memory) {}
+
+        T* allocate(size_t count) {
+            if (!memory) return static_cast<T*>(::operator new(count * sizeof(T)));
+            void* p = memory->Allocate(count * sizeof(T), alignof(T));
+            if (!p) throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+        void deallocate(T* p, size_t) {
+            if (!memory) ::operator delete(p);
+        }
+
+        template<typename U>
+        bool operator==(const MemoryAllocator<U>& other) const { return memory == other.memory; }
+        template<typename U>
+        bool operator!=(const MemoryAllocator<U>& other) const { return memory != other.memory; }
+
+        MemoryResource* memory;     // Resource, or null for the heap
+    };
+
+    /// Vector allocating from a MemoryResource, see MemoryAllocator
+    template<typename T>
+    using MemoryVector = std::vector<T, MemoryAllocator<T>>;
+
+    /// Chunked storage for tokens that had to be rewritten, e.g. to remove quotes.
+    /// Chunks are never moved, so views into the arena stay valid until Clear(), which keeps them
+    /// for the next tokens. With a memory resource the tokens come from it instead.
+    class TokenArena {
+    public:
+        /// Reserves size bytes of stable storage.
+        char* Allocate(size_t size);
+
+        /// Returns the unused tail of the last allocation to the arena.
+        void Shrink(size_t unused) {
+            if (!memory) used -= unused;
+        }
+
+        /// Checks if p points into a chunk of the arena, tokens of a memory resource are not found.
+        bool Owns(const char* p) const {
+            for (const Chunk& chunk : chunks) {
+                if (p >= chunk.data.get() && p < chunk.data.get() + chunk.size) return true;
+            }
+            return false;
+        }
+
+        /// Releases all tokens, keeping the chunks.
+        void Clear() {
+            current = 0;
+            used = 0;
+        }
+
+        size_t allocations = 0;         // Chunks allocated over the arena's lifetime
+        size_t allocatedBytes = 0;      // Bytes of those chunks
+        MemoryResource* memory = nullptr;   // Resource tokens come from instead of the chunks, or null
+
+    private:
+        static const size_t ChunkSize = 64 * 1024;
+        struct Chunk {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+        std::vector<Chunk> chunks;
+        size_t current = 0;     // Chunk being allocated from
+        size_t used = 0;        // Bytes used in it
+    };
+
+    /// Lazy tokenizer for response files and command strings
+    class ArgTokenizer;
+
+    /// Structured error reporting of a Result or a Stream, replacing the messages once configured
+    struct Diagnostics {
+        std::vector<Diagnostic> records;    // Records of the last parse, reserved to capacity
+        size_t capacity = 0;                // Records kept per parse
+        size_t dropped = 0;                 // Records of the last parse beyond capacity
+        DiagnosticCallback callback;        // Called for every record, or empty
+        bool quiet = false;                 // Report nothing at all
+
+        bool Active() const { return capacity || callback || quiet; }
+
+        /// Starts a parse, keeping the capacity of the records.
+        void Clear() {
+            records.clear();
+            dropped = 0;
+        }
+
+        /// Keeps and delivers one record, without allocating once the records are reserved.
+        void Add(const Diagnostic& diagnostic) {
+            if (quiet) return;
+            if (records.size() < capacity) records.push_back(diagnostic);
+            else if (capacity) ++dropped;
+            if (callback) callback(diagnostic);
+        }
+
+        /// Takes over how other reports, not its records.
+        void Configure(const Diagnostics& other) {
+            capacity = other.capacity;
+            records.reserve(capacity);
+            callback = other.callback;
+            quiet = other.quiet;
+        }
+    };
+
+    /// State of the argument matcher between two tokens
+    struct MatchState {
+        ArgView prefix_lng;     // Long option prefix, "--" or "/"
+        ArgView prefix_sht;     // Short option prefix, "-" or "/"
+        int32_t pending;        // Option waiting for its value in the next token, or -1
+        ArgView pendingArg;     // The argument that named the pending option, for error messages
+        size_t index;           // Index of the argument being matched, for diagnostics
+        size_t pendingIndex;    // Index of pendingArg
+        TokenArena* arena;      // Storage for rewritten response file tokens
+        bool windowsQuoting;    // Tokenize response files and command strings with Windows quoting rules
+        std::vector<std::shared_ptr<MappedFile>>* files;   // Keeps expanded response files mapped, or null to unmap them right away
+        ParseStats* stats;      // Receives match timings and counts, or null
+        const TraceCallback* trace;     // Called for every token, or null
+        Diagnostics* diagnostics;   // Receives error records instead of any message, or null
+        bool dispatch;          // The next positional argument may name a subcommand
+        int32_t command;        // Subcommand the parse stopped at, or -1
+        bool endOfOptions;      // A "--" was matched, the arguments from here on are positional
+        size_t positionals;     // Positional arguments matched, the next one goes to this positional slot
+    };
+
+    /// Receives what the matcher recognizes, one option or positional argument at a time
+    class MatchSink {
+    public:
+        virtual ~MatchSink() {}
+        /// An option together with its value, or its default value, or an empty value for flags.
+        /// @return False if the value of a typed option does not convert, which ends the parse.
+        virtual bool OnOption(int32_t id, const ArgView& value, bool is_list) = 0;
+        /// An argument that is neither an option nor an option value, with the tail slot taking it or -1.
+        /// @return False if the value does not convert for a typed tail, which ends the parse.
+        virtual bool OnPositional(const ArgView& arg, int32_t tail) = 0;
+    };
+
+    /// Range of views belonging to one option, either a parse result or its default value.
+    struct ParsedView {
+        int32_t id;         // Option ID
+        uint32_t first;     // First view in valueViews (or defaultViews)
+        uint32_t count;     // Number of views
+        uint32_t typed;     // First converted value in typedValues (or typedDefaults)
+        uint32_t typedCount;    // Number of converted values, 0 for untyped options
+        ArgView raw;        // The unsplit value
+    };
+
+    /// Splits a value on the separator into views over the same characters, like ToList.
+    template<typename Vector>
+    static void SplitViews(const ArgView& value, char separator, Vector& out) {
+        const char* end = value.end();
+        for (const char* first = value.begin();; ) {
+            const char* last = ArghandFindChar(first, end, separator);
+            out.push_back(ArgView(first, static_cast<size_t>(last - first)));
+            if (last == end) break;
+            first = last + 1;
+        }
+    }
+
+    /// Shared empty results for unknown options
+    static const std::string& EmptyString() {
+        static const std::string empty;
+        return empty;
+    }
+    static const std::vector<std::string>& EmptyValues() {
+        static const std::vector<std::string> empty;
+        return empty;
+    }
+
+    /// Query result of one option, indexed by option ID
+    struct OptionResult {
+        TypedValue scalar;                          // First converted value, zero for untyped options
+        const TypedValue* typed;                    // Converted values
+        uint32_t typedCount;
+        ArgViewList views;                          // Parsed values, or the split default value
+        ArgSplitView list;                          // Unsplit parsed or default value, split lazily by GetListView
+        const std::vector<std::string>* values;     // Owning parsed values, or defaultValues of the option, null if given in a zero-copy parse
+        const std::string* value;                   // First owning parsed value, or the raw default value, null if given in a zero-copy parse
+        bool present;                               // Whether the option was given on the command line
+    };
+
+public:
+    /// Parsed INI-style config file: "key = value" lines, optionally under "[section]" headers, whose keys
+    /// become "section.key". Lines starting with '#' or ';' are comments, values may be quoted, and the
+    /// last assignment of a key wins. The text is mapped and scanned in one pass.
+    /// With a snapshot path, the parsed form is also written to a compact binary snapshot stamped with the
+    /// file's modification time and size. Later loads map the snapshot instead of parsing while the stamp
+    /// still matches, so large config files are not parsed again on every start.
+    /// Usage:
+    ///     handler.LoadConfig("tool.ini", "tool.ini.cache");
+    class Config {
+    public:
+        Config() : table(nullptr), count(0), text(""), snapshotUsed(false) {}
+        Config(const Config&) = delete;
+        Config& operator=(const Config&) = delete;
+
+        /// Loads a config file, from its snapshot if that is current.
+        /// @param path The config file
+        /// @param snapshot Path of the binary snapshot to use and refresh, or empty for none.
+        ///                 A missing, stale or unwritable snapshot only costs the parse.
+        /// @return False if the config file cannot be read.
+        bool Load(const std::string& path, const std::string& snapshot = std::string());
+
+        /// Parses config text, replacing what was loaded.
+        void Parse(const ArgView& content);
+
+        /// Looks up a key, "key" or "section.key".
+        /// @return False if the key is not set.
+        bool Find(const ArgView& key, ArgView& value) const;
+
+        /// Gets the number of keys.
+        size_t size() const { return count; }
+        /// Checks if the last Load was served from the snapshot.
+        bool FromSnapshot() const { return snapshotUsed; }
+
+    private:
+        /// A key and its value, as offsets into the text
+        struct Entry {
+            uint32_t key;
+            uint32_t keySize;
+            uint32_t value;
+            uint32_t valueSize;
+        };
+
+        /// Fixed header of a snapshot, followed by count entries and poolSize bytes of text
+        struct SnapshotHeader {
+            uint32_t magic;         // SnapshotMagic, also rejects snapshots of the other byte order
+            uint32_t version;       // SnapshotVersion
+            int64_t mtime;          // Modification time of the config file
+            uint64_t sourceSize;    // Size of the config file
+            uint64_t count;
+            uint64_t poolSize;
+        };
+        static const uint32_t SnapshotMagic = 0x53434841;  // "AHCS"
+        static const uint32_t SnapshotVersion = 1;
+
+        static ArgView Key(const char* base, const Entry& entry) { return ArgView(base + entry.key, entry.keySize); }
+
+        static ArgView Trim(ArgView view) {
+            while (view.size && (view[0] == ' ' || view[0] == '\t')) view = ArgView(view.data + 1, view.size - 1);
+            while (view.size && (view[view.size - 1] == ' ' || view[view.size - 1] == '\t' || view[view.size - 1] == '\r')) view.size--;
+            return view;
+        }
+
+        void Clear() {
+            pool.clear();
+            entries.clear();
+            snapshot.reset();
+            snapshotUsed = false;
+            Publish(nullptr, 0, "");
+        }
+
+        void Publish(const Entry* first, size_t size, const char* base) {
+            table = first;
+            count = size;
+            text = base;
+        }
+
+        /// Gets the modification time and size of a file.
+        static bool FileStamp(const std::string& path, int64_t& mtime, uint64_t& size);
+
+        /// Maps a snapshot and serves lookups from it if it matches the config file's stamp.
+        bool LoadSnapshot(const std::string& path, int64_t mtime, uint64_t size);
+
+        /// Writes the parsed form next to a temporary name and renames it into place, so readers
+        /// never map a half-written snapshot. Failures are ignored, the next load parses again.
+        void SaveSnapshot(const std::string& path, int64_t mtime, uint64_t size) const;
+
+        std::string pool;                   // Keys and values of a parsed file
+        std::vector<Entry> entries;         // Sorted entries of a parsed file
+        std::shared_ptr<MappedFile> snapshot;   // Mapped snapshot the table points into, if loaded from one
+        const Entry* table;                 // Sorted entries, from entries or the snapshot
+        size_t count;                       // Number of entries in table
+        const char* text;                   // Base of the entry offsets, pool or the snapshot
+        bool snapshotUsed;                  // The last Load used the snapshot
+    };
+
+    /// Compiled option definition: the options, parser options and list separator, together with
+    /// the lookup indices and split defaults built from them. A Spec is immutable once constructed,
+    /// and parse() is const and reentrant, so one Spec can be shared by reference across threads,
+    /// each parsing into its own Result. Nothing is printed, help and version are left to the caller.
+    /// Usage:
+    ///     const Arghand::Spec spec(options, ParserOptions::DefaultOptions, ',');
+    ///     Arghand::Result result;                 // e.g. one per thread, reused across parses
+    ///     spec.parse(argc, argv, result);
+    ///     if (result["output"]) ... result.GetValue("output") ...
+    class Spec {
+    public:
+        /// Compiles a spec.
+        /// @param options The command options
+        /// @param parser_options Parser options controlling matching and parse modes
+        /// @param separator The list separator
+        /// @param commands Subcommand names. A parse stops at the first positional argument naming one, see Result::GetCommand
+        /// @param config Config file for options with a configKey, or null. Read during construction only.
+        /// Options with an environment variable read it here, so the environment is sampled once per spec.
+        explicit Spec(const std::vector<CmdOption>& options, ParserOptions parser_options = ParserOptions::DefaultOptions, char separator = ',',
+                      const std::vector<std::string>& commands = std::vector<std::string>(), const Config* config = nullptr);
+        // Views into the spec's own strings make copies unsafe, share it by reference or shared_ptr instead
+        Spec(const Spec&) = delete;
+        Spec& operator=(const Spec&) = delete;
+
+        /// Parses command-line arguments into result, reusing its buffers.
+        /// Safe to call concurrently as long as every call uses a different Result.
+        /// @param argc Number of command-line arguments
+        /// @param argv Array of command-line arguments
+        /// @param result Receives the parsed options, cleared first
+        /// @return ParseResult indicating the result of the parsing operation
+        ParseResult parse(int argc, char* argv[], Result& result) const;
+
+        /// Parses a command string, such as one read from a socket or queue, into result.
+        /// The string is split like a shell would, with Windows quoting rules if the spec has
+        /// ParserOptions::StyleWindows. It holds only the arguments, no program name.
+        /// Plain tokens are views into command, quoted ones are unquoted into the result, so with
+        /// ParserOptions::ZeroCopy command must outlive the result.
+        /// @param command The command string
+        /// @param result Receives the parsed options, cleared first
+        /// @return ParseResult indicating the result of the parsing operation
+        ParseResult parse(const ArgView& command, Result& result) const;
+
+        /// Parses arguments that are already split, without the program name, into result.
+        /// @param args The arguments, they must outlive the result with ParserOptions::ZeroCopy
+        /// @param result Receives the parsed options, cleared first
+        /// @return ParseResult indicating the result of the parsing operation
+        ParseResult parse(const ArgViewList& args, Result& result) const;
+
+        /// Gets the size of a MonotonicBuffer that holds everything parse(argc, argv, result) takes from
+        /// the memory resource of the result, whatever the alignment of the buffer.
+        /// Runs the parse once into a result of its own, nothing is printed.
+        size_t RequiredMemory(int argc, char* argv[]) const {
+            return MeasureMemory([&](Result& result) { parse(argc, argv, result); });
+        }
+        /// Gets the memory parse(command, result) needs, see RequiredMemory(argc, argv).
+        size_t RequiredMemory(const ArgView& command) const {
+            return MeasureMemory([&](Result& result) { parse(command, result); });
+        }
+        /// Gets the memory parse(args, result) needs, see RequiredMemory(argc, argv).
+        size_t RequiredMemory(const ArgViewList& args) const {
+            return MeasureMemory([&](Result& result) { parse(args, result); });
+        }
+
+        /// Parses many argument vectors on a thread pool, e.g. to validate stored command lines.
+        /// Each worker reuses one Result, nothing is printed, and the first error of an item is returned as
+        /// BatchResult::diagnostic, so failing items allocate no message. At most one thread per 256 items
+        /// is used, as handing out smaller shares costs more than parsing them.
+        /// Without a visitor values are not copied out of the arguments, whatever ParserOptions::ZeroCopy says.
+        /// @param argvs The argument vectors, each without the program name
+        /// @param count Number of argument vectors
+        /// @param threads Number of worker threads including the caller, 0 for one per core
+        /// @param visitor Optional callback for each parsed item, called concurrently from the workers
+        /// @return One BatchResult per argument vector, in input order
+        std::vector<BatchResult> ParseBatch(const ArgViewList* argvs, size_t count, unsigned threads = 0, const BatchVisitor& visitor = BatchVisitor()) const;
+
+        /// Parses many command strings on a thread pool, see ParseBatch(argvs, ...) and parse(command, result).
+        /// @param commands The command strings, each without the program name
+        std::vector<BatchResult> ParseBatch(const ArgView* commands, size_t count, unsigned threads = 0, const BatchVisitor& visitor = BatchVisitor()) const;
+
+        /// Gets the handle of an option by its name.
+        /// @param name The name of the option (can be short or long name)
+        /// @return The option ID, or -1 if no option has that name.
+        OptionId GetOptionId(const ArgView& name) const {
+            return nameIndex.Find(name.data, name.size);
+        }
+
+        /// Renders a diagnostic of a parse with this spec as the message it replaces, e.g.
+        /// "Unknown option: --outptu, did you mean --output?". Hints are only computed here.
+        std::string FormatDiagnostic(const Diagnostic& diagnostic) const {
+            MatchState state;
+            InitMatchState(state, nullptr, nullptr);
+            return FormatDiagnostic(diagnostic, state);
+        }
+
+        /// Gets the command options of the spec.
+        /// The spec keeps them in compact form and rebuilds this vector on the first call.
+        const std::vector<CmdOption>& GetCmdOptions() const {
+            std::call_once(cmdOptionsOnce, [this]() {
+                cmdOptions.reserve(table.size());
+                for (size_t i = 0; i < table.size(); ++i) {
+                    cmdOptions.push_back(table.GetCmdOption(static_cast<int32_t>(i)));
+                }
+            });
+            return cmdOptions;
+        }
+        /// Gets the parser options of the spec.
+        ParserOptions GetParserOptions() const { return parserOptions; }
+        /// Gets the list separator of the spec.
+        char GetSeparator() const { return ListSeparator; }
+
+    private:
+        friend class Result;
+        friend class Stream;
+        friend class Session;
+
+        /// Rebuilds the option lookup index from the option table and parserOptions.
+        void BuildOptionIndex();
+
+        /// Gets the long option names with their IDs, without the positional slots.
+        std::vector<std::pair<ArgView, int32_t>> LongNames() const {
+            std::vector<std::pair<ArgView, int32_t>> names;
+            names.reserve(table.size());
+            for (size_t i = 0; i < table.size(); ++i) {
+                if (IsPositional(static_cast<int32_t>(i))) continue;
+                names.push_back(std::make_pair(table.LongName(static_cast<int32_t>(i)), static_cast<int32_t>(i)));
+            }
+            return names;
+        }
+
+        bool IsPositional(int32_t id) const {
+            return (table.Flags(id) & QSTU64(CmdOptionFlags::IsPositional)) != 0;
+        }
+
+        /// Collects the positional slots in declaration order, the last IsList one being the tail.
+        void BuildPositionalSlots();
+
+        /// Picks the value of every option for when it is not on the command line: its environment
+        /// variable if set, else its config key if present, else its default value.
+        void ResolveSources(const Config* config);
+
+        /// Reads an environment variable.
+        /// @return False if it is not set.
+        static bool ReadEnvironment(const std::string& name, std::string& value);
+
+        /// Pre-splits the fallback value of every option into defaultViews and defaultValues, once per spec.
+        void BuildDefaultViews();
+
+        /// Flags that declare a typed option
+        static const uint64_t TypeFlags = QSTU64(CmdOptionFlags::IsInteger) | QSTU64(CmdOptionFlags::IsDouble) |
+                                          QSTU64(CmdOptionFlags::IsBoolean) | QSTU64(CmdOptionFlags::IsEnum);
+
+        /// Allowed values of a typed option, parsed from CmdOption::allowed
+        struct TypeRule {
+            int64_t minInteger;
+            int64_t maxInteger;
+            double minReal;
+            double maxReal;
+            uint32_t firstChoice;   // First name of an IsEnum option in choices
+            uint32_t choiceCount;
+        };
+
+        /// Parses the allowed values of the typed options, if there are any.
+        /// Bounds that do not convert are ignored, as if not given.
+        void BuildTypeRules();
+
+        /// Converts one value of a typed option and checks it against its allowed values.
+        ConvertResult ConvertValue(int32_t id, const ArgView& text, TypedValue& out) const;
+
+        static bool SameName(const ArgView& name, const ArgView& text, bool fold) {
+            if (name.size != text.size) return false;
+            for (size_t i = 0; i < name.size; ++i) {
+                if (fold ? StringPool::FoldChar(name[i]) != StringPool::FoldChar(text[i]) : name[i] != text[i]) return false;
+            }
+            return true;
+        }
+
+        /// Converts the value, or every element of a list value, of a typed option into out.
+        /// An empty value converts to nothing if allow_empty, for fallbacks and flags that have none.
+        /// @param bad Receives the element that failed, or null
+        template<typename Vector>
+        ConvertResult ConvertValues(int32_t id, const ArgView& value, bool is_list, bool allow_empty, Vector& out, ArgView* bad) const {
+            if (value.empty() && allow_empty) return ConvertResult::Success;
+            const char* end = value.end();
+            for (const char* first = value.begin();; ) {
+                const char* last = is_list ? ArghandFindChar(first, end, ListSeparator) : end;
+                ArgView element(first, static_cast<size_t>(last - first));
+                TypedValue converted = TypedValue();
+                ConvertResult res = ConvertValue(id, element, converted);
+                if (res != ConvertResult::Success) {
+                    if (bad) *bad = element;
+                    return res;
+                }
+                out.push_back(converted);
+                if (last == end) return ConvertResult::Success;
+                first = last + 1;
+            }
+        }
+
+        /// Converts the value of a typed option given on the command line, nothing for untyped options.
+        /// A boolean flag, one without IsValueRequired or IsList, is true when given.
+        template<typename Vector>
+        bool ConvertGiven(int32_t id, const ArgView& value, bool is_list, Vector& out) const {
+            uint64_t flags = table.Flags(id);
+            if ((flags & TypeFlags) == 0) return true;
+            bool flag = (flags & (QSTU64(CmdOptionFlags::IsValueRequired) | QSTU64(CmdOptionFlags::IsList))) == 0;
+            if (flag && (flags & QSTU64(CmdOptionFlags::IsBoolean))) {
+                TypedValue value_true;
+                value_true.integer = 1;
+                value_true.real = 1.0;
+                out.push_back(value_true);
+                return true;
+            }
+            return ConvertValues(id, value, is_list, flag, out, nullptr) == ConvertResult::Success;
+        }
+
+        /// Stands in for the output of ConvertValues where only the failing element matters, allocates nothing.
+        struct Discard {
+            void push_back(const TypedValue&) {}
+        };
+
+        /// Reports a value the sink rejected, finding the element that does not convert.
+        ParseResult RejectValue(MatchState& state, int32_t id, const ArgView& value, bool is_list, size_t index) const {
+            bool flag = (table.Flags(id) & (QSTU64(CmdOptionFlags::IsValueRequired) | QSTU64(CmdOptionFlags::IsList))) == 0;
+            Discard scratch;
+            ArgView bad = value;
+            ConvertResult res = ConvertValues(id, value, is_list, flag, scratch, &bad);
+            ReportError(state, res == ConvertResult::OutOfRange ? DiagnosticCode::ValueOutOfRange : DiagnosticCode::InvalidValue, bad, index, id);
+            return ParseResult::Error;
+        }
+
+        /// Fails a parse that falls back to an environment, config or default value that does not convert.
+        ParseResult CheckFallbacks(MatchState& state, const Result& result) const;
+
+        /// Prepares a matcher state for the current parser options.
+        void InitMatchState(MatchState& state, TokenArena* arena, std::vector<std::shared_ptr<MappedFile>>* files) const;
+
+        /// Hands out the items of a batch to the threads of RunBatch
+        class BatchQueue;
+
+        /// Runs parseItem(index, result) for every item of a batch on a pool of threads.
+        template<typename ParseItem>
+        std::vector<BatchResult> RunBatch(size_t count, unsigned threads, const BatchVisitor& visitor, const ParseItem& parseItem) const;
+
+        /// Empties result for a parse and sets up state, attaching the result's instrumentation.
+        void BeginParse(MatchState& state, Result& result) const;
+
+        /// Resource that counts what a parse takes, with the worst case alignment padding
+        class MemoryMeter : public MemoryResource {
+        public:
+            void* Allocate(size_t size, size_t align) override {
+                required += size + align - 1;
+                return buffer.Allocate(size, align);
+            }
+            void Release() override {
+                buffer.Release();
+                required = 0;
+            }
+            size_t required = 0;
+
+        private:
+            MonotonicBuffer buffer;
+        };
+
+        /// Runs parseInto on a result taking its memory from a meter.
+        template<typename Parse>
+        size_t MeasureMemory(const Parse& parseInto) const {
+            MemoryMeter meter;
+            Result result;
+            result.SetQuiet(true);
+            result.SetMemory(&meter);
+            parseInto(result);
+            return meter.required;
+        }
+
+        /// Fails a parse whose memory resource is exhausted, leaving the result empty.
+        ParseResult MemoryExhausted(MatchState& state, Result& result) const {
+            ReportError(state, DiagnosticCode::MemoryExhausted, ArgView(), state.index, -1);
+            result.Reset(*this);
+            result.Resolve();
+            return ParseResult::Error;
+        }
+
+        /// Completes a parse that fed its arguments with result res, and builds the result.
+        ParseResult EndParse(ParseResult res, MatchState& state, Result& result) const;
+
+        /// Feeds one argument to the matcher, expanding @response files if enabled.
+        ParseResult FeedArgument(const ArgView& arg, MatchState& state, MatchSink& sink, int depth) const;
+
+        /// Matches a single token like MatchToken, timing it and reporting it to the trace callback.
+        ParseResult MatchTokenTraced(const ArgView& arg, MatchState& state, MatchSink& sink) const;
+
+        /// Matches a single token, completing a pending option value first.
+        ParseResult MatchToken(const ArgView& arg, MatchState& state, MatchSink& sink) const;
+
+        /// Takes a positional argument, binding it to the next positional slot if there is one.
+        ParseResult MatchPositional(const ArgView& arg, MatchState& state, MatchSink& sink) const;
+
+        /// Checks if the arguments left can go straight into the positional arguments of a result:
+        /// after "--", with every positional slot but the tail bound, and nothing to time, trace or convert.
+        bool TakesRest(const MatchState& state) const {
+            return state.endOfOptions && !state.stats && !state.trace && state.positionals >= positionalSlots.size() &&
+                   (positionalTail >= 0 ? (table.Flags(positionalTail) & TypeFlags) == 0 : positionalSlots.empty());
+        }
+
+        /// Appends the arguments [first, last) to the positional arguments of result in one pass, see TakesRest.
+        template<typename Iterator>
+        void TakeRest(Iterator first, Iterator last, MatchState& state, Result& result) const {
+            size_t count = static_cast<size_t>(last - first);
+            result.positionalViews.reserve(result.positionalViews.size() + count);
+            for (; first != last; ++first) {
+                result.positionalViews.push_back(ArgView(*first));
+            }
+            state.positionals += count;
+        }
+
+        /// Reports a parse error as a record if the state collects them, else as a message into the
+        /// state's message or on stderr. Records skip the message, and with it the hints.
+        void ReportError(MatchState& state, DiagnosticCode code, const ArgView& arg, size_t index, OptionId option) const;
+
+        /// Renders the message of a diagnostic, with the candidates or suggestions for option names.
+        std::string FormatDiagnostic(const Diagnostic& diagnostic, const MatchState& state) const;
+
+        /// Looks up an option token by its exact name or, with ParserOptions::AllowAbbreviations,
+        /// by an unambiguous prefix of a long name.
+        /// @return The option ID, NameTrie::Ambiguous, or -1.
+        int32_t FindOption(const ArgView& arg, const MatchState& state) const {
+            int32_t id = optionIndex.Find(arg.data, arg.size);
+            if (id < 0 && !longNames.empty() && arg.size > state.prefix_lng.size && arg.StartsWith(state.prefix_lng)) {
+                id = longNames.FindPrefix(arg.data + state.prefix_lng.size, arg.size - state.prefix_lng.size);
+            }
+            return id;
+        }
+
+        /// Lists the options an ambiguous abbreviation could stand for, for the error message.
+        std::string AmbiguityHint(const ArgView& arg, const MatchState& state) const {
+            std::vector<int32_t> ids;
+            longNames.Candidates(arg.data + state.prefix_lng.size, arg.size - state.prefix_lng.size, 4, ids);
+            return JoinNames(" (could be ", ids, state, ")");
+        }
+
+        /// Suggests the long names closest to an unknown option, for the error message.
+        /// Short tokens allow one edit, longer ones two.
+        std::string SuggestionHint(const ArgView& arg, const MatchState& state) const;
+
+        /// Gets the prefix index over all option names as typed, "--output" and "-o", for completion.
+        /// Built on the first call. Keys carry the option ID times two, plus one for long names.
+        const NameTrie& CompletionNames() const;
+
+        /// Joins prefixed long names of options as "<open>--a, --b or --c<close>".
+        std::string JoinNames(const char* open, const std::vector<int32_t>& ids, const MatchState& state, const char* close) const;
+
+        /// Records the pending option with the given value, or with its default value if value is null.
+        ParseResult CompleteValue(MatchState& state, MatchSink& sink, const ArgView* value) const;
+
+        /// Completes an option still waiting for its value at the end of the arguments,
+        /// and checks that the required positional slots were given.
+        ParseResult FinishArguments(MatchState& state, MatchSink& sink) const {
+            if (state.pending >= 0) {
+                ParseResult res = CompleteValue(state, sink, nullptr);
+                if (res != ParseResult::Success) return res;
+            }
+            if (!positionalSlots.empty() || positionalTail >= 0) {
+                return CheckPositionals(state);
+            }
+            return ParseResult::Success;
+        }
+
+        /// Reports the first required positional slot that was not given, the tail included.
+        ParseResult CheckPositionals(MatchState& state) const;
+
+        OptionTable table;                      // Command options in compact form, indexed by option ID
+        mutable std::vector<CmdOption> cmdOptions;  // Command options as given, rebuilt from table by GetCmdOptions
+        mutable std::once_flag cmdOptionsOnce;
+        ParserOptions parserOptions;            // Options for the argument parser, controlling its behavior
+        char ListSeparator;                     // Character used to separate list values in options
+        OptionIndex optionIndex;                // Prefixed names as given on the command line
+        OptionIndex nameIndex;                  // Unprefixed, case-sensitive names for the accessors
+        OptionIndex commandIndex;               // Subcommand names, indexed like the commands given to the constructor
+        std::vector<int32_t> positionalSlots;   // Positional slots but the tail, in declaration order
+        int32_t positionalTail;                 // The IsList positional slot taking the remaining positional arguments, or -1
+        std::vector<std::string> commandNames;  // Subcommand names as given, for completion
+        NameTrie longNames;                     // Long names, only built with ParserOptions::AllowAbbreviations
+        mutable NameTrie suggestNames;          // Long names for suggestions without abbreviations, built on the first unknown option
+        mutable std::once_flag suggestOnce;
+        mutable NameTrie completionNames;       // Prefixed option names for Session::Complete, built on the first session
+        mutable std::once_flag completionOnce;
+        std::vector<ParsedView> defaultRanges;  // Default value range of each option in defaultViews, indexed by option ID
+        std::vector<ArgView> defaultViews;      // Default values of all options, split for list options
+        std::vector<std::vector<std::string>> defaultValues;   // Owning split default values, indexed by option ID
+        std::vector<std::string> fallbackValues;    // Value of each option when not on the command line: environment, config or default
+        std::vector<ValueSource> fallbackSources;   // Where each of fallbackValues came from
+        bool typed;                             // Some option is declared IsInteger, IsDouble, IsBoolean or IsEnum
+        std::vector<TypeRule> rules;            // Allowed values of each option, empty without typed options
+        std::vector<ArgView> choices;           // Names of the IsEnum options, views into the option table
+        std::vector<TypedValue> typedDefaults;  // Converted fallback values, ranges in defaultRanges
+        std::vector<int32_t> invalidFallbacks;  // Typed options whose fallback value does not convert
+        uint64_t serial;                        // Unique per spec, tells a Result whether its table holds this spec's defaults
+
+        /// Gets a serial no other spec of the process has.
+        static uint64_t NextSerial();
+    };
+
+    /// Results of one parse, filled by Spec::parse() and queried like an Arghand.
+    /// A Result can be reused for any number of parses, its buffers keep their capacity,
+    /// and must outlive none of the threads sharing the Spec. It refers to the Spec that filled it,
+    /// which must outlive it.
+    class Result : private MatchSink {
+    public:
+        Result() : spec(nullptr), zeroCopy(false), lazyLists(false), viewsOnly(false), command(-1), commandArg(0), statsEnabled(false), stats() {}
+        Result(const Result& other) : spec(nullptr), zeroCopy(false), lazyLists(false), viewsOnly(false), command(-1), commandArg(0), statsEnabled(false), stats() { *this = other; }
+        Result(Result&&) = default;
+        Result& operator=(Result&&) = default;
+        /// Copies the results, the copy refers to the same argv, response files and Spec.
+        Result& operator=(const Result& other);
+
+        /// Makes the following parses take all their storage from memory instead of the heap: the parsed
+        /// views, typed values, positional arguments and unquoted tokens. Each parse releases the memory
+        /// first, so once the resource is large enough, see Spec::RequiredMemory, parsing allocates
+        /// nothing. Only the query table is heap allocated, once per spec, and @response files.
+        /// Like ParserOptions::ZeroCopy no owning copies are made, GetValue and GetValues assert for
+        /// options that were given, use the view and typed accessors. Errors allocate their message unless
+        /// collected, passed to a callback or quiet. A parse that exhausts the resource fails with
+        /// DiagnosticCode::MemoryExhausted and leaves the result empty.
+        /// The results of the last parse are dropped.
+        /// @param resource The resource, which must outlive the parses, or null for the heap
+        void SetMemory(MemoryResource* resource);
+        /// Gets the memory resource of the parses, or null for the heap.
+        MemoryResource* GetMemory() const { return memory; }
+
+        /// Enables or disables collecting ParseStats on the following parses into this result.
+        /// Disabled, instrumentation costs one test per token.
+        void EnableStats(bool enable) { statsEnabled = enable; }
+        /// Gets the instrumentation of the last parse that ran with stats enabled, all zero before that.
+        const ParseStats& GetStats() const { return stats; }
+        /// Sets the callback called for every token of the following parses, an empty function disables it.
+        /// The token view is only valid during the call.
+        void SetTraceCallback(const TraceCallback& fn) { trace = fn; }
+
+        /// Collects up to capacity parse errors per parse as Diagnostic records instead of printing them.
+        /// The buffer is allocated here, so reporting errors does not allocate. Further errors are only counted.
+        /// Collection, a callback or quiet mode each turn the stderr messages off. 0 stops collecting.
+        void CollectDiagnostics(size_t capacity) {
+            diagnostics.capacity = capacity;
+            diagnostics.records.reserve(capacity);
+        }
+        /// Gets the diagnostics of the last parse, see CollectDiagnostics.
+        const std::vector<Diagnostic>& GetDiagnostics() const { return diagnostics.records; }
+        /// Gets the number of diagnostics of the last parse that did not fit the collected ones.
+        size_t GetDroppedDiagnostics() const { return diagnostics.dropped; }
+        /// Sets the callback called for every diagnostic instead of printing it, an empty function disables it.
+        void SetDiagnosticCallback(const DiagnosticCallback& fn) { diagnostics.callback = fn; }
+        /// Enables or disables quiet mode: errors are only returned as the ParseResult, neither
+        /// printed, collected nor passed to the callback.
+        void SetQuiet(bool quiet) { diagnostics.quiet = quiet; }
+
+        /// Gets the handle of an option by its name, see Spec::GetOptionId.
+        OptionId GetOptionId(const ArgView& name) const {
+            return spec ? spec->GetOptionId(name) : -1;
+        }
+
+        /// Checks if an option with the given name exists in the parsed options.
+        bool operator[](const ArgView& name) const {
+            return IsSet(GetOptionId(name));
+        }
+        /// Checks if the option with the given ID exists in the parsed options.
+        bool IsSet(OptionId id) const {
+            return id >= 0 && static_cast<size_t>(id) < results.size() && results[id].present;
+        }
+
+        /// Gets the value of an option, see Arghand::GetValue.
+        const std::string& GetValue(const ArgView& name) const {
+            return GetValue(GetOptionId(name));
+        }
+        const std::string& GetValue(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return EmptyString();
+            if (results[id].values == &tailValues) return TailValues()[0];
+            const std::string* value = results[id].value;
+            assert(value && "Given options have no owning value in zero-copy parses, use GetValueView");
+            return value ? *value : EmptyString();
+        }
+
+        /// Gets the values of an option, see Arghand::GetValues.
+        const std::vector<std::string>& GetValues(const ArgView& name) const {
+            return GetValues(GetOptionId(name));
+        }
+        const std::vector<std::string>& GetValues(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return EmptyValues();
+            if (results[id].values == &tailValues) return TailValues();
+            const std::vector<std::string>* values = results[id].values;
+            assert(values && "Given options have no owning values in zero-copy parses, use GetValuesView");
+            return values ? *values : EmptyValues();
+        }
+
+        /// Gets the value of an option without copying, see Arghand::GetValueView.
+        ArgView GetValueView(const ArgView& name) const {
+            return GetValueView(GetOptionId(name));
+        }
+        ArgView GetValueView(OptionId id) const {
+            ArgViewList values = GetValuesView(id);
+            return values.empty() ? ArgView() : values[0];
+        }
+
+        /// Gets the values of an option without copying, see Arghand::GetValuesView.
+        ArgViewList GetValuesView(const ArgView& name) const {
+            return GetValuesView(GetOptionId(name));
+        }
+        ArgViewList GetValuesView(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return ArgViewList();
+            return results[id].views;
+        }
+
+        /// Gets the values of an option as a lazily split list, see Arghand::GetListView.
+        ArgSplitView GetListView(const ArgView& name) const {
+            return GetListView(GetOptionId(name));
+        }
+        ArgSplitView GetListView(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return ArgSplitView();
+            return results[id].list;
+        }
+
+        /// Gets the converted value of a typed option, see Arghand::Get.
+        template<typename T>
+        T Get(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return T();
+            return FromTyped<T>(results[id].scalar);
+        }
+        template<typename T>
+        T Get(const ArgView& name) const {
+            return Get<T>(GetOptionId(name));
+        }
+
+        /// Gets the converted elements of a typed list option, see Arghand::GetList.
+        template<typename T>
+        TypedList<T> GetList(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return TypedList<T>();
+            return TypedList<T>(results[id].typed, results[id].typedCount);
+        }
+        template<typename T>
+        TypedList<T> GetList(const ArgView& name) const {
+            return GetList<T>(GetOptionId(name));
+        }
+
+        /// Gets the positional arguments, see Arghand::GetPositionalViews.
+        ArgViewList GetPositionalViews() const {
+            return ArgViewList(positionalViews.data(), positionalViews.size());
+        }
+
+        /// Gets where the value of an option came from, see Arghand::GetSource.
+        ValueSource GetSource(const ArgView& name) const {
+            return GetSource(GetOptionId(name));
+        }
+        ValueSource GetSource(OptionId id) const {
+            if (id < 0 || static_cast<size_t>(id) >= results.size()) return ValueSource::Default;
+            return results[id].present ? ValueSource::CommandLine : spec->fallbackSources[id];
+        }
+
+        /// Gets the subcommand the parse stopped at, as its index in the commands given to the Spec, or -1.
+        /// The arguments after the subcommand name are left for the subcommand to parse.
+        int32_t GetCommand() const { return command; }
+
+    private:
+        friend class Arghand;
+        friend class Spec;
+
+        bool OnOption(int32_t id, const ArgView& value, bool is_list) override {
+            ParsedView parsed;
+            parsed.id = id;
+            parsed.first = static_cast<uint32_t>(valueViews.size());
+            parsed.typed = static_cast<uint32_t>(typedValues.size());
+            parsed.raw = value;
+            if (spec->typed && !spec->ConvertGiven(id, value, is_list, typedValues)) {
+                typedValues.resize(parsed.typed);
+                return false;
+            }
+            if (is_list && !lazyLists) {
+                SplitViews(value, spec->ListSeparator, valueViews);
+            } else {
+                valueViews.push_back(value);
+            }
+            parsed.count = static_cast<uint32_t>(valueViews.size() - parsed.first);
+            parsed.typedCount = static_cast<uint32_t>(typedValues.size() - parsed.typed);
+            parsedViews.push_back(parsed);
+            return true;
+        }
+
+        bool OnPositional(const ArgView& arg, int32_t tail) override {
+            if (tail >= 0 && spec->typed) {
+                size_t typed = tailTyped.size();
+                if (!spec->ConvertGiven(tail, arg, false, tailTyped)) {
+                    tailTyped.resize(typed);
+                    return false;
+                }
+            }
+            positionalViews.push_back(arg);
+            return true;
+        }
+
+        /// Empties the result for a parse with the given spec, keeping buffer capacity.
+        void Reset(const Spec& owner);
+
+        /// Copies the positional arguments of the tail slot into owning values, on the first call after a parse.
+        /// The tail is only a view over the positional arguments until then, so parses never copy it.
+        const std::vector<std::string>& TailValues() const {
+            if (!tailCopied.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(tailMutex);
+                if (!tailCopied.load(std::memory_order_relaxed)) {
+                    size_t first = spec->positionalSlots.size();
+                    tailValues.reserve(positionalViews.size() - first);
+                    for (size_t i = first; i < positionalViews.size(); ++i) {
+                        tailValues.push_back(positionalViews[i].str());
+                    }
+                    tailCopied.store(true, std::memory_order_release);
+                }
+            }
+            return tailValues;
+        }
+
+        /// Checks if p points into storage of this result that the next parse reuses: its arena or a response file.
+        bool Owns(const char* p) const;
+
+        /// Drops a buffer's storage, and takes the current memory resource for the next.
+        template<typename T>
+        void Restart(MemoryVector<T>& buffer) {
+            MemoryVector<T>(MemoryAllocator<T>(memory)).swap(buffer);
+        }
+
+        /// Builds the ID-indexed result table after a parse, so that queries are a single indexed load.
+        /// Without ParserOptions::ZeroCopy this also materializes the owning value copies.
+        void Resolve();
+
+        /// Points the result table entry of an option at its default value.
+        void LinkDefault(size_t id) {
+            const ParsedView& range = spec->defaultRanges[id];
+            results[id].views = ArgViewList(spec->defaultViews.data() + range.first, range.count);
+            results[id].list = ArgSplitView(range.raw, spec->ListSeparator, (spec->table.Flags(id) & QSTU64(CmdOptionFlags::IsList)) != 0);
+            results[id].values = &spec->defaultValues[id];
+            results[id].value = &spec->fallbackValues[id];
+            results[id].present = false;
+            LinkTyped(results[id], spec->typedDefaults.data() + range.typed, range.typedCount);
+        }
+
+        static void LinkTyped(OptionResult& result, const TypedValue* values, uint32_t count) {
+            static const TypedValue zero = TypedValue();
+            result.typed = values;
+            result.typedCount = count;
+            result.scalar = count ? values[0] : zero;
+        }
+
+        /// Zeroes the stats and marks the buffer capacities, so that EndStats can tell what the parse allocated.
+        void BeginStats();
+
+        /// Completes the counts of the stats after a parse.
+        void EndStats();
+
+        /// Counts the allocations of a vector that grew from capacity before, one per geometric growth step.
+        /// Those of a memory resource are not heap allocations and are not counted.
+        template<typename Vector>
+        void CountGrowth(const Vector& buffer, size_t before) {
+            if (!IsHeap(buffer.get_allocator())) return;
+            for (size_t capacity = before; capacity < buffer.capacity(); ) {
+                capacity = capacity ? std::min(capacity * 2, buffer.capacity()) : std::min<size_t>(1, buffer.capacity());
+                ++stats.allocations;
+                stats.bytes += capacity * sizeof(typename Vector::value_type);
+            }
+        }
+        template<typename T>
+        static bool IsHeap(const std::allocator<T>&) { return true; }
+        template<typename T>
+        static bool IsHeap(const MemoryAllocator<T>& allocator) { return !allocator.memory; }
+
+        /// Points the result table at this result's buffers.
+        /// Options given on the command line point at their first occurrence, all others at their default.
+        /// The table is filled with defaults once per spec, later parses only reset the entries the
+        /// previous one set, so linking costs the options parsed rather than the size of the table.
+        void Link();
+
+        const Spec* spec;                       // Spec of the last parse, null before the first one
+        bool zeroCopy;                          // Whether the last parse ran with ParserOptions::ZeroCopy
+        bool lazyLists;                         // Whether the last parse ran with ParserOptions::LazyLists
+        bool viewsOnly;                         // Parse as if with ParserOptions::ZeroCopy, for batch parses
+        int32_t command;                        // Subcommand the parse stopped at, or -1
+        size_t commandArg;                      // Index of the subcommand name in argv or the argument list
+        ArgView commandRest;                    // Command string text after the subcommand name
+        std::vector<std::vector<std::string>> parsedValues;    // Owning values of parsedViews, empty with ParserOptions::ZeroCopy
+        MemoryVector<ParsedView> parsedViews;   // Parsed options in argument order, as ranges of valueViews
+        MemoryVector<ArgView> valueViews;       // Values of all parsed options, pointing into argv or default values
+        MemoryVector<TypedValue> typedValues;   // Converted values of all parsed typed options
+        MemoryVector<ArgView> positionalViews;  // Arguments that are neither options nor option values
+        MemoryVector<TypedValue> tailTyped;     // Converted values of the positional arguments taken by a typed tail
+        mutable std::vector<std::string> tailValues;    // Owning values of the tail, copied by the first GetValue(s) call
+        mutable std::atomic<bool> tailCopied{false};    // Whether tailValues holds the tail of the last parse
+        mutable std::mutex tailMutex;           // Serializes that first copy
+        MemoryResource* memory = nullptr;       // Resource of the buffers above and the arena, or null for the heap
+        std::vector<OptionResult> results;      // Query table, indexed by option ID
+        std::vector<int32_t> linkedIds;         // Entries of results set by the last parse, the others hold defaults
+        uint64_t linkedSerial = 0;              // Spec::serial of the spec whose defaults results holds, 0 for none
+        std::vector<std::shared_ptr<MappedFile>> files;    // Response files mapped by the parse, values may point into them
+        std::shared_ptr<TokenArena> arena;      // Unquoted tokens of the parse
+        bool statsEnabled;                      // Whether parses collect stats
+        ParseStats stats;                       // Instrumentation of the last parse
+        TraceCallback trace;                    // Called for every token, or empty
+        std::chrono::steady_clock::time_point started;  // Start of the parse, for stats
+        size_t marks[8];                        // Buffer capacities and arena counters at the start of the parse
+        mutable Diagnostics diagnostics;        // Structured errors, also reported to by the const Print* methods
+    };
+
+private:
+    /// Reports a missing version through the result's diagnostics if configured, else on stderr.
+    void WarnVersionNotSet() const;
+
+    /// Prints help or version for the matching parse results.
+    ParseResult Report(ParseResult res) const {
+        if (res == ParseResult::SuccessWithHelp) {
+            PrintHelp();
+        }
+        else if (res == ParseResult::SuccessWithVersion) {
+            PrintVersion(true);
+        }
+        return res;
+    }
+
+    /// Replaces the spec with one compiled from options and the current configuration.
+    /// The result is reset to the new spec's defaults, so queries before the first parse see them.
+    void RebuildSpec(const std::vector<CmdOption>& options);
+
+    /// Sets field of the bound options to their values and rebuilds the spec once.
+    /// @return False if one of the options does not exist, the spec is left unchanged then.
+    bool Bind(const std::vector<Binding>& bindings, std::string CmdOption::*field) {
+        for (const Binding& binding : bindings) {
+            if (spec->GetOptionId(binding.first) < 0) return false;
+        }
+        std::vector<CmdOption> options = spec->GetCmdOptions();
+        for (const Binding& binding : bindings) {
+            options[spec->GetOptionId(binding.first)].*field = binding.second;
+        }
+        RebuildSpec(options);
+        return true;
+    }
+
+    /// Compiles subcommands added since the spec was built and forgets the last dispatch, before a parse.
+    void PrepareCommands() {
+        activeCommand = -1;
+        if (commandsChanged) {
+            RebuildSpec(spec->GetCmdOptions());
+        }
+    }
+
+    /// Gets the handler of a subcommand for a dispatch, building it on first use.
+    Arghand& Dispatch(int32_t id);
+
+    /// Drops the cached help and version text, called by every Set* method.
+    void InvalidateText() {
+        helpCached = false;
+        versionCached = false;
+        helpText.clear();
+        versionText.clear();
+    }
+
+    /// Renders the version text, with the footer and license if withLicense.
+    std::string RenderVersion(bool withLicense) const;
+
+    /// Renders the help text. The description column starts after the longest option names.
+    std::string RenderHelp() const;
+
+    char ListSeparator; // Character used to separate list values in options
+    std::shared_ptr<const Config> config;   // Config file for options with a configKey, or null
+    std::shared_ptr<const Spec> spec;   // Compiled options, rebuilt by SetCmdOptions, SetParserOptions and SetSeparator
+    Result result;      // Results of the last parse
+
+    std::string applicationName;    // Name of the application for help and version output
+    std::string helpHeader;     // Header text for help output
+    std::string helpFooter;     // Footer text for help output
+    std::string license;        // License text for the application
+    std::string version;        // Version information for the application
+    std::string versionFooter;  // Footer text for version output
+
+    Output output;                      // Destination of help, version and license output
+    mutable std::string helpText;       // Rendered help, valid while helpCached
+    mutable std::string versionText;    // Rendered version with footer and license, valid while versionCached
+    mutable bool helpCached = false;
+    mutable bool versionCached = false;
+
+    /// A subcommand, its handler built on the first dispatch to it
+    struct Subcommand {
+        std::string name;           // Name as given on the command line
+        std::string description;    // Description for the help
+        CommandFactory factory;     // Sets up the handler
+        std::shared_ptr<Arghand> handler;   // Null until a parse dispatches to the subcommand
+
+        Subcommand(const std::string& n, const std::string& d, const CommandFactory& f) : name(n), description(d), factory(f) {}
+        // A copied Arghand builds handlers of its own rather than sharing their results
+        Subcommand(const Subcommand& other) : name(other.name), description(other.description), factory(other.factory) {}
+        Subcommand& operator=(const Subcommand& other) {
+            name = other.name;
+            description = other.description;
+            factory = other.factory;
+            handler.reset();
+            return *this;
+        }
+        Subcommand(Subcommand&&) = default;
+        Subcommand& operator=(Subcommand&&) = default;
+    };
+    std::vector<Subcommand> subcommands;    // Subcommands in the order added
+    bool commandsChanged = false;           // Subcommands were added since the spec was built
+    int32_t activeCommand = -1;             // Subcommand the last parse dispatched to, or -1
 
     ParserOptions parserOptions;    // Options for the argument parser, controlling its behavior
 };
+/// Push-style parser over the options of an Arghand or a Spec.
+/// Tokens are fed one at a time, or in chunks, and handlers run as soon as an option and its value
+/// are complete, so memory use does not grow with the number of arguments. The IsValueRequired,
+/// IsList and DefaultValue rules of parse() apply unchanged, and so do @response files.
+/// The views passed to handlers are only valid during the call, unless the fed tokens outlive it.
+/// A stream over an Arghand keeps its current spec alive and prints help and version through it,
+/// so the Arghand must outlive the stream. A stream over a Spec prints nothing and the Spec must outlive it.
+/// Usage:
+///     Arghand::Stream stream(handler);
+///     stream.SetHandler("output", [](Arghand::OptionId, ArgViewList values) { ... });
+///     stream.SetPositionalHandler([](const ArgView& file) { ... });
+///     while (ReadChunk(tokens)) stream.Feed(tokens.begin(), tokens.end());
+///     Arghand::ParseResult res = stream.Finish();
+class Arghand::Stream : private Arghand::MatchSink {
+public:
+    /// Called with an option ID and its values (split for list options)
+    typedef std::function<void(OptionId id, ArgViewList values)> OptionHandler;
+    /// Called with a positional argument
+    typedef std::function<void(const ArgView& arg)> PositionalHandler;
+
+    /// Creates a stream over the options of handler.
+    explicit Stream(const Arghand& handler)
+        : owned(handler.spec), spec(*owned), owner(&handler), handlers(spec.table.size()) {
+        Reset();
+    }
+    /// Creates a stream over the options of spec.
+    explicit Stream(const Spec& spec) : spec(spec), owner(nullptr), handlers(spec.table.size()) {
+        Reset();
+    }
+
+    /// Sets the handler for one option, by name (can be short or long name).
+    void SetHandler(const ArgView& name, const OptionHandler& fn) { SetHandler(spec.GetOptionId(name), fn); }
+    /// Sets the handler for one option, by ID.
+    void SetHandler(OptionId id, const OptionHandler& fn) {
+        if (id >= 0 && static_cast<size_t>(id) < handlers.size()) handlers[id] = fn;
+    }
+    /// Sets the visitor called for every option that has no handler of its own.
+    void SetVisitor(const OptionHandler& fn) { visitor = fn; }
+    /// Sets the handler for positional arguments.
+    void SetPositionalHandler(const PositionalHandler& fn) { positional = fn; }
+    /// Sets the callback called for every parse error instead of printing it, see Result::SetDiagnosticCallback.
+    /// Diagnostic::index counts the tokens fed since the last Finish.
+    void SetDiagnosticCallback(const DiagnosticCallback& fn) { diagnostics.callback = fn; Attach(); }
+    /// Enables or disables quiet mode, errors are only returned as the ParseResult.
+    void SetQuiet(bool quiet) { diagnostics.quiet = quiet; Attach(); }
+
+    /// Feeds one token.
+    /// @return Success to continue, or the final result once parsing stopped (error, help or version).
+    /// After a non-Success result further tokens are ignored until Finish().
+    ParseResult Feed(const ArgView& token);
+
+    /// Feeds a range of tokens, anything convertible to ArgView such as char*, std::string or ArgView.
+    template<typename Iterator>
+    ParseResult Feed(Iterator first, Iterator last) {
+        for (; first != last && status == ParseResult::Success; ++first) {
+            Feed(ArgView(*first));
+        }
+        return status;
+    }
+
+    /// Ends the sequence, completing an option still waiting for its value.
+    /// The stream is reset afterwards and can be reused.
+    /// @return ParseResult indicating the result of the whole sequence
+    ParseResult Finish() {
+        if (status == ParseResult::Success) {
+            status = spec.FinishArguments(state, *this);
+            Report();
+        }
+        ParseResult result = status;
+        Reset();
+        return result;
+    }
+
+private:
+    bool OnOption(int32_t id, const ArgView& value, bool is_list) override {
+        // Typed values are checked like parse() does, the handlers still get the text
+        if (spec.typed) {
+            typedScratch.clear();
+            if (!spec.ConvertGiven(id, value, is_list, typedScratch)) return false;
+        }
+        const OptionHandler& fn = handlers[id] ? handlers[id] : visitor;
+        if (!fn) return true;
+
+        scratch.clear();
+        if (is_list) {
+            SplitViews(value, spec.ListSeparator, scratch);
+        } else {
+            scratch.push_back(value);
+        }
+        fn(id, ArgViewList(scratch.data(), scratch.size()));
+        return true;
+    }
+
+    bool OnPositional(const ArgView& arg, int32_t tail) override {
+        if (tail >= 0 && spec.typed) {
+            typedScratch.clear();
+            if (!spec.ConvertGiven(tail, arg, false, typedScratch)) return false;
+        }
+        if (positional) positional(arg);
+        return true;
+    }
+
+    void Reset() {
+        spec.InitMatchState(state, &arena, nullptr);
+        Attach();
+        status = ParseResult::Success;
+    }
+
+    /// Routes errors to diagnostics once a callback or quiet mode is set.
+    void Attach() {
+        state.diagnostics = diagnostics.Active() ? &diagnostics : nullptr;
+    }
+
+    /// Prints help or version through the owning Arghand, like Arghand::parse.
+    void Report() const {
+        if (!owner) return;
+        if (status == ParseResult::SuccessWithHelp) {
+            owner->PrintHelp();
+        }
+        else if (status == ParseResult::SuccessWithVersion) {
+            owner->PrintVersion(true);
+        }
+    }
+
+    std::shared_ptr<const Spec> owned;      // Keeps the spec of an Arghand alive
+    const Spec& spec;                       // Option definitions
+    const Arghand* owner;                   // Arghand printing help and version, if any
+    std::vector<OptionHandler> handlers;    // Per-option handlers, indexed by option ID
+    OptionHandler visitor;                  // Handler for options without their own
+    PositionalHandler positional;           // Handler for positional arguments
+    MatchState state;                       // Matcher state carried between tokens
+    ParseResult status;                     // Result so far, sticky once not Success
+    std::string pendingArg;                 // Copy of the token naming the pending option
+    std::vector<ArgView> scratch;           // Reused storage for the values passed to handlers
+    std::vector<TypedValue> typedScratch;   // Reused storage for checking typed values
+    TokenArena arena;                       // Unquoted response file tokens of the current Feed
+    Diagnostics diagnostics;                // Callback and quiet mode, records are not kept
+};
+
+/// Command line being edited in an interactive shell, re-parsed incrementally on every edit.
+/// The session keeps the tokens of the line with the matcher state before each one. An edit only
+/// re-tokenizes from the token it touches until the tokens line up with the old ones again, and only
+/// re-matches until the matcher state before a token is the one it had, so a keystroke costs the
+/// tokens around the cursor rather than the whole line. Complete lists the option names, subcommands
+/// or values that fit at the cursor, from a prefix index over the options built once per spec.
+/// The line holds arguments only, like a command string (see Spec::parse(command, result)).
+/// Tokens after a subcommand name belong to the subcommand and are not matched, @response files
+/// are not expanded, and nothing is printed. Pass GetLine() to parse() once the line is submitted.
+/// A session over an Arghand keeps its current spec alive, a session over a Spec needs it to outlive it.
+/// Usage:
+///     Arghand::Session session(handler);
+///     session.Edit(cursor, 0, typed);          // Insert what was typed at the cursor
+///     session.Complete(cursor, candidates);    // On tab
+///     if (session.GetStatus() != Arghand::ParseResult::Success) ...
+class Arghand::Session : private Arghand::MatchSink {
+public:
+    /// One token of the line, see GetToken
+    struct TokenInfo {
+        size_t begin;           // Offset of the token in the line, quotes included
+        size_t end;             // Offset past the token
+        ArgView text;           // The token unquoted, valid until the next edit
+        TokenKind kind;         // What the token is in the command line
+        OptionId option;        // Option named (Option) or given a value (Value), subcommand index (Command), or -1
+        ParseResult status;     // Success, or why parse() would stop at this token
+    };
+
+    /// Kind of a completion candidate
+    enum class CompletionKind {
+        Option,         // An option name, with its prefix
+        Command,        // A subcommand name
+        Value,          // One of the values of a boolean or IsEnum option
+        Hint            // What the value of the option looks like: its allowed range, or else its default value
+    };
+
+    /// A completion candidate. The views point into the spec and stay valid as long as it does.
+    struct Completion {
+        ArgView prefix;         // Option prefix, "--", "-" or "/", empty for other kinds
+        ArgView name;           // Name or value, the text to complete is prefix followed by name
+        CompletionKind kind;
+        OptionId option;        // The option, or the subcommand index for Command
+
+        /// Gets the full text of the candidate.
+        std::string str() const { return prefix.str() + name.str(); }
+    };
+
+    /// Creates an empty session over the options of handler.
+    explicit Session(const Arghand& handler) : owned(handler.spec), spec(*owned) { Init(); }
+    /// Creates an empty session over the options of spec.
+    explicit Session(const Spec& spec) : spec(spec) { Init(); }
+
+    /// Replaces the whole line.
+    void SetLine(const ArgView& text) { Edit(0, line.size(), text); }
+
+    /// Replaces erase characters at offset with insert, e.g. Edit(cursor, 0, "x") for a typed character
+    /// or Edit(cursor - 1, 1, "") for a backspace. Offsets are clamped to the line.
+    void Edit(size_t offset, size_t erase, const ArgView& insert);
+
+    /// Gets the line.
+    const std::string& GetLine() const { return line; }
+
+    /// Gets the number of tokens of the line.
+    size_t size() const { return tokens.size(); }
+
+    /// Gets the index of the token at offset, or of the first token after it, or size() if there is none.
+    /// A token ending at offset counts as at it, like the word under a cursor placed right after it.
+    size_t FindToken(size_t offset) const;
+
+    /// Gets a token of the line.
+    TokenInfo GetToken(size_t index) const;
+
+    /// Gets the number of tokens re-matched by the last edit.
+    size_t GetRematched() const { return rematched; }
+
+    /// Gets what parse() would return for the line, apart from the checks of environment, config and
+    /// default values, which it makes for the options not given.
+    ParseResult GetStatus() const {
+        const Token* token = FirstStop();
+        return token ? token->status : lastStatus;
+    }
+
+    /// Gets the first parse error of the line, the one parse() would report.
+    /// Unlike parse(), it is the whole token for an invalid list element.
+    /// @return False if the line parses, or stops at help or version.
+    bool GetDiagnostic(Diagnostic& diagnostic) const;
+
+    /// Renders a diagnostic of the session as a message, see Spec::FormatDiagnostic.
+    std::string FormatDiagnostic(const Diagnostic& diagnostic) const { return spec.FormatDiagnostic(diagnostic); }
+
+    /// Lists what can be typed at the cursor: option names starting with the word before the cursor,
+    /// subcommands where the first positional argument may name one, or the values of the option
+    /// waiting for one. List values are completed after their last separator.
+    /// @param cursor Offset of the cursor in the line
+    /// @param out Receives the candidates in name order, cleared first
+    /// @param limit Most candidates listed
+    /// @return Offset of the word the candidates replace, which ends at the cursor
+    size_t Complete(size_t cursor, std::vector<Completion>& out, size_t limit = 32) const;
+
+private:
+    /// Matcher state before a token, all a token's match depends on besides its text
+    struct Context {
+        int32_t pending;        // Option waiting for its value, always named by the token before, or -1
+        bool dispatch;          // The token may name a subcommand
+        bool command;           // A subcommand was named, the rest is not matched
+        bool endOfOptions;      // A "--" was matched, the token is positional
+        uint32_t positionals;   // Positional arguments so far, counted up to the slots and the tail
+
+        bool operator==(const Context& other) const {
+            return pending == other.pending && dispatch == other.dispatch && command == other.command &&
+                   endOfOptions == other.endOfOptions && positionals == other.positionals;
+        }
+    };
+
+    /// A token with its match
+    struct Token {
+        uint32_t begin;         // Raw token in the line, quotes included, see Begin and End
+        uint32_t end;
+        uint32_t text;          // Unquoted text in unquoted, for quoted tokens
+        uint32_t size;
+        Context before;         // Matcher state before the token
+        int32_t option;         // See TokenInfo::option
+        int32_t errorOption;    // Option of the error, or -1
+        TokenKind kind;
+        ParseResult status;     // Success, or why parse() stops here
+        int8_t code;            // DiagnosticCode of the error, or -1
+        bool quoted;            // The text was unquoted, it is in unquoted rather than in the line
+        bool atPending;         // The error is the missing value of the pending option
+    };
+
+    void Init();
+
+    Token MakeToken(size_t begin, size_t raw_size, const ArgView& text);
+
+    // Offsets of the tokens from shiftFrom on are stored without the shift of the edits since, which
+    // is only applied between the old and the new shift point on the next edit. Typing at the cursor
+    // then costs nothing for the tokens after it. Kept modulo 2^32, like the offsets.
+    size_t Begin(size_t index) const { return tokens[index].begin + (index >= shiftFrom ? shiftBy : 0u); }
+    size_t End(size_t index) const { return static_cast<uint32_t>(tokens[index].end + (index >= shiftFrom ? shiftBy : 0u)); }
+
+    /// Moves the shift point to at, so that it applies to the tokens from there on.
+    void MoveShift(size_t at);
+
+    ArgView Text(size_t index) const {
+        const Token& token = tokens[index];
+        return token.quoted ? ArgView(unquoted.data() + token.text, token.size) : ArgView(line.data() + Begin(index), token.size);
+    }
+
+    /// Releases what a dropped token holds.
+    void Forget(const Token& token) {
+        if (token.status != ParseResult::Success) --stops;
+        if (token.quoted) unquotedLive -= token.size;
+    }
+
+    /// Matches token index in context, like parse() would, and advances context past it.
+    /// Unlike parse() it goes on after an error, as if the token were not there.
+    void Match(size_t index, Context& context);
+
+    /// Records why parse() stops at a token, with the error reported while matching it.
+    void Stop(Token& token, ParseResult res) {
+        ++stops;
+        token.status = res;
+        if (!diagnostics.records.empty()) {
+            token.code = static_cast<int8_t>(diagnostics.records[0].code);
+            token.errorOption = diagnostics.records[0].option;
+        }
+    }
+
+    /// Completes an option still waiting for its value at the end of the line.
+    void Finish();
+
+    /// Gets the first token parse() stops at, or null. Only scans while there is one.
+    const Token* FirstStop() const {
+        if (!stops) return nullptr;
+        for (const Token& token : tokens) {
+            if (token.status != ParseResult::Success) return &token;
+        }
+        return nullptr;
+    }
+
+    /// Lists the values of option id starting with word, or a hint when they are not enumerable.
+    void CompleteValue(int32_t id, ArgView word, size_t& start, std::vector<Completion>& out, size_t limit) const;
+
+    bool StartsWith(const ArgView& name, const ArgView& word) const {
+        if (!foldCase) return name.StartsWith(word);
+        if (name.size < word.size) return false;
+        for (size_t i = 0; i < word.size; ++i) {
+            if (StringPool::FoldChar(name[i]) != StringPool::FoldChar(word[i])) return false;
+        }
+        return true;
+    }
+
+    /// Rewrites unquoted without the text of dropped tokens.
+    void Compact();
+
+    bool OnOption(int32_t id, const ArgView& value, bool is_list) override {
+        // Typed values are checked like parse() does
+        if (!spec.typed) return true;
+        typedScratch.clear();
+        return spec.ConvertGiven(id, value, is_list, typedScratch);
+    }
+
+    bool OnPositional(const ArgView& arg, int32_t tail) override {
+        if (tail < 0 || !spec.typed) return true;
+        typedScratch.clear();
+        return spec.ConvertGiven(tail, arg, false, typedScratch);
+    }
+
+    std::shared_ptr<const Spec> owned;      // Keeps the spec of an Arghand alive
+    const Spec& spec;                       // Option definitions
+    std::string line;                       // The line being edited
+    std::vector<Token> tokens;              // Tokens of the line, in order
+    std::vector<Token> fresh;               // Reused storage for the tokens of an edit
+    std::string unquoted;                   // Text of the quoted tokens, and of dropped ones until compacted
+    size_t unquotedLive = 0;                // Bytes of unquoted still used by tokens
+    Context last;                           // Matcher state after the last token
+    ParseResult lastStatus = ParseResult::Success;  // Result of the end of the line, for an option still waiting for its value
+    int8_t lastCode = -1;                   // DiagnosticCode of that, or -1
+    int32_t lastOption = -1;                // Option of that
+    size_t stops = 0;                       // Tokens whose status is not Success
+    size_t rematched = 0;                   // Tokens re-matched by the last edit
+    size_t shiftFrom = 0;                   // First token whose offsets are stored without shiftBy
+    uint32_t shiftBy = 0;                   // Bytes the edits since moved the tokens from shiftFrom on
+    MatchState state;                       // Reused matcher state
+    Diagnostics diagnostics;                // Receives the error of the token being matched
+    TokenArena arena;                       // Unquoted tokens of the current edit, until copied
+    std::vector<TypedValue> typedScratch;   // Reused storage for checking typed values
+    mutable std::vector<int32_t> ids;       // Reused storage for completion keys
+    ArgView prefixLong;                     // Long option prefix
+    ArgView prefixShort;                    // Short option prefix
+    bool windowsQuoting = false;            // Tokenize with Windows quoting rules
+    bool foldCase = false;                  // Complete ignoring ASCII case
+};
+
+#undef ParserOptionsExist
 
+// The header-only build compiles the implementation in every translation unit that includes it
+#if !defined(ARGHAND_SEPARATE_COMPILATION)
+#include "Arghand.inl"
+#endif
 
 #endif // ARGHAND_H
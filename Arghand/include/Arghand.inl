@@ -0,0 +1,2858 @@
+/*+++
+Arghand.inl - Implementation of the Arghand Argument Handler Library
+
+Included by Arghand.h in the header-only build, and compiled once by src/Arghand.cpp when
+ARGHAND_SEPARATE_COMPILATION is defined. Not meant to be included anywhere else.
+
+Licensed under the BSD 2-Clause License. See LICENSE file in the project/package root for details.
+
+Author: Antonako1
+---*/
+#pragma once
+#ifndef ARGHAND_INL
+#define ARGHAND_INL
+
+#include "Arghand.h"
+
+#include <thread>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Functions are inline in the header-only build, and compiled once by src/Arghand.cpp otherwise
+#if defined(ARGHAND_SEPARATE_COMPILATION)
+#define ARGHAND_DECL
+#else
+#define ARGHAND_DECL inline
+#endif
+
+#define ParserOptionsExist(x) ((QSTU64(parserOptions) & QSTU64(x)) != 0)
+
+// SIMD token scanning, picked at compile time. Define ARGHAND_NO_SIMD to force the scalar scanner.
+#if !defined(ARGHAND_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ARGHAND_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ARGHAND_SSE2 1
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ARGHAND_NEON 1
+#endif
+#if (defined(ARGHAND_AVX2) || defined(ARGHAND_SSE2) || defined(ARGHAND_NEON)) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif // ARGHAND_NO_SIMD
+
+#if defined(ARGHAND_AVX2) || defined(ARGHAND_SSE2) || defined(ARGHAND_NEON)
+/// Index of the lowest set bit, mask must not be 0.
+inline unsigned ArghandCountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+#if defined(ARGHAND_SSE2) || defined(ARGHAND_NEON)
+/// Bit i is set when block[i] == c, for the 16 bytes at block.
+inline uint32_t ArghandMatch16(const char* block, char c) {
+#if defined(ARGHAND_SSE2)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+#else
+    // NEON has no movemask, weight each matching byte by its bit and add up each half
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(block)), vdupq_n_u8(static_cast<uint8_t>(c)));
+    uint8x16_t bits = vandq_u8(eq, vld1q_u8(weights));
+    return static_cast<uint32_t>(vaddv_u8(vget_low_u8(bits))) | (static_cast<uint32_t>(vaddv_u8(vget_high_u8(bits))) << 8);
+#endif
+}
+#endif
+
+ARGHAND_DECL const char* ArghandFindCharBlocks(const char* first, const char* last, char c) {
+#if defined(ARGHAND_AVX2)
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (last - first >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+        if (mask) return first + ArghandCountTrailingZeros(mask);
+        first += 32;
+    }
+#endif
+#if defined(ARGHAND_SSE2) || defined(ARGHAND_NEON)
+    while (last - first >= 16) {
+        uint32_t mask = ArghandMatch16(first, c);
+        if (mask) return first + ArghandCountTrailingZeros(mask);
+        first += 16;
+    }
+#endif
+    while (first != last && *first != c) ++first;
+    return first;
+}
+
+/// Calls fn with the offset of every separator in data, in order, in one vectorized pass.
+template<typename Fn>
+inline void ArghandForEachSeparator(const char* data, size_t size, char separator, Fn fn) {
+    size_t i = 0;
+#if defined(ARGHAND_SSE2) || defined(ARGHAND_NEON)
+    for (; i + 16 <= size; i += 16) {
+        for (uint32_t mask = ArghandMatch16(data + i, separator); mask; mask &= mask - 1) {
+            fn(i + ArghandCountTrailingZeros(mask));
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] == separator) fn(i);
+    }
+}
+
+ARGHAND_DECL void ArghandSplitOffsets(const char* data, size_t size, char separator, std::vector<uint32_t>& ends) {
+    ArghandForEachSeparator(data, size, separator, [&ends](size_t offset) { ends.push_back(static_cast<uint32_t>(offset)); });
+    ends.push_back(static_cast<uint32_t>(size));
+}
+
+// Classes only the implementation uses
+
+/// Decimal number held as its digits on a fixed buffer, for the values Convert(value, double&) cannot
+/// convert exactly with one floating point operation: more than 19 significant digits, or a large
+/// exponent. It is scaled by powers of two digit by digit until its integer part is the mantissa,
+/// which is then rounded to nearest, ties to even, so the result is correctly rounded. Nothing is allocated.
+class Arghand::Decimal {
+public:
+    /// Reads digits [. digits] [e [sign] digits] from [c, end), unsigned and already validated.
+    Decimal(const char* c, const char* end);
+
+    /// Converts to the nearest double. Values too small for a double become zero.
+    /// @return False if the value is too large for a double
+    bool ToDouble(double& out);
+
+private:
+    static const int Capacity = 800;    // Digits kept, enough to round any double correctly
+    static const int MaxShift = 60;     // Largest shift in one pass, 10 << MaxShift fits 64 bits
+    static const int ShiftDigits = 19;  // Most digits a shift by MaxShift adds in front
+
+    /// Multiplies by 2^k, or divides by 2^-k for a negative k.
+    void Shift(int k);
+    void LeftShift(unsigned k);
+    void RightShift(unsigned k);
+    /// Drops trailing zero digits.
+    void Trim();
+    /// Checks if the digits from index on round the digits before up.
+    bool ShouldRoundUp(int index) const;
+    /// Gets the integer part, rounded.
+    uint64_t RoundedInteger() const;
+
+    char digits[Capacity + ShiftDigits];    // Digit values, most significant first, room in front of a left shift
+    int count;                              // Digits used
+    int point;                              // Position of the decimal point: the value is 0.digits * 10^point
+    bool truncated;                         // Non-zero digits beyond Capacity were dropped
+};
+
+/// Read-only memory mapping of a whole file.
+/// Pages are loaded on demand and, being clean file-backed pages, can be dropped by the OS
+/// at any time, so even huge response files keep resident memory bounded.
+class Arghand::MappedFile {
+public:
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Maps the file at path.
+    /// @return False if the file cannot be opened or mapped.
+    bool Open(const std::string& path);
+
+    /// Unmaps the file.
+    void Close();
+
+    const char* Data() const { return data ? data : ""; }
+    size_t Size() const { return size; }
+
+private:
+#if defined(_WIN32)
+    void* file = nullptr;       // HANDLE of the open file, null if none
+    void* mapping = nullptr;    // HANDLE of the file mapping, null if none
+#endif
+    const char* data;   // Start of the mapping, null if nothing is mapped
+    size_t size;        // Size of the file in bytes
+};
+
+/// Lazy tokenizer for response files and command strings.
+/// Tokens are separated by whitespace. With POSIX rules single quotes keep everything literally, double quotes
+/// group whitespace and a backslash outside single quotes escapes the next character. With Windows rules
+/// only double quotes group and backslashes are literal unless they precede a double quote.
+/// Plain tokens are returned as views into the buffer, only tokens with quotes or escapes are
+/// rewritten into the arena.
+class Arghand::ArgTokenizer {
+public:
+    /// @param windows Use Windows quoting rules instead of POSIX shell rules
+    ArgTokenizer(const char* data, size_t size, TokenArena& arena, bool windows = false)
+        : pos(data), end(data + size), arena(arena), windows(windows) {}
+
+    /// Gets the text not tokenized yet.
+    ArgView Rest() const { return ArgView(pos, static_cast<size_t>(end - pos)); }
+    /// Gets the last token as it was written, quotes and escapes included.
+    ArgView Raw() const { return ArgView(start, static_cast<size_t>(pos - start)); }
+
+    /// Gets the next token.
+    /// @return False when the buffer has no more tokens.
+    bool Next(ArgView& token);
+
+private:
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+    static bool IsSpecial(char c) {
+        return IsSpace(c) || c == '"' || c == '\'' || c == '\\';
+    }
+
+    /// Finds the first whitespace, quote or backslash, or end. Scans 32 or 16 bytes at a time where available.
+    static const char* ScanSpecial(const char* c, const char* end);
+
+#if defined(ARGHAND_AVX2)
+    /// Scans whole 32 byte blocks, stops at the first special character or before the tail.
+    static const char* ScanSpecialAvx2(const char* c, const char* end) {
+        const __m256i space = _mm256_set1_epi8(' '), dquote = _mm256_set1_epi8('"');
+        const __m256i squote = _mm256_set1_epi8('\''), backslash = _mm256_set1_epi8('\\');
+        const __m256i tab = _mm256_set1_epi8('\t'), ctrl_span = _mm256_set1_epi8('\r' - '\t');
+        while (end - c >= 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+            // '\t'..'\r' are contiguous, so they are the bytes with c - '\t' <= 4 as unsigned
+            __m256i ctrl = _mm256_sub_epi8(v, tab);
+            __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, ctrl_span), ctrl);
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, space));
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, dquote));
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, squote));
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, backslash));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+            if (mask) return c + ArghandCountTrailingZeros(mask);
+            c += 32;
+        }
+        return c;
+    }
+#endif
+
+#if defined(ARGHAND_SSE2)
+    /// Scans whole 16 byte blocks, stops at the first special character or before the tail.
+    static const char* ScanSpecialSse2(const char* c, const char* end) {
+        const __m128i space = _mm_set1_epi8(' '), dquote = _mm_set1_epi8('"');
+        const __m128i squote = _mm_set1_epi8('\''), backslash = _mm_set1_epi8('\\');
+        const __m128i tab = _mm_set1_epi8('\t'), ctrl_span = _mm_set1_epi8('\r' - '\t');
+        while (end - c >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+            __m128i ctrl = _mm_sub_epi8(v, tab);
+            __m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(ctrl, ctrl_span), ctrl);
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, space));
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, dquote));
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, squote));
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backslash));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+            if (mask) return c + ArghandCountTrailingZeros(mask);
+            c += 16;
+        }
+        return c;
+    }
+#endif
+
+    /// Unquotes the token starting at start into out, or only measures it if out is null.
+    /// @param size Receives the unquoted size
+    /// @return The end of the raw token
+    const char* Unquote(const char* start, char* out, size_t& size) const;
+
+    static void Put(char* out, size_t& size, char c) {
+        if (out) out[size] = c;
+        ++size;
+    }
+
+    const char* pos;        // Next character to scan
+    const char* end;        // End of the buffer
+    const char* start = nullptr;    // Start of the last token
+    TokenArena& arena;      // Storage for rewritten tokens
+    bool windows;           // Windows quoting rules
+};
+
+/// Hands out the items of a batch in chunks. Each worker starts on its own contiguous range
+/// and, once that is done, steals chunks from the ranges of the others.
+class Arghand::Spec::BatchQueue {
+public:
+    BatchQueue(size_t count, unsigned workers) : ranges(new Range[workers]), size(workers) {
+        for (unsigned w = 0; w < workers; ++w) {
+            ranges[w].next.store(count * w / workers, std::memory_order_relaxed);
+            ranges[w].end = count * (w + 1) / workers;
+        }
+    }
+
+    /// Takes the next chunk [first, last) for worker self, false once all items are taken.
+    bool Take(unsigned self, size_t& first, size_t& last);
+
+private:
+    static const size_t ChunkSize = 64;
+    // Padded to a cache line, so that workers do not contend on each other's counters
+    struct Range {
+        std::atomic<size_t> next;
+        size_t end;
+        char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    };
+    std::unique_ptr<Range[]> ranges;
+    unsigned size;
+};
+
+// Arghand
+
+ARGHAND_DECL uint64_t Arghand::ElapsedNs(const std::chrono::steady_clock::time_point& start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+ARGHAND_DECL int Arghand::ToInteger(const std::string& value, ConvertResult* error) {
+    int result = 0;
+    ConvertResult res = Convert(value, result);
+    if (error) {
+        *error = res;
+    } else if (res == ConvertResult::OutOfRange) {
+        Output::ToFile(stderr).Write("Integer value out of range: " + value + "\n");
+    } else if (res != ConvertResult::Success) {
+        Output::ToFile(stderr).Write("Invalid integer value: " + value + "\n");
+    }
+    return res == ConvertResult::Success ? result : 0;
+}
+
+ARGHAND_DECL double Arghand::ToDouble(const std::string& value, ConvertResult* error) {
+    double result = 0.0;
+    ConvertResult res = Convert(value, result);
+    if (error) {
+        *error = res;
+    } else if (res == ConvertResult::OutOfRange) {
+        Output::ToFile(stderr).Write("Double value out of range: " + value + "\n");
+    } else if (res != ConvertResult::Success) {
+        Output::ToFile(stderr).Write("Invalid double value: " + value + "\n");
+    }
+    return res == ConvertResult::Success ? result : 0.0;
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::Convert(const ArgView& value, bool& out) {
+    if (value.empty()) return ConvertResult::Empty;
+    static const char* const trueValues[] = { "true", "1", "yes", "on" };
+    static const char* const falseValues[] = { "false", "0", "no", "off" };
+    for (size_t i = 0; i < 4; ++i) {
+        if (EqualsIgnoreCase(value, trueValues[i])) { out = true; return ConvertResult::Success; }
+        if (EqualsIgnoreCase(value, falseValues[i])) { out = false; return ConvertResult::Success; }
+    }
+    return ConvertResult::Invalid;
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::Convert(const ArgView& value, double& out) {
+    if (value.empty()) return ConvertResult::Empty;
+    const char* c = value.begin();
+    const char* end = value.end();
+    bool negative = false;
+    if (*c == '+' || *c == '-') negative = *c++ == '-';
+
+    ArgView rest(c, static_cast<size_t>(end - c));
+    if (EqualsIgnoreCase(rest, "inf") || EqualsIgnoreCase(rest, "infinity")) {
+        out = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return ConvertResult::Success;
+    }
+    if (EqualsIgnoreCase(rest, "nan")) {
+        out = std::numeric_limits<double>::quiet_NaN();
+        return ConvertResult::Success;
+    }
+
+    // Up to 19 significant digits go into the mantissa, the rest only move the exponent
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool inexact = false;
+    bool any = false;
+    for (; c != end && IsDigit(*c); ++c) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*c - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+            inexact |= *c != '0';
+        }
+    }
+    if (c != end && *c == '.') {
+        for (++c; c != end && IsDigit(*c); ++c) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*c - '0');
+                digits += mantissa != 0;
+                --exponent;
+            } else {
+                inexact |= *c != '0';
+            }
+        }
+    }
+    if (!any) return ConvertResult::Invalid;
+    if (c != end && (*c == 'e' || *c == 'E')) {
+        ++c;
+        bool negative_exponent = false;
+        if (c != end && (*c == '+' || *c == '-')) negative_exponent = *c++ == '-';
+        if (c == end || !IsDigit(*c)) return ConvertResult::Invalid;
+        int written = 0;
+        for (; c != end && IsDigit(*c); ++c) {
+            if (written < 100000) written = written * 10 + (*c - '0');
+        }
+        exponent += negative_exponent ? -written : written;
+    }
+    if (c != end) return ConvertResult::Invalid;
+
+    // Exact when both the mantissa and the power of ten are exactly representable
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    double result;
+    if (mantissa == 0) {
+        result = 0.0;
+    } else if (!inexact && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+    } else {
+        // Rare, correctly rounded on the digits themselves
+        Decimal decimal(value.begin() + (value[0] == '+' || value[0] == '-'), end);
+        if (!decimal.ToDouble(result)) return ConvertResult::OutOfRange;
+    }
+    out = negative ? -result : result;
+    return ConvertResult::Success;
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::Convert(const ArgView& value, float& out) {
+    double result = 0.0;
+    ConvertResult res = Convert(value, result);
+    if (res != ConvertResult::Success) return res;
+    if (std::fabs(result) > std::numeric_limits<float>::max() && !std::isinf(result)) return ConvertResult::OutOfRange;
+    out = static_cast<float>(result);
+    return ConvertResult::Success;
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::ToSize(const ArgView& value, uint64_t& out) {
+    if (value.empty()) return ConvertResult::Empty;
+    const char* c = value.begin();
+    const char* end = value.end();
+    if (*c == '+') ++c;
+    uint64_t whole = 0, fraction = 0, scale = 1;
+    const char* stop = ParseNumber(c, end, whole, fraction, scale);
+    if (!stop) return ConvertResult::OutOfRange;
+    if (stop == c) return ConvertResult::Invalid;
+
+    static const char prefixes[] = "kmgtpe";
+    uint64_t multiplier = 1;
+    if (stop != end && *stop != 'B' && *stop != 'b') {
+        const char* prefix = std::strchr(prefixes, *stop | 0x20);
+        if (!prefix || !*prefix) return ConvertResult::Invalid;
+        ++stop;
+        uint64_t base = 1024;
+        if (stop != end && (*stop == 'i' || *stop == 'I')) ++stop;
+        else if (stop != end && (*stop == 'B' || *stop == 'b')) base = 1000;
+        for (const char* p = prefixes; p <= prefix; ++p) multiplier *= base;
+    }
+    if (stop != end && (*stop == 'B' || *stop == 'b')) ++stop;
+    if (stop != end) return ConvertResult::Invalid;
+
+    uint64_t bytes = 0;
+    if (!Scale(whole, fraction, scale, multiplier, bytes)) return ConvertResult::OutOfRange;
+    out = bytes;
+    return ConvertResult::Success;
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::ToIntegers(const ArgSplitView& list, std::vector<int64_t>& out) {
+    if (!list.more.empty()) {
+        ConvertResult res = ToIntegers(ArgSplitView(list.value, list.separator, list.split), out);
+        for (const ArgView& item : list.more) {
+            if (res == ConvertResult::Success) res = ToIntegers(ArgSplitView(item, list.separator, list.split), out);
+        }
+        return res;
+    }
+    const char* c = list.value.begin();
+    const char* end = list.value.end();
+    if (c == end) return ConvertResult::Success;
+    if (!list.split) {
+        int64_t value = 0;
+        ConvertResult res = Convert(list.value, value);
+        if (res == ConvertResult::Success) out.push_back(value);
+        return res;
+    }
+    for (;;) {
+        bool negative = false;
+        uint64_t magnitude = 0;
+        const char* start = c;
+        c = ParseDecimal(c, end, negative, magnitude);
+        if (!c) return ConvertResult::OutOfRange;
+        if (c == start || !IsDigit(c[-1])) {
+            return (c == end || *c == list.separator) && c == start ? ConvertResult::Empty : ConvertResult::Invalid;
+        }
+        int64_t value = 0;
+        ConvertResult res = StoreInteger(negative, magnitude, value);
+        if (res != ConvertResult::Success) return res;
+        out.push_back(value);
+        if (c == end) return ConvertResult::Success;
+        if (*c++ != list.separator) return ConvertResult::Invalid;
+    }
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::ToDoubles(const ArgSplitView& list, std::vector<double>& out) {
+    if (list.value.empty() && list.more.empty()) return ConvertResult::Success;
+    for (const ArgView& item : list) {
+        double value = 0.0;
+        ConvertResult res = Convert(item, value);
+        if (res != ConvertResult::Success) return res;
+        out.push_back(value);
+    }
+    return ConvertResult::Success;
+}
+
+// Arghand::Output
+
+ARGHAND_DECL void Arghand::Output::Write(const std::string& data) const {
+    switch (kind) {
+    case Kind::File:
+        // Keep errors in order with what is already printed, as std::cerr does being tied to std::cout
+        if (file == stderr) std::fflush(stdout);
+        std::fwrite(data.data(), 1, data.size(), file);
+        std::fflush(file);
+        break;
+    case Kind::Stream:
+        streamWrite(stream, data.data(), data.size());
+        break;
+    case Kind::Descriptor:
+        for (size_t done = 0; done < data.size();) {
+#if defined(_WIN32)
+            int n = _write(fd, data.data() + done, static_cast<unsigned int>(data.size() - done));
+#else
+            ssize_t n = write(fd, data.data() + done, data.size() - done);
+#endif
+            if (n <= 0) break;
+            done += static_cast<size_t>(n);
+        }
+        break;
+    case Kind::String:
+        text->append(data);
+        break;
+    case Kind::Buffer: {
+        size_t size = std::min(data.size(), capacity);
+        std::memcpy(buffer, data.data(), size);
+        if (written) *written = size;
+        break;
+    }
+    }
+}
+
+// Arghand
+
+ARGHAND_DECL const char* Arghand::ParseDecimal(const char* c, const char* end, bool& negative, uint64_t& magnitude) {
+    negative = false;
+    if (c != end && (*c == '+' || *c == '-')) negative = *c++ == '-';
+    // 19 digits never overflow, only check beyond that
+    const char* fast_end = c + std::min<ptrdiff_t>(end - c, 19);
+    uint64_t result = 0;
+    for (; c != fast_end && IsDigit(*c); ++c) result = result * 10 + static_cast<uint64_t>(*c - '0');
+    for (; c != end && IsDigit(*c); ++c) {
+        uint64_t digit = static_cast<uint64_t>(*c - '0');
+        if (result > (std::numeric_limits<uint64_t>::max() - digit) / 10) return nullptr;
+        result = result * 10 + digit;
+    }
+    magnitude = result;
+    return c;
+}
+
+ARGHAND_DECL const char* Arghand::ParseNumber(const char* c, const char* end, uint64_t& whole, uint64_t& fraction, uint64_t& scale) {
+    bool negative = false;
+    const char* start = c;
+    if (c != end && (*c == '+' || *c == '-')) return c;
+    c = ParseDecimal(c, end, negative, whole);
+    if (!c) return nullptr;
+    fraction = 0;
+    scale = 1;
+    if (c != end && *c == '.' && (c != start || (c + 1 != end && IsDigit(c[1])))) {
+        for (++c; c != end && IsDigit(*c); ++c) {
+            if (scale < 1000000000000000000ull) {
+                fraction = fraction * 10 + static_cast<uint64_t>(*c - '0');
+                scale *= 10;
+            }
+        }
+    }
+    return c;
+}
+
+// Arghand::Decimal
+
+ARGHAND_DECL Arghand::Decimal::Decimal(const char* c, const char* end) : count(0), point(0), truncated(false) {
+    bool fraction = false;
+    for (; c != end; ++c) {
+        if (*c == '.') {
+            fraction = true;
+            continue;
+        }
+        if (!IsDigit(*c)) break;
+        if (*c == '0' && count == 0) {
+            point -= fraction; // Leading zeros only move the point, and only after it
+            continue;
+        }
+        point += !fraction;
+        if (count < Capacity) {
+            digits[count++] = static_cast<char>(*c - '0');
+        } else if (*c != '0') {
+            truncated = true;
+        }
+    }
+    if (c != end && (*c == 'e' || *c == 'E')) {
+        ++c;
+        bool negative = false;
+        if (c != end && (*c == '+' || *c == '-')) negative = *c++ == '-';
+        int exponent = 0;
+        for (; c != end && IsDigit(*c); ++c) {
+            if (exponent < 100000) exponent = exponent * 10 + (*c - '0');
+        }
+        point += negative ? -exponent : exponent;
+    }
+    Trim();
+}
+
+ARGHAND_DECL bool Arghand::Decimal::ToDouble(double& out) {
+    const int bias = -1023;
+    const int mantissaBits = 52;
+    const int exponentMax = 2047;
+    // Binary exponent that brings 10^point closer to [0.5, 1) without passing it, by point
+    static const int powers[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+
+    uint64_t mantissa = 0;
+    int exponent = bias;
+    if (count == 0 || point < -330) {
+        // Zero, or too small even for a denormal
+    } else if (point > 310) {
+        return false;
+    } else {
+        // Scale to [0.5, 1), then make room for the denormal range
+        exponent = 0;
+        while (point > 0) {
+            int n = point < 9 ? powers[point] : 27;
+            Shift(-n);
+            exponent += n;
+        }
+        while (point < 0 || (point == 0 && digits[0] < 5)) {
+            int n = -point < 9 ? powers[-point] : 27;
+            Shift(n);
+            exponent -= n;
+        }
+        --exponent; // [0.5, 1) is [1, 2) one exponent lower
+        if (exponent < bias + 1) {
+            int n = bias + 1 - exponent;
+            Shift(-n);
+            exponent += n;
+        }
+        if (exponent - bias >= exponentMax) return false;
+
+        Shift(1 + mantissaBits);
+        mantissa = RoundedInteger();
+        if (mantissa == uint64_t(2) << mantissaBits) {
+            // Rounding carried into a new bit
+            mantissa >>= 1;
+            if (++exponent - bias >= exponentMax) return false;
+        }
+        if (!(mantissa & (uint64_t(1) << mantissaBits))) exponent = bias; // Denormal
+    }
+
+    uint64_t bits = (mantissa & ((uint64_t(1) << mantissaBits) - 1)) | (static_cast<uint64_t>(exponent - bias) << mantissaBits);
+    std::memcpy(&out, &bits, sizeof(out));
+    return true;
+}
+
+ARGHAND_DECL void Arghand::Decimal::Shift(int k) {
+    if (count == 0) return;
+    for (; k > MaxShift; k -= MaxShift) LeftShift(MaxShift);
+    for (; k < -MaxShift; k += MaxShift) RightShift(MaxShift);
+    if (k > 0) LeftShift(static_cast<unsigned>(k));
+    else if (k < 0) RightShift(static_cast<unsigned>(-k));
+}
+
+ARGHAND_DECL void Arghand::Decimal::LeftShift(unsigned k) {
+    // Written from the last digit down, ShiftDigits further on, then moved to the front
+    int end = count + ShiftDigits;
+    int w = end;
+    uint64_t n = 0;
+    for (int r = count - 1; r >= 0; --r) {
+        n += static_cast<uint64_t>(digits[r]) << k;
+        uint64_t quotient = n / 10;
+        digits[--w] = static_cast<char>(n - quotient * 10);
+        n = quotient;
+    }
+    for (; n > 0; n /= 10) {
+        digits[--w] = static_cast<char>(n % 10);
+    }
+    int produced = end - w;
+    point += produced - count;
+    std::memmove(digits, digits + w, static_cast<size_t>(produced));
+    count = produced;
+    if (count > Capacity) {
+        for (int i = Capacity; i < count; ++i) truncated |= digits[i] != 0;
+        count = Capacity;
+    }
+    Trim();
+}
+
+ARGHAND_DECL void Arghand::Decimal::RightShift(unsigned k) {
+    int r = 0;
+    int w = 0;
+    uint64_t n = 0;
+    // Read enough leading digits for the first output digit
+    for (; (n >> k) == 0; ++r) {
+        if (r >= count) {
+            for (; (n >> k) == 0; ++r) n *= 10;
+            break;
+        }
+        n = n * 10 + static_cast<uint64_t>(digits[r]);
+    }
+    point -= r - 1;
+
+    const uint64_t mask = (uint64_t(1) << k) - 1;
+    for (; r < count; ++r) {
+        uint64_t digit = n >> k;
+        n = (n & mask) * 10 + static_cast<uint64_t>(digits[r]);
+        digits[w++] = static_cast<char>(digit);
+    }
+    for (; n > 0; n = (n & mask) * 10) {
+        uint64_t digit = n >> k;
+        if (w < Capacity) {
+            digits[w++] = static_cast<char>(digit);
+        } else if (digit > 0) {
+            truncated = true;
+        }
+    }
+    count = w;
+    Trim();
+}
+
+ARGHAND_DECL void Arghand::Decimal::Trim() {
+    while (count > 0 && digits[count - 1] == 0) --count;
+    if (count == 0) point = 0;
+}
+
+ARGHAND_DECL bool Arghand::Decimal::ShouldRoundUp(int index) const {
+    if (index < 0 || index >= count) return false;
+    if (digits[index] == 5 && index + 1 == count) {
+        // Exactly halfway goes to even, dropped digits make it more than halfway
+        if (truncated) return true;
+        return index > 0 && digits[index - 1] % 2 == 1;
+    }
+    return digits[index] >= 5;
+}
+
+ARGHAND_DECL uint64_t Arghand::Decimal::RoundedInteger() const {
+    if (point > 20) return std::numeric_limits<uint64_t>::max();
+    uint64_t n = 0;
+    int i = 0;
+    for (; i < point && i < count; ++i) n = n * 10 + static_cast<uint64_t>(digits[i]);
+    for (; i < point; ++i) n *= 10;
+    if (ShouldRoundUp(point)) ++n;
+    return n;
+}
+
+// Arghand::StringPool
+
+ARGHAND_DECL Arghand::StringPool::Ref Arghand::StringPool::Append(const ArgView& prefix, const ArgView& str, bool fold_case) {
+    Ref ref;
+    ref.offset = static_cast<uint32_t>(text.size());
+    ref.size = static_cast<uint32_t>(prefix.size + str.size);
+    text.append(prefix.data, prefix.size).append(str.data, str.size);
+    if (fold_case) {
+        for (size_t i = ref.offset; i < text.size(); ++i) text[i] = FoldChar(text[i]);
+    }
+    return ref;
+}
+
+ARGHAND_DECL Arghand::StringPool::Ref Arghand::StringPool::Intern(const ArgView& str) {
+    if (str.empty()) return Ref();
+    if (interned * 2 >= slots.size()) {
+        std::vector<Ref> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 64 : old.size() * 2, EmptySlot());
+        for (const Ref& ref : old) {
+            if (ref.offset != EmptySlot().offset) Place(ref);
+        }
+    }
+    size_t mask = slots.size() - 1;
+    for (size_t pos = Hash(str.data, str.size, false) & mask; slots[pos].offset != EmptySlot().offset; pos = (pos + 1) & mask) {
+        if (Get(slots[pos]) == str) return slots[pos];
+    }
+    Ref ref = Append(ArgView(), str);
+    Place(ref);
+    ++interned;
+    return ref;
+}
+
+// Arghand::OptionIndex
+
+ARGHAND_DECL void Arghand::OptionIndex::Insert(const ArgView& prefix, const ArgView& name, int32_t id) {
+    if (name.empty()) return;
+    size_t mark = keys.size();
+    Entry entry;
+    entry.key = keys.Append(prefix, name, fold);
+    entry.id = id;
+    ArgView key = keys.Get(entry.key);
+    if (Find(key.data, key.size) >= 0) {
+        keys.Truncate(mark);
+        return;
+    }
+    entries.push_back(entry);
+    if (entries.size() * 2 > slots.size()) {
+        Rehash(slots.empty() ? 16 : slots.size() * 2);
+    } else {
+        Place(static_cast<int32_t>(entries.size() - 1));
+    }
+}
+
+ARGHAND_DECL int32_t Arghand::OptionIndex::Find(const char* token, size_t length) const {
+    if (slots.empty()) return -1;
+    uint32_t hash = StringPool::Hash(token, length, fold);
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        const Slot& slot = slots[pos];
+        if (slot.entry < 0) return -1;
+        if (slot.hash == hash && Equals(keys.Get(entries[slot.entry].key), token, length)) {
+            return entries[slot.entry].id;
+        }
+    }
+}
+
+ARGHAND_DECL void Arghand::OptionIndex::Rehash(size_t capacity) {
+    Slot empty;
+    empty.hash = 0;
+    empty.entry = -1;
+    slots.assign(capacity, empty);
+    mask = capacity - 1;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Place(static_cast<int32_t>(i));
+    }
+}
+
+// Arghand::NameTrie
+
+ARGHAND_DECL void Arghand::NameTrie::Build(const std::vector<std::pair<ArgView, int32_t>>& names, bool fold_case) {
+    fold = fold_case;
+    pool.clear();
+    nodes.clear();
+    keys.clear();
+    maxLength = 0;
+    for (const auto& name : names) {
+        if (name.first.empty()) continue;
+        Key key;
+        key.offset = static_cast<uint32_t>(pool.size());
+        key.size = static_cast<uint32_t>(name.first.size);
+        key.id = name.second;
+        key.order = static_cast<uint32_t>(keys.size());
+        for (char c : name.first) pool += fold ? FoldChar(c) : c;
+        keys.push_back(key);
+        maxLength = std::max<size_t>(maxLength, key.size);
+    }
+    std::sort(keys.begin(), keys.end(), [this](const Key& a, const Key& b) {
+        int cmp = Compare(a, b);
+        return cmp != 0 ? cmp < 0 : a.order < b.order;
+    });
+
+    nodes.push_back(Node());
+    Fill(0, 0, keys.size(), 0);
+}
+
+ARGHAND_DECL void Arghand::NameTrie::Suggest(const char* token, size_t length, size_t maxDistance, size_t limit, std::vector<int32_t>& out) const {
+    if (nodes.empty()) return;
+    const size_t width = length + 1;
+    std::vector<uint32_t> rows((maxLength + 1) * width);
+    for (size_t j = 0; j < width; ++j) rows[j] = static_cast<uint32_t>(j);
+
+    std::vector<std::pair<uint32_t, int32_t>> found;
+    uint32_t bound = static_cast<uint32_t>(maxDistance);
+    SuggestFrom(0, 0, token, length, bound, rows, found);
+    // The bound tightened while searching, drop what was found before that
+    found.erase(std::remove_if(found.begin(), found.end(), [bound](const std::pair<uint32_t, int32_t>& f) { return f.first > bound; }), found.end());
+    std::stable_sort(found.begin(), found.end(), [](const std::pair<uint32_t, int32_t>& a, const std::pair<uint32_t, int32_t>& b) {
+        return a.first < b.first;
+    });
+    for (size_t i = 0; i < found.size() && i < limit; ++i) {
+        out.push_back(found[i].second);
+    }
+}
+
+ARGHAND_DECL void Arghand::NameTrie::Fill(size_t node, size_t first, size_t last, size_t depth) {
+    int32_t unique = -1;
+    // A name ending here sorts first, equal names after it are duplicates
+    while (first < last && keys[first].size == depth) {
+        if (nodes[node].id < 0) nodes[node].id = unique = keys[first].id;
+        ++first;
+    }
+
+    // One child per distinct character at depth, allocated as a block
+    size_t groups = 0;
+    for (size_t i = first; i < last; ++i) {
+        if (i == first || At(keys[i], depth) != At(keys[i - 1], depth)) ++groups;
+    }
+    size_t child = nodes.size();
+    nodes[node].firstChild = static_cast<uint32_t>(child);
+    nodes[node].childCount = static_cast<uint32_t>(groups);
+    nodes.resize(child + groups);
+
+    for (size_t begin = first; begin < last; ++child) {
+        size_t end = begin + 1;
+        while (end < last && At(keys[end], depth) == At(keys[begin], depth)) ++end;
+
+        // Sorted, so the common prefix of the group is that of its first and last name
+        const Key& low = keys[begin];
+        const Key& high = keys[end - 1];
+        size_t common = depth + 1;
+        while (common < low.size && common < high.size && At(low, common) == At(high, common)) ++common;
+
+        nodes[child].label = static_cast<uint32_t>(low.offset + depth);
+        nodes[child].first = At(low, depth);
+        nodes[child].labelSize = static_cast<uint32_t>(common - depth);
+        Fill(child, begin, end, common);
+
+        int32_t sub = nodes[child].unique;
+        unique = (unique == -1) ? sub : (sub == -1 || sub == unique ? unique : Ambiguous);
+        begin = end;
+    }
+    nodes[node].unique = unique;
+}
+
+ARGHAND_DECL int32_t Arghand::NameTrie::Walk(const char* token, size_t length) const {
+    if (nodes.empty()) return -1;
+    size_t node = 0;
+    size_t i = 0;
+    while (i < length) {
+        const Node& parent = nodes[node];
+        char c = fold ? FoldChar(token[i]) : token[i];
+        // Binary search over the children's first characters
+        size_t low = parent.firstChild;
+        size_t high = parent.firstChild + parent.childCount;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (static_cast<unsigned char>(nodes[mid].first) < static_cast<unsigned char>(c)) low = mid + 1;
+            else high = mid;
+        }
+        if (low == parent.firstChild + parent.childCount || nodes[low].first != c) return -1;
+
+        const Node& next = nodes[low];
+        size_t n = std::min<size_t>(next.labelSize, length - i);
+        for (size_t k = 1; k < n; ++k) {
+            char t = fold ? FoldChar(token[i + k]) : token[i + k];
+            if (pool[next.label + k] != t) return -1;
+        }
+        i += n;
+        node = low;
+    }
+    return static_cast<int32_t>(node);
+}
+
+ARGHAND_DECL void Arghand::NameTrie::SuggestFrom(size_t node, size_t depth, const char* token, size_t length, uint32_t& maxDistance,
+                                                 std::vector<uint32_t>& rows, std::vector<std::pair<uint32_t, int32_t>>& found) const {
+    const size_t width = length + 1;
+    for (uint32_t c = 0; c < nodes[node].childCount; ++c) {
+        const Node& child = nodes[nodes[node].firstChild + c];
+        size_t d = depth;
+        bool reachable = true;
+        for (uint32_t k = 0; k < child.labelSize && reachable; ++k, ++d) {
+            char ch = pool[child.label + k];
+            const uint32_t* prev = &rows[d * width];
+            uint32_t* row = &rows[(d + 1) * width];
+            row[0] = prev[0] + 1;
+            uint32_t best = row[0];
+            for (size_t j = 1; j < width; ++j) {
+                char t = fold ? FoldChar(token[j - 1]) : token[j - 1];
+                uint32_t cost = prev[j - 1] + (t == ch ? 0 : 1);
+                cost = std::min(cost, prev[j] + 1);
+                cost = std::min(cost, row[j - 1] + 1);
+                row[j] = cost;
+                best = std::min(best, cost);
+            }
+            reachable = best <= maxDistance;
+        }
+        if (!reachable) continue;
+        if (child.id >= 0 && rows[d * width + length] <= maxDistance) {
+            maxDistance = rows[d * width + length];
+            found.push_back(std::make_pair(maxDistance, child.id));
+        }
+        SuggestFrom(nodes[node].firstChild + c, d, token, length, maxDistance, rows, found);
+    }
+}
+
+// Arghand::OptionTable
+
+ARGHAND_DECL void Arghand::OptionTable::Build(const std::vector<CmdOption>& options) {
+    flags.clear();
+    defaults.clear();
+    shortNames.clear();
+    longNames.clear();
+    cold.clear();
+    text.Clear();
+    coldText.Clear();
+    flags.reserve(options.size());
+    defaults.reserve(options.size());
+    shortNames.reserve(options.size());
+    longNames.reserve(options.size());
+    cold.reserve(options.size());
+    size_t hotBytes = 0;
+    size_t coldBytes = 0;
+    for (const auto& option : options) {
+        hotBytes += option.DefaultValue.size() + option.short_name.size() + option.long_name.size();
+        coldBytes += option.description.size() + option.environment.size() + option.configKey.size() + option.allowed.size();
+    }
+    text.Reserve(hotBytes);
+    coldText.Reserve(coldBytes);
+    for (const auto& option : options) {
+        flags.push_back(option.options);
+        defaults.push_back(text.Intern(option.DefaultValue));
+        shortNames.push_back(text.Intern(option.short_name));
+        longNames.push_back(text.Intern(option.long_name));
+
+        Cold entry;
+        // The combined name is nearly always CMD_OPTION's, only store it when it is not
+        entry.customName = option.name != option.short_name + "," + option.long_name;
+        entry.name = entry.customName ? coldText.Intern(option.name) : StringPool::Ref();
+        entry.description = coldText.Intern(option.description);
+        entry.environment = coldText.Intern(option.environment);
+        entry.configKey = coldText.Intern(option.configKey);
+        entry.allowed = coldText.Intern(option.allowed);
+        cold.push_back(entry);
+    }
+    text.Seal();
+    coldText.Seal();
+}
+
+ARGHAND_DECL CmdOption Arghand::OptionTable::GetCmdOption(int32_t id) const {
+    CmdOption option;
+    option.short_name = ShortName(id).str();
+    option.long_name = LongName(id).str();
+    option.name = cold[id].customName ? coldText.Get(cold[id].name).str() : option.short_name + "," + option.long_name;
+    option.options = flags[id];
+    option.DefaultValue = DefaultValue(id).str();
+    option.description = Description(id).str();
+    option.environment = Environment(id).str();
+    option.configKey = ConfigKey(id).str();
+    option.allowed = Allowed(id).str();
+    return option;
+}
+
+// Arghand::MappedFile
+
+ARGHAND_DECL bool Arghand::MappedFile::Open(const std::string& path) {
+    Close();
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    file = handle;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        Close();
+        return false;
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+    if (size == 0) return true;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        Close();
+        return false;
+    }
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        Close();
+        return false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+        ::madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+    }
+    ::close(fd); // The mapping keeps its own reference to the file
+#endif
+    return true;
+}
+
+ARGHAND_DECL void Arghand::MappedFile::Close() {
+#if defined(_WIN32)
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data) ::munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+// Arghand::TokenArena
+
+ARGHAND_DECL char* Arghand::TokenArena::Allocate(size_t size) {
+    if (memory) {
+        char* out = static_cast<char*>(memory->Allocate(size, 1));
+        if (!out) throw std::bad_alloc();
+        return out;
+    }
+    if (chunks.empty() || used + size > chunks[current].size) {
+        // Chunks kept by Clear are reused in order, a new one goes in where the next is too small
+        size_t next = chunks.empty() ? 0 : current + 1;
+        if (next == chunks.size() || chunks[next].size < size) {
+            Chunk chunk;
+            chunk.size = size > ChunkSize ? size : ChunkSize;
+            chunk.data.reset(new char[chunk.size]);
+            ++allocations;
+            allocatedBytes += chunk.size;
+            chunks.insert(chunks.begin() + next, std::move(chunk));
+        }
+        current = next;
+        used = 0;
+    }
+    char* out = chunks[current].data.get() + used;
+    used += size;
+    return out;
+}
+
+// Arghand::ArgTokenizer
+
+ARGHAND_DECL bool Arghand::ArgTokenizer::Next(ArgView& token) {
+    while (pos != end && IsSpace(*pos)) ++pos;
+    if (pos == end) return false;
+
+    // Fast path, a token without quotes or escapes
+    start = pos;
+    for (;;) {
+        pos = ScanSpecial(pos, end);
+        if (pos == end || IsSpace(*pos)) {
+            token = ArgView(start, static_cast<size_t>(pos - start));
+            return true;
+        }
+        if (!windows) break;
+        // Windows rules only treat double quotes and backslashes in front of them specially
+        if (*pos == '\'') { ++pos; continue; }
+        if (*pos == '\\') {
+            while (pos != end && *pos == '\\') ++pos;
+            if (pos == end || *pos != '"') continue;
+        }
+        break;
+    }
+
+    // Slow path, unquote into the arena. The result is never longer than the raw token.
+    size_t size = 0;
+    const char* raw_end = Unquote(start, nullptr, size);
+    size_t raw_size = static_cast<size_t>(raw_end - start);
+    char* out = arena.Allocate(raw_size);
+    Unquote(start, out, size);
+    arena.Shrink(raw_size - size);
+
+    pos = raw_end;
+    token = ArgView(out, size);
+    return true;
+}
+
+ARGHAND_DECL const char* Arghand::ArgTokenizer::ScanSpecial(const char* c, const char* end) {
+#if defined(ARGHAND_AVX2)
+    c = ScanSpecialAvx2(c, end);
+    if (c != end && IsSpecial(*c)) return c;
+#endif
+#if defined(ARGHAND_SSE2)
+    c = ScanSpecialSse2(c, end);
+#endif
+    while (c != end && !IsSpecial(*c)) ++c;
+    return c;
+}
+
+ARGHAND_DECL const char* Arghand::ArgTokenizer::Unquote(const char* start, char* out, size_t& size) const {
+    const char* c = start;
+    size = 0;
+    if (!windows) {
+        // POSIX shell: single quotes are literal, double quotes group, backslash escapes outside single quotes
+        char quote = 0;
+        while (c != end && (quote || !IsSpace(*c))) {
+            if (*c == '\\' && quote != '\'' && c + 1 != end) Put(out, size, *++c);
+            else if (quote && *c == quote) quote = 0;
+            else if (!quote && (*c == '"' || *c == '\'')) quote = *c;
+            else Put(out, size, *c);
+            ++c;
+        }
+        return c;
+    }
+
+    // Windows (CommandLineToArgvW): 2n backslashes before a quote give n backslashes and a quote toggle,
+    // 2n+1 give n backslashes and a literal quote, other backslashes are literal. "" in quotes is a literal quote.
+    bool quoted = false;
+    while (c != end && (quoted || !IsSpace(*c))) {
+        if (*c == '\\') {
+            const char* run = c;
+            while (c != end && *c == '\\') ++c;
+            size_t count = static_cast<size_t>(c - run);
+            if (c != end && *c == '"') {
+                for (size_t i = 0; i < count / 2; ++i) Put(out, size, '\\');
+                if (count % 2) Put(out, size, *c++);
+            } else {
+                for (size_t i = 0; i < count; ++i) Put(out, size, '\\');
+            }
+        }
+        else if (*c == '"') {
+            if (quoted && c + 1 != end && c[1] == '"') {
+                Put(out, size, '"');
+                c += 2;
+            } else {
+                quoted = !quoted;
+                ++c;
+            }
+        }
+        else {
+            Put(out, size, *c++);
+        }
+    }
+    return c;
+}
+
+// Arghand::Config
+
+ARGHAND_DECL bool Arghand::Config::Load(const std::string& path, const std::string& snapshot) {
+    Clear();
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    if (!FileStamp(path, mtime, size)) return false;
+    if (!snapshot.empty() && LoadSnapshot(snapshot, mtime, size)) return true;
+
+    MappedFile file;
+    if (!file.Open(path)) return false;
+    Parse(ArgView(file.Data(), file.Size()));
+    if (!snapshot.empty()) SaveSnapshot(snapshot, mtime, size);
+    return true;
+}
+
+ARGHAND_DECL void Arghand::Config::Parse(const ArgView& content) {
+    Clear();
+    std::string section;
+    const char* end = content.end();
+    for (const char* line = content.begin(); line < end; ) {
+        const char* next = ArghandFindChar(line, end, '\n');
+        ArgView row = Trim(ArgView(line, static_cast<size_t>(next - line)));
+        line = next + (next != end ? 1 : 0);
+
+        if (row.empty() || row[0] == '#' || row[0] == ';') continue;
+        if (row[0] == '[') {
+            const char* close = ArghandFindChar(row.begin(), row.end(), ']');
+            section = Trim(ArgView(row.data + 1, static_cast<size_t>(close - row.data - 1))).str();
+            continue;
+        }
+        const char* equals = ArghandFindChar(row.begin(), row.end(), '=');
+        if (equals == row.end()) continue; // Not an assignment, ignored
+
+        ArgView key = Trim(ArgView(row.data, static_cast<size_t>(equals - row.data)));
+        ArgView value = Trim(ArgView(equals + 1, static_cast<size_t>(row.end() - equals - 1)));
+        if (value.size >= 2 && (value[0] == '"' || value[0] == '\'') && value[value.size - 1] == value[0]) {
+            value = ArgView(value.data + 1, value.size - 2);
+        }
+
+        Entry entry;
+        entry.key = static_cast<uint32_t>(pool.size());
+        if (!section.empty()) pool.append(section).append(1, '.');
+        pool.append(key.data, key.size);
+        entry.keySize = static_cast<uint32_t>(pool.size() - entry.key);
+        entry.value = static_cast<uint32_t>(pool.size());
+        entry.valueSize = static_cast<uint32_t>(value.size);
+        pool.append(value.data, value.size);
+        entries.push_back(entry);
+    }
+
+    // Sorted for binary search, keeping only the last assignment of each key
+    std::stable_sort(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b) {
+        return Key(pool.data(), a) < Key(pool.data(), b);
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i + 1 < entries.size() && Key(pool.data(), entries[i]) == Key(pool.data(), entries[i + 1])) continue;
+        entries[kept++] = entries[i];
+    }
+    entries.resize(kept);
+    Publish(entries.data(), entries.size(), pool.data());
+}
+
+ARGHAND_DECL bool Arghand::Config::Find(const ArgView& key, ArgView& value) const {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (Key(text, table[mid]) < key) low = mid + 1;
+        else high = mid;
+    }
+    if (low == count || Key(text, table[low]) != key) return false;
+    value = ArgView(text + table[low].value, table[low].valueSize);
+    return true;
+}
+
+ARGHAND_DECL bool Arghand::Config::FileStamp(const std::string& path, int64_t& mtime, uint64_t& size) {
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return false;
+    mtime = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return false;
+#if defined(__APPLE__)
+    mtime = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    size = static_cast<uint64_t>(st.st_size);
+#endif
+    return true;
+}
+
+ARGHAND_DECL bool Arghand::Config::LoadSnapshot(const std::string& path, int64_t mtime, uint64_t size) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(path) || file->Size() < sizeof(SnapshotHeader)) return false;
+
+    SnapshotHeader header;
+    std::memcpy(&header, file->Data(), sizeof(header));
+    if (header.magic != SnapshotMagic || header.version != SnapshotVersion ||
+        header.mtime != mtime || header.sourceSize != size) {
+        return false;
+    }
+    // The counts come from the file, bound them by its size before multiplying so nothing wraps
+    uint64_t body = file->Size() - sizeof(header);
+    if (header.count > body / sizeof(Entry) || header.poolSize != body - header.count * sizeof(Entry)) {
+        return false;
+    }
+    const Entry* first = reinterpret_cast<const Entry*>(file->Data() + sizeof(header));
+    const char* base = file->Data() + sizeof(header) + header.count * sizeof(Entry);
+    for (size_t i = 0; i < header.count; ++i) {
+        if (static_cast<uint64_t>(first[i].key) + first[i].keySize > header.poolSize ||
+            static_cast<uint64_t>(first[i].value) + first[i].valueSize > header.poolSize) {
+            return false; // Corrupt, parse the text instead
+        }
+    }
+    snapshot = file;
+    snapshotUsed = true;
+    Publish(first, static_cast<size_t>(header.count), base);
+    return true;
+}
+
+ARGHAND_DECL void Arghand::Config::SaveSnapshot(const std::string& path, int64_t mtime, uint64_t size) const {
+    SnapshotHeader header;
+    header.magic = SnapshotMagic;
+    header.version = SnapshotVersion;
+    header.mtime = mtime;
+    header.sourceSize = size;
+    header.count = entries.size();
+    header.poolSize = pool.size();
+
+    std::string temp = path + ".tmp";
+    std::FILE* out = std::fopen(temp.c_str(), "wb");
+    if (!out) return;
+    bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+        (entries.empty() || std::fwrite(entries.data(), sizeof(Entry), entries.size(), out) == entries.size()) &&
+        (pool.empty() || std::fwrite(pool.data(), 1, pool.size(), out) == pool.size());
+    written = std::fclose(out) == 0 && written;
+#if defined(_WIN32)
+    if (!written || !MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) std::remove(temp.c_str());
+#else
+    if (!written || std::rename(temp.c_str(), path.c_str()) != 0) std::remove(temp.c_str());
+#endif
+}
+
+// Arghand::Spec
+
+ARGHAND_DECL uint64_t Arghand::Spec::NextSerial() {
+    static std::atomic<uint64_t> counter(0);
+    return ++counter;
+}
+
+ARGHAND_DECL Arghand::Spec::Spec(const std::vector<CmdOption>& options, ParserOptions parser_options, char separator,
+                                 const std::vector<std::string>& commands, const Config* config)
+    : parserOptions(parser_options), ListSeparator(separator), positionalTail(-1), serial(NextSerial()) {
+    table.Build(options);
+    BuildOptionIndex();
+    BuildPositionalSlots();
+    BuildTypeRules();
+    ResolveSources(config);
+    BuildDefaultViews();
+    commandIndex.Reset((QSTU64(parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0);
+    for (size_t i = 0; i < commands.size(); ++i) {
+        commandIndex.Insert("", commands[i], static_cast<int32_t>(i));
+    }
+    commandNames = commands;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::parse(int argc, char* argv[], Result& result) const {
+    MatchState state;
+    BeginParse(state, result);
+    try {
+        ParseResult res = ParseResult::Success;
+        for (int i = 1; i < argc && res == ParseResult::Success; ++i) {
+            state.index = static_cast<size_t>(i);
+            res = FeedArgument(argv[i], state, result, 0);
+            if (state.command >= 0) {
+                result.command = state.command;
+                result.commandArg = static_cast<size_t>(i);
+                break;
+            }
+            if (res == ParseResult::Success && TakesRest(state)) {
+                TakeRest(argv + i + 1, argv + argc, state, result);
+                break;
+            }
+        }
+        return EndParse(res, state, result);
+    } catch (const std::bad_alloc&) {
+        if (!result.memory) throw;
+        return MemoryExhausted(state, result);
+    }
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::parse(const ArgView& command, Result& result) const {
+    MatchState state;
+    BeginParse(state, result);
+
+    try {
+        ArgTokenizer tokenizer(command.data, command.size, *result.arena, state.windowsQuoting);
+        ParseResult res = ParseResult::Success;
+        ArgView token;
+        for (size_t i = 0; res == ParseResult::Success && tokenizer.Next(token); ++i) {
+            state.index = i;
+            res = FeedArgument(token, state, result, 0);
+            if (state.command >= 0) {
+                result.command = state.command;
+                result.commandRest = tokenizer.Rest();
+                break;
+            }
+            if (res == ParseResult::Success && TakesRest(state)) {
+                while (tokenizer.Next(token)) {
+                    result.positionalViews.push_back(token);
+                    ++state.positionals;
+                }
+                break;
+            }
+        }
+        return EndParse(res, state, result);
+    } catch (const std::bad_alloc&) {
+        if (!result.memory) throw;
+        return MemoryExhausted(state, result);
+    }
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::parse(const ArgViewList& args, Result& result) const {
+    MatchState state;
+    BeginParse(state, result);
+    try {
+        ParseResult res = ParseResult::Success;
+        for (size_t i = 0; i < args.size() && res == ParseResult::Success; ++i) {
+            state.index = i;
+            res = FeedArgument(args[i], state, result, 0);
+            if (state.command >= 0) {
+                result.command = state.command;
+                result.commandArg = i;
+                break;
+            }
+            if (res == ParseResult::Success && TakesRest(state)) {
+                TakeRest(args.begin() + i + 1, args.end(), state, result);
+                break;
+            }
+        }
+        return EndParse(res, state, result);
+    } catch (const std::bad_alloc&) {
+        if (!result.memory) throw;
+        return MemoryExhausted(state, result);
+    }
+}
+
+ARGHAND_DECL std::vector<Arghand::BatchResult> Arghand::Spec::ParseBatch(const ArgViewList* argvs, size_t count, unsigned threads, const BatchVisitor& visitor) const {
+    return RunBatch(count, threads, visitor, [this, argvs](size_t i, Result& result) { return parse(argvs[i], result); });
+}
+
+ARGHAND_DECL std::vector<Arghand::BatchResult> Arghand::Spec::ParseBatch(const ArgView* commands, size_t count, unsigned threads, const BatchVisitor& visitor) const {
+    return RunBatch(count, threads, visitor, [this, commands](size_t i, Result& result) { return parse(commands[i], result); });
+}
+
+ARGHAND_DECL void Arghand::Spec::BuildOptionIndex() {
+    bool use_unix_style = (QSTU64(parserOptions) & QSTU64(ParserOptions::StyleUnix)) != 0;
+    bool ignore_case = (QSTU64(parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0;
+
+    ArgView prefix_lng = use_unix_style ? "--" : "/";
+    ArgView prefix_sht = use_unix_style ? "-" : "/";
+
+    optionIndex.Reset(ignore_case);
+    nameIndex.Reset(false);
+    size_t names = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < table.size(); ++i) {
+        names += 2;
+        bytes += table.LongName(static_cast<int32_t>(i)).size + table.ShortName(static_cast<int32_t>(i)).size;
+    }
+    optionIndex.Reserve(names, bytes + table.size() * (prefix_lng.size + prefix_sht.size));
+    nameIndex.Reserve(names, bytes);
+    for (size_t i = 0; i < table.size(); ++i) {
+        int32_t id = static_cast<int32_t>(i);
+        // Positional slots are queried by name but never named on the command line
+        if (!IsPositional(id)) {
+            optionIndex.Insert(prefix_lng, table.LongName(id), id);
+            optionIndex.Insert(prefix_sht, table.ShortName(id), id);
+        }
+        nameIndex.Insert(ArgView(), table.ShortName(id), id);
+        nameIndex.Insert(ArgView(), table.LongName(id), id);
+    }
+
+    // The trie is only needed up front for abbreviations, otherwise suggestions build it on the first error
+    if ((QSTU64(parserOptions) & QSTU64(ParserOptions::AllowAbbreviations)) != 0) {
+        longNames.Build(LongNames(), ignore_case);
+    }
+}
+
+ARGHAND_DECL void Arghand::Spec::BuildPositionalSlots() {
+    positionalSlots.clear();
+    positionalTail = -1;
+    for (size_t i = 0; i < table.size(); ++i) {
+        int32_t id = static_cast<int32_t>(i);
+        if (!IsPositional(id)) continue;
+        if ((table.Flags(id) & QSTU64(CmdOptionFlags::IsList)) == 0) {
+            positionalSlots.push_back(id);
+        } else {
+            positionalTail = id; // Only one slot can take the rest, the last one declared
+        }
+    }
+}
+
+ARGHAND_DECL void Arghand::Spec::ResolveSources(const Config* config) {
+    fallbackValues.clear();
+    fallbackSources.clear();
+    fallbackValues.reserve(table.size());
+    fallbackSources.reserve(table.size());
+    for (size_t i = 0; i < table.size(); ++i) {
+        int32_t id = static_cast<int32_t>(i);
+        std::string value;
+        ArgView configured;
+        if (!table.Environment(id).empty() && ReadEnvironment(table.Environment(id).str(), value)) {
+            fallbackSources.push_back(ValueSource::Environment);
+        } else if (config && !table.ConfigKey(id).empty() && config->Find(table.ConfigKey(id), configured)) {
+            value = configured.str();
+            fallbackSources.push_back(ValueSource::ConfigFile);
+        } else {
+            value = table.DefaultValue(id).str();
+            fallbackSources.push_back(ValueSource::Default);
+        }
+        fallbackValues.push_back(value);
+    }
+}
+
+ARGHAND_DECL bool Arghand::Spec::ReadEnvironment(const std::string& name, std::string& value) {
+#if defined(_WIN32)
+    DWORD size = GetEnvironmentVariableA(name.c_str(), nullptr, 0);
+    if (size == 0) return false;
+    value.resize(size);
+    value.resize(GetEnvironmentVariableA(name.c_str(), &value[0], size));
+#else
+    const char* env = std::getenv(name.c_str());
+    if (!env) return false;
+    value = env;
+#endif
+    return true;
+}
+
+ARGHAND_DECL void Arghand::Spec::BuildDefaultViews() {
+    defaultViews.clear();
+    defaultRanges.clear();
+    defaultValues.clear();
+    typedDefaults.clear();
+    invalidFallbacks.clear();
+    for (size_t i = 0; i < table.size(); ++i) {
+        ParsedView range;
+        range.id = static_cast<int32_t>(i);
+        range.first = static_cast<uint32_t>(defaultViews.size());
+        range.raw = fallbackValues[i];
+        if (table.Flags(static_cast<int32_t>(i)) & QSTU64(CmdOptionFlags::IsList)) {
+            SplitViews(fallbackValues[i], ListSeparator, defaultViews);
+        } else {
+            defaultViews.push_back(fallbackValues[i]);
+        }
+        range.count = static_cast<uint32_t>(defaultViews.size() - range.first);
+
+        // Converted once here, a value that does not convert fails the parses that fall back to it
+        range.typed = static_cast<uint32_t>(typedDefaults.size());
+        if (typed && (table.Flags(range.id) & TypeFlags) &&
+            ConvertValues(range.id, fallbackValues[i], (table.Flags(range.id) & QSTU64(CmdOptionFlags::IsList)) != 0, true, typedDefaults, nullptr) != ConvertResult::Success) {
+            typedDefaults.resize(range.typed);
+            invalidFallbacks.push_back(range.id);
+        }
+        range.typedCount = static_cast<uint32_t>(typedDefaults.size() - range.typed);
+        defaultRanges.push_back(range);
+
+        std::vector<std::string> values;
+        for (uint32_t v = 0; v < range.count; ++v) {
+            values.push_back(defaultViews[range.first + v].str());
+        }
+        defaultValues.push_back(values);
+    }
+}
+
+ARGHAND_DECL void Arghand::Spec::BuildTypeRules() {
+    typed = false;
+    for (size_t i = 0; i < table.size() && !typed; ++i) {
+        typed = (table.Flags(static_cast<int32_t>(i)) & TypeFlags) != 0;
+    }
+    if (!typed) return;
+
+    rules.resize(table.size());
+    for (size_t i = 0; i < table.size(); ++i) {
+        int32_t id = static_cast<int32_t>(i);
+        TypeRule& rule = rules[i];
+        rule.minInteger = std::numeric_limits<int64_t>::min();
+        rule.maxInteger = std::numeric_limits<int64_t>::max();
+        rule.minReal = -std::numeric_limits<double>::infinity();
+        rule.maxReal = std::numeric_limits<double>::infinity();
+        rule.firstChoice = static_cast<uint32_t>(choices.size());
+        rule.choiceCount = 0;
+
+        ArgView allowed = table.Allowed(id);
+        if (allowed.empty()) continue;
+        if (table.Flags(id) & QSTU64(CmdOptionFlags::IsEnum)) {
+            SplitViews(allowed, '|', choices);
+            rule.choiceCount = static_cast<uint32_t>(choices.size() - rule.firstChoice);
+            continue;
+        }
+        const char* dots = allowed.begin();
+        while (dots + 1 < allowed.end() && !(dots[0] == '.' && dots[1] == '.')) ++dots;
+        if (dots + 1 >= allowed.end()) continue;
+        ArgView low(allowed.data, static_cast<size_t>(dots - allowed.data));
+        ArgView high(dots + 2, static_cast<size_t>(allowed.end() - dots - 2));
+        Convert(low, rule.minInteger);
+        Convert(high, rule.maxInteger);
+        Convert(low, rule.minReal);
+        Convert(high, rule.maxReal);
+    }
+}
+
+ARGHAND_DECL Arghand::ConvertResult Arghand::Spec::ConvertValue(int32_t id, const ArgView& text, TypedValue& out) const {
+    uint64_t flags = table.Flags(id);
+    const TypeRule& rule = rules[id];
+    ConvertResult res;
+    if (flags & QSTU64(CmdOptionFlags::IsInteger)) {
+        res = Convert(text, out.integer);
+        if (res != ConvertResult::Success) return res;
+        if (out.integer < rule.minInteger || out.integer > rule.maxInteger) res = ConvertResult::OutOfRange;
+        out.real = static_cast<double>(out.integer);
+    } else if (flags & QSTU64(CmdOptionFlags::IsDouble)) {
+        res = Convert(text, out.real);
+        if (res != ConvertResult::Success) return res;
+        if (out.real < rule.minReal || out.real > rule.maxReal) res = ConvertResult::OutOfRange;
+        out.integer = (out.real > -9.2e18 && out.real < 9.2e18) ? static_cast<int64_t>(out.real) : 0;
+    } else if (flags & QSTU64(CmdOptionFlags::IsBoolean)) {
+        bool value = false;
+        res = Convert(text, value);
+        out.integer = value ? 1 : 0;
+        out.real = value ? 1.0 : 0.0;
+    } else {
+        res = ConvertResult::Invalid;
+        bool fold = (QSTU64(parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0;
+        for (uint32_t c = 0; c < rule.choiceCount && res != ConvertResult::Success; ++c) {
+            if (SameName(choices[rule.firstChoice + c], text, fold)) {
+                out.integer = c;
+                out.real = c;
+                res = ConvertResult::Success;
+            }
+        }
+        if (text.empty()) res = ConvertResult::Empty;
+    }
+    return res;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::CheckFallbacks(MatchState& state, const Result& result) const {
+    for (int32_t id : invalidFallbacks) {
+        bool given = false;
+        for (const auto& parsed : result.parsedViews) {
+            if (parsed.id == id) { given = true; break; }
+        }
+        if (given) continue;
+        Discard scratch;
+        ArgView bad = fallbackValues[id];
+        ConvertResult res = ConvertValues(id, bad, (table.Flags(id) & QSTU64(CmdOptionFlags::IsList)) != 0, true, scratch, &bad);
+        ReportError(state, res == ConvertResult::OutOfRange ? DiagnosticCode::ValueOutOfRange : DiagnosticCode::InvalidValue, bad, 0, id);
+        return ParseResult::Error;
+    }
+    return ParseResult::Success;
+}
+
+ARGHAND_DECL void Arghand::Spec::InitMatchState(MatchState& state, TokenArena* arena, std::vector<std::shared_ptr<MappedFile>>* files) const {
+    bool use_unix_style = (QSTU64(parserOptions) & QSTU64(ParserOptions::StyleUnix)) != 0;
+    state.prefix_lng = use_unix_style ? "--" : "/";
+    state.prefix_sht = use_unix_style ? "-" : "/";
+    state.pending = -1;
+    state.pendingArg = ArgView();
+    state.index = 0;
+    state.pendingIndex = 0;
+    state.arena = arena;
+    state.windowsQuoting = (QSTU64(parserOptions) & QSTU64(ParserOptions::StyleWindows)) != 0;
+    state.files = files;
+    state.stats = nullptr;
+    state.trace = nullptr;
+    state.diagnostics = nullptr;
+    state.dispatch = false;
+    state.command = -1;
+    state.endOfOptions = false;
+    state.positionals = 0;
+}
+
+// Arghand::Spec::BatchQueue
+
+ARGHAND_DECL bool Arghand::Spec::BatchQueue::Take(unsigned self, size_t& first, size_t& last) {
+    for (unsigned k = 0; k < size; ++k) {
+        Range& range = ranges[(self + k) % size];
+        if (range.next.load(std::memory_order_relaxed) >= range.end) continue;
+        size_t begin = range.next.fetch_add(ChunkSize, std::memory_order_relaxed);
+        if (begin < range.end) {
+            first = begin;
+            last = std::min(begin + ChunkSize, range.end);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Arghand::Spec
+
+template<typename ParseItem>
+ARGHAND_DECL std::vector<Arghand::BatchResult> Arghand::Spec::RunBatch(size_t count, unsigned threads, const BatchVisitor& visitor, const ParseItem& parseItem) const {
+    std::vector<BatchResult> items(count);
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, count / 256 + 1))); // Small batches are not worth a thread each
+
+    BatchQueue queue(count, threads);
+    std::exception_ptr failure;
+    std::atomic<bool> failed(false);
+    auto work = [&](unsigned self) {
+        try {
+            Result result;
+            result.viewsOnly = !visitor;
+            result.CollectDiagnostics(1);
+            size_t first, last;
+            while (!failed.load(std::memory_order_relaxed) && queue.Take(self, first, last)) {
+                for (size_t i = first; i < last; ++i) {
+                    BatchResult& item = items[i];
+                    item.result = parseItem(i, result);
+                    item.options = static_cast<uint32_t>(result.parsedViews.size());
+                    item.positionals = static_cast<uint32_t>(result.positionalViews.size());
+                    if (!result.diagnostics.records.empty()) {
+                        item.diagnostic = result.diagnostics.records[0];
+                        // Rewritten tokens live in the worker's result, which the next item reuses
+                        if (result.Owns(item.diagnostic.token.data)) item.diagnostic.token = ArgView();
+                    }
+                    if (visitor) visitor(i, result);
+                }
+            }
+        } catch (...) {
+            // Keep the first exception, rethrown to the caller once all workers stopped
+            if (!failed.exchange(true)) failure = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (failure) std::rethrow_exception(failure);
+    return items;
+}
+
+ARGHAND_DECL void Arghand::Spec::BeginParse(MatchState& state, Result& result) const {
+    result.Reset(*this);
+    InitMatchState(state, result.arena.get(), &result.files);
+    if (result.statsEnabled) {
+        result.BeginStats();
+        state.stats = &result.stats;
+    }
+    if (result.trace) {
+        state.trace = &result.trace;
+    }
+    result.diagnostics.Clear();
+    if (result.diagnostics.Active()) {
+        state.diagnostics = &result.diagnostics;
+    }
+    state.dispatch = !commandIndex.empty();
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::EndParse(ParseResult res, MatchState& state, Result& result) const {
+    if (res == ParseResult::Success) {
+        res = FinishArguments(state, result);
+    }
+    if (res == ParseResult::Success && !invalidFallbacks.empty()) {
+        res = CheckFallbacks(state, result);
+    }
+    if (state.stats) {
+        // Everything up to here that was not matching is ingestion
+        uint64_t feedNs = ElapsedNs(result.started);
+        state.stats->ingestNs = feedNs > state.stats->matchNs ? feedNs - state.stats->matchNs : 0;
+    }
+    result.Resolve();
+    return res;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::FeedArgument(const ArgView& arg, MatchState& state, MatchSink& sink, int depth) const {
+    if (arg.size > 1 && arg[0] == '@' && !state.endOfOptions && (QSTU64(parserOptions) & QSTU64(ParserOptions::ResponseFiles)) != 0) {
+        if (depth >= MaxResponseFileDepth) {
+            ReportError(state, DiagnosticCode::ResponseFileDepth, arg, state.index, -1);
+            return ParseResult::Error;
+        }
+
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+        if (file->Open(std::string(arg.data + 1, arg.size - 1))) {
+            state.dispatch = false; // Subcommands are only recognized on the command line itself
+            ArgTokenizer tokenizer(file->Data(), file->Size(), *state.arena, state.windowsQuoting);
+            if (state.files) {
+                state.files->push_back(std::move(file)); // Keeps the mapping alive for the views into it
+            }
+
+            ArgView token;
+            while (tokenizer.Next(token)) {
+                ParseResult result = FeedArgument(token, state, sink, depth + 1);
+                if (result != ParseResult::Success) return result;
+            }
+            return ParseResult::Success;
+        }
+        // A file that cannot be opened is kept as a literal argument
+    }
+    // Keep instrumentation off the plain path, it costs this one test when disabled
+    if (state.stats || state.trace) {
+        return MatchTokenTraced(arg, state, sink);
+    }
+    return MatchToken(arg, state, sink);
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::MatchTokenTraced(const ArgView& arg, MatchState& state, MatchSink& sink) const {
+    int32_t pending = state.pending;
+    bool ended = state.endOfOptions;
+    std::chrono::steady_clock::time_point start;
+    if (state.stats) start = std::chrono::steady_clock::now();
+
+    ParseResult res = MatchToken(arg, state, sink);
+
+    if (state.stats) {
+        state.stats->matchNs += ElapsedNs(start);
+        ++state.stats->tokens;
+    }
+    if (state.trace) {
+        bool looks_like_option = !ended && (arg.StartsWith(state.prefix_lng) || arg.StartsWith(state.prefix_sht));
+        if (!ended && state.endOfOptions) {
+            (*state.trace)(arg, TokenKind::EndOfOptions, -1);
+        } else if (pending >= 0 && !looks_like_option) {
+            (*state.trace)(arg, TokenKind::Value, pending);
+        } else if (!looks_like_option) {
+            (*state.trace)(arg, TokenKind::Positional, -1);
+        } else {
+            int32_t id = FindOption(arg, state);
+            (*state.trace)(arg, id >= 0 ? TokenKind::Option : TokenKind::Unknown, id >= 0 ? id : -1);
+        }
+    }
+    return res;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::MatchToken(const ArgView& arg, MatchState& state, MatchSink& sink) const {
+    // Past "--" nothing is matched, the argument is positional whatever it looks like
+    if (state.endOfOptions) {
+        return MatchPositional(arg, state, sink);
+    }
+    bool looks_like_option = arg.StartsWith(state.prefix_lng) || arg.StartsWith(state.prefix_sht);
+
+    if (state.pending >= 0) {
+        if (!looks_like_option) {
+            return CompleteValue(state, sink, &arg);
+        }
+        ParseResult result = CompleteValue(state, sink, nullptr);
+        if (result != ParseResult::Success) return result;
+    }
+
+    if (arg.size == 2 && arg[0] == '-' && arg[1] == '-' && (QSTU64(parserOptions) & QSTU64(ParserOptions::EndOfOptions)) != 0) {
+        state.endOfOptions = true;
+        state.dispatch = false; // A subcommand name after "--" is a plain argument
+        return ParseResult::Success;
+    }
+
+    // Every indexed name starts with a prefix, so only those tokens need a lookup
+    int32_t id = looks_like_option ? FindOption(arg, state) : -1;
+    if (id == NameTrie::Ambiguous) {
+        ReportError(state, DiagnosticCode::AmbiguousOption, arg, state.index, -1);
+        return ParseResult::Error;
+    }
+    if (id >= 0) {
+        uint64_t flags = table.Flags(id);
+
+        // Handle special options, printing is up to the caller
+        if (flags & QSTU64(CmdOptionFlags::IsHelpOption)) {
+            return ParseResult::SuccessWithHelp;
+        }
+
+        if (flags & QSTU64(CmdOptionFlags::IsVersionOption)) {
+            return ParseResult::SuccessWithVersion;
+        }
+
+        // Required value or list, taken from the next token
+        if (flags & (QSTU64(CmdOptionFlags::IsValueRequired) | QSTU64(CmdOptionFlags::IsList))) {
+            state.pending = id;
+            state.pendingArg = arg;
+            state.pendingIndex = state.index;
+            return ParseResult::Success;
+        }
+
+        // No value needed
+        ArgView value = table.DefaultValue(id);
+        if (flags & QSTU64(CmdOptionFlags::IsRequired) && value.empty()) {
+            ReportError(state, DiagnosticCode::MissingValue, arg, state.index, id);
+            return ParseResult::MissingValue;
+        }
+        if (!sink.OnOption(id, value, false)) { // Empty string if there is no default
+            return RejectValue(state, id, value, false, state.index);
+        }
+    }
+    // If unmatched and looks like an option
+    else if (looks_like_option) {
+        ReportError(state, DiagnosticCode::UnknownOption, arg, state.index, -1);
+        return ParseResult::Error;
+    }
+    else {
+        if (state.dispatch) {
+            // Only the first positional argument can name a subcommand
+            state.dispatch = false;
+            state.command = commandIndex.Find(arg.data, arg.size);
+            if (state.command >= 0) return ParseResult::Success;
+        }
+        return MatchPositional(arg, state, sink);
+    }
+    return ParseResult::Success;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::MatchPositional(const ArgView& arg, MatchState& state, MatchSink& sink) const {
+    int32_t tail = -1;
+    if (state.positionals < positionalSlots.size()) {
+        int32_t id = positionalSlots[state.positionals];
+        if (!sink.OnOption(id, arg, false)) {
+            return RejectValue(state, id, arg, false, state.index);
+        }
+    } else if (positionalTail < 0 && !positionalSlots.empty()) {
+        ReportError(state, DiagnosticCode::UnexpectedPositional, arg, state.index, -1);
+        return ParseResult::Error;
+    } else {
+        tail = positionalTail;
+    }
+    if (!sink.OnPositional(arg, tail)) {
+        return RejectValue(state, tail, arg, false, state.index);
+    }
+    ++state.positionals;
+    return ParseResult::Success;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::CheckPositionals(MatchState& state) const {
+    if (state.command >= 0) return ParseResult::Success; // The rest belongs to the subcommand
+    for (size_t k = state.positionals; k <= positionalSlots.size(); ++k) {
+        int32_t id = k < positionalSlots.size() ? positionalSlots[k] : positionalTail;
+        if (id < 0) break;
+        if ((table.Flags(id) & QSTU64(CmdOptionFlags::IsRequired)) && fallbackValues[id].empty()) {
+            ReportError(state, DiagnosticCode::MissingPositional, table.LongName(id), state.index, id);
+            return ParseResult::MissingValue;
+        }
+    }
+    return ParseResult::Success;
+}
+
+ARGHAND_DECL void Arghand::Spec::ReportError(MatchState& state, DiagnosticCode code, const ArgView& arg, size_t index, OptionId option) const {
+    Diagnostic diagnostic;
+    diagnostic.code = code;
+    diagnostic.index = index;
+    diagnostic.token = arg;
+    diagnostic.option = option;
+    if (state.diagnostics) {
+        state.diagnostics->Add(diagnostic);
+    } else {
+        Output::ToFile(stderr).Write(FormatDiagnostic(diagnostic, state) + "\n");
+    }
+}
+
+ARGHAND_DECL std::string Arghand::Spec::FormatDiagnostic(const Diagnostic& diagnostic, const MatchState& state) const {
+    std::string hint;
+    std::string text;
+    switch (diagnostic.code) {
+    case DiagnosticCode::UnknownOption:
+        text = "Unknown option: ";
+        hint = SuggestionHint(diagnostic.token, state);
+        break;
+    case DiagnosticCode::AmbiguousOption:
+        text = "Ambiguous option: ";
+        hint = AmbiguityHint(diagnostic.token, state);
+        break;
+    case DiagnosticCode::MissingValue: text = "Missing value for required option: "; break;
+    case DiagnosticCode::MissingListValue: text = "Missing list value for option: "; break;
+    case DiagnosticCode::ResponseFileDepth: text = "Response files nested too deeply: "; break;
+    case DiagnosticCode::VersionNotSet: return "Version information is not set.";
+    case DiagnosticCode::MemoryExhausted: return "Parse memory exhausted.";
+    case DiagnosticCode::MissingPositional: text = "Missing positional argument: "; break;
+    case DiagnosticCode::UnexpectedPositional: text = "Unexpected positional argument: "; break;
+    case DiagnosticCode::InvalidValue:
+    case DiagnosticCode::ValueOutOfRange:
+        text = diagnostic.code == DiagnosticCode::InvalidValue ? "Invalid value for option " : "Value out of range for option ";
+        if (diagnostic.option >= 0 && static_cast<size_t>(diagnostic.option) < table.size()) {
+            bool use_long = !table.LongName(diagnostic.option).empty();
+            ArgView prefix = use_long ? state.prefix_lng : state.prefix_sht;
+            ArgView name = use_long ? table.LongName(diagnostic.option) : table.ShortName(diagnostic.option);
+            text.append(prefix.data, prefix.size).append(name.data, name.size);
+            ArgView allowed = table.Allowed(diagnostic.option);
+            if (!allowed.empty() && ((table.Flags(diagnostic.option) & QSTU64(CmdOptionFlags::IsEnum)) != 0) == (diagnostic.code == DiagnosticCode::InvalidValue)) {
+                hint.append(" (expected ").append(allowed.data, allowed.size).append(")");
+            }
+        }
+        text += ": ";
+        break;
+    }
+    return text.append(diagnostic.token.data, diagnostic.token.size).append(hint);
+}
+
+ARGHAND_DECL std::string Arghand::Spec::SuggestionHint(const ArgView& arg, const MatchState& state) const {
+    if (arg.size <= state.prefix_lng.size || !arg.StartsWith(state.prefix_lng)) return std::string();
+    const NameTrie* trie = &longNames;
+    if ((QSTU64(parserOptions) & QSTU64(ParserOptions::AllowAbbreviations)) == 0) {
+        // Built on the first error, once even if several threads fail at the same time
+        std::call_once(suggestOnce, [this]() {
+            suggestNames.Build(LongNames(), (QSTU64(parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0);
+        });
+        trie = &suggestNames;
+    }
+    std::vector<int32_t> ids;
+    size_t length = arg.size - state.prefix_lng.size;
+    trie->Suggest(arg.data + state.prefix_lng.size, length, length < 4 ? 1 : 2, 3, ids);
+    return ids.empty() ? std::string() : JoinNames(", did you mean ", ids, state, "?");
+}
+
+ARGHAND_DECL const Arghand::NameTrie& Arghand::Spec::CompletionNames() const {
+    std::call_once(completionOnce, [this]() {
+        MatchState state;
+        InitMatchState(state, nullptr, nullptr);
+        size_t bytes = 0;
+        for (size_t i = 0; i < table.size(); ++i) {
+            int32_t id = static_cast<int32_t>(i);
+            bytes += state.prefix_lng.size + table.LongName(id).size + state.prefix_sht.size + table.ShortName(id).size;
+        }
+        // Reserved up front, the views below point into it
+        std::string text;
+        text.reserve(bytes);
+        std::vector<std::pair<ArgView, int32_t>> names;
+        names.reserve(table.size() * 2);
+        for (size_t i = 0; i < table.size(); ++i) {
+            int32_t id = static_cast<int32_t>(i);
+            if (IsPositional(id)) continue;
+            for (int is_long = 0; is_long < 2; ++is_long) {
+                ArgView name = is_long ? table.LongName(id) : table.ShortName(id);
+                if (name.empty()) continue;
+                ArgView prefix = is_long ? state.prefix_lng : state.prefix_sht;
+                size_t offset = text.size();
+                text.append(prefix.data, prefix.size).append(name.data, name.size);
+                names.push_back(std::make_pair(ArgView(text.data() + offset, text.size() - offset), id * 2 + is_long));
+            }
+        }
+        completionNames.Build(names, (QSTU64(parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0);
+    });
+    return completionNames;
+}
+
+ARGHAND_DECL std::string Arghand::Spec::JoinNames(const char* open, const std::vector<int32_t>& ids, const MatchState& state, const char* close) const {
+    std::string text = open;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (i > 0) text += i + 1 == ids.size() ? " or " : ", ";
+        text.append(state.prefix_lng.data, state.prefix_lng.size);
+        ArgView name = table.LongName(ids[i]);
+        text.append(name.data, name.size);
+    }
+    return text + close;
+}
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Spec::CompleteValue(MatchState& state, MatchSink& sink, const ArgView* value) const {
+    bool is_list = (table.Flags(state.pending) & QSTU64(CmdOptionFlags::IsValueRequired)) == 0;
+    ArgView fallback = table.DefaultValue(state.pending);
+
+    ArgView resolved;
+    if (value) {
+        resolved = *value;
+    }
+    else if (!fallback.empty()) {
+        resolved = fallback;
+    }
+    else {
+        ReportError(state, is_list ? DiagnosticCode::MissingListValue : DiagnosticCode::MissingValue, state.pendingArg, state.pendingIndex, state.pending);
+        return ParseResult::MissingValue;
+    }
+
+    int32_t id = state.pending;
+    state.pending = -1;
+    if (!sink.OnOption(id, resolved, is_list)) {
+        return RejectValue(state, id, resolved, is_list, value ? state.index : state.pendingIndex);
+    }
+    return ParseResult::Success;
+}
+
+// Arghand::Result
+
+ARGHAND_DECL bool Arghand::Result::Owns(const char* p) const {
+    if (!p) return false;
+    if (arena && arena->Owns(p)) return true;
+    for (const auto& file : files) {
+        if (p >= file->Data() && p < file->Data() + file->Size()) return true;
+    }
+    return false;
+}
+
+ARGHAND_DECL Arghand::Result& Arghand::Result::operator=(const Result& other) {
+    if (this == &other) return *this;
+    spec = other.spec;
+    zeroCopy = other.zeroCopy;
+    lazyLists = other.lazyLists;
+    parsedValues = other.parsedValues;
+    parsedViews = other.parsedViews;
+    valueViews = other.valueViews;
+    typedValues = other.typedValues;
+    positionalViews = other.positionalViews;
+    tailTyped = other.tailTyped;
+    tailValues.clear();
+    tailCopied = false;
+    files = other.files;
+    arena = other.arena;
+    linkedSerial = 0; // The table is rebuilt for the copied buffers
+    command = other.command;
+    commandArg = other.commandArg;
+    commandRest = other.commandRest;
+    statsEnabled = other.statsEnabled;
+    stats = other.stats;
+    trace = other.trace;
+    diagnostics = other.diagnostics;
+    Link();
+    return *this;
+}
+
+ARGHAND_DECL void Arghand::Result::SetMemory(MemoryResource* resource) {
+    memory = resource;
+    Restart(parsedViews);
+    Restart(valueViews);
+    Restart(typedValues);
+    Restart(positionalViews);
+    Restart(tailTyped);
+    if (spec) {
+        Reset(*spec);
+        Resolve();
+    }
+}
+
+ARGHAND_DECL void Arghand::Result::Reset(const Spec& owner) {
+    spec = &owner;
+    zeroCopy = viewsOnly || memory || (QSTU64(owner.parserOptions) & QSTU64(ParserOptions::ZeroCopy)) != 0;
+    lazyLists = (QSTU64(owner.parserOptions) & QSTU64(ParserOptions::LazyLists)) != 0;
+    parsedValues.clear();
+    files.clear();
+    if (memory) {
+        // The buffers start over in the released memory
+        Restart(parsedViews);
+        Restart(valueViews);
+        Restart(typedValues);
+        Restart(positionalViews);
+        Restart(tailTyped);
+        memory->Release();
+    } else {
+        parsedViews.clear();
+        valueViews.clear();
+        typedValues.clear();
+        positionalViews.clear();
+        tailTyped.clear();
+    }
+    tailValues.clear();
+    tailCopied = false;
+    command = -1;
+    commandArg = 0;
+    commandRest = ArgView();
+    // Tokens may still be referenced by a copy of this result, start a new arena then
+    if (!arena || arena.use_count() > 1) {
+        arena = std::make_shared<TokenArena>();
+    } else {
+        arena->Clear();
+    }
+    arena->memory = memory;
+}
+
+ARGHAND_DECL void Arghand::Result::Resolve() {
+    std::chrono::steady_clock::time_point start;
+    if (statsEnabled) start = std::chrono::steady_clock::now();
+
+    if (!zeroCopy) {
+        // Options are referred to by ID, only the values are copied
+        parsedValues.reserve(parsedViews.size());
+        for (const auto& view : parsedViews) {
+            parsedValues.push_back(std::vector<std::string>());
+            std::vector<std::string>& values = parsedValues.back();
+            values.reserve(view.count);
+            for (uint32_t v = 0; v < view.count; ++v) {
+                values.push_back(valueViews[view.first + v].str());
+            }
+        }
+    }
+    if (statsEnabled) {
+        stats.extractNs = ElapsedNs(start);
+        start = std::chrono::steady_clock::now();
+    }
+
+    Link();
+
+    if (statsEnabled) {
+        stats.resolveNs = ElapsedNs(start);
+        EndStats();
+    }
+}
+
+ARGHAND_DECL void Arghand::Result::BeginStats() {
+    stats = ParseStats();
+    started = std::chrono::steady_clock::now();
+    marks[0] = parsedValues.capacity();
+    marks[1] = parsedViews.capacity();
+    marks[2] = valueViews.capacity();
+    marks[3] = positionalViews.capacity();
+    marks[4] = results.capacity();
+    marks[5] = files.capacity();
+    marks[6] = arena->allocations;
+    marks[7] = arena->allocatedBytes;
+}
+
+ARGHAND_DECL void Arghand::Result::EndStats() {
+    stats.options = parsedViews.size();
+    stats.positionals = positionalViews.size();
+    CountGrowth(parsedValues, marks[0]);
+    CountGrowth(parsedViews, marks[1]);
+    CountGrowth(valueViews, marks[2]);
+    CountGrowth(positionalViews, marks[3]);
+    CountGrowth(results, marks[4]);
+    CountGrowth(files, marks[5]);
+    stats.allocations += arena->allocations - marks[6];
+    stats.bytes += arena->allocatedBytes - marks[7];
+    stats.allocations += files.size(); // Each mapped file is one shared object
+
+    // Owning copies, only strings beyond the small string buffer allocate
+    const size_t inlineCapacity = std::string().capacity();
+    for (const auto& values : parsedValues) {
+        if (values.capacity()) {
+            ++stats.allocations;
+            stats.bytes += values.capacity() * sizeof(std::string);
+        }
+        for (const auto& value : values) {
+            if (value.capacity() > inlineCapacity) { ++stats.allocations; stats.bytes += value.capacity() + 1; }
+        }
+    }
+    for (const auto& value : tailValues) {
+        if (value.capacity() > inlineCapacity) { ++stats.allocations; stats.bytes += value.capacity() + 1; }
+    }
+}
+
+ARGHAND_DECL void Arghand::Result::Link() {
+    if (!spec) {
+        results.clear();
+        linkedSerial = 0;
+        return;
+    }
+
+    if (linkedSerial != spec->serial || results.size() != spec->table.size()) {
+        results.resize(spec->table.size());
+        linkedIds.reserve(results.size());
+        for (size_t id = 0; id < results.size(); ++id) {
+            LinkDefault(id);
+        }
+        linkedSerial = spec->serial;
+    } else {
+        for (int32_t id : linkedIds) {
+            LinkDefault(id);
+        }
+    }
+    linkedIds.clear();
+
+    for (size_t i = 0; i < parsedViews.size(); ++i) {
+        const ParsedView& parsed = parsedViews[i];
+        OptionResult& result = results[parsed.id];
+        if (result.present) continue; // First occurrence wins
+        linkedIds.push_back(parsed.id);
+        result.present = true;
+        result.views = ArgViewList(valueViews.data() + parsed.first, parsed.count);
+        result.list.value = parsed.raw;
+        LinkTyped(result, typedValues.data() + parsed.typed, parsed.typedCount);
+        result.values = zeroCopy ? nullptr : &parsedValues[i];
+        result.value = zeroCopy ? nullptr : &parsedValues[i][0];
+    }
+
+    // The tail is a view over the positional arguments after the other slots, one value each.
+    // Its owning values are only copied when asked for, see TailValues.
+    int32_t tail = spec->positionalTail;
+    size_t first = spec->positionalSlots.size();
+    if (tail >= 0 && positionalViews.size() > first) {
+        OptionResult& result = results[tail];
+        linkedIds.push_back(tail);
+        result.present = true;
+        result.views = ArgViewList(positionalViews.data() + first, positionalViews.size() - first);
+        result.list = ArgSplitView(result.views, spec->ListSeparator, false);
+        LinkTyped(result, tailTyped.data(), static_cast<uint32_t>(tailTyped.size()));
+        result.values = zeroCopy ? nullptr : &tailValues;
+        result.value = nullptr;
+    }
+}
+
+// Arghand
+
+ARGHAND_DECL void Arghand::WarnVersionNotSet() const {
+    Diagnostic diagnostic;
+    diagnostic.code = DiagnosticCode::VersionNotSet;
+    diagnostic.index = 0;
+    diagnostic.option = -1;
+    if (result.diagnostics.Active()) {
+        result.diagnostics.Add(diagnostic);
+    } else {
+        Output::ToFile(stderr).Write(spec->FormatDiagnostic(diagnostic) + "\n");
+    }
+}
+
+ARGHAND_DECL void Arghand::RebuildSpec(const std::vector<CmdOption>& options) {
+    std::vector<std::string> commands;
+    commands.reserve(subcommands.size());
+    for (const auto& command : subcommands) {
+        commands.push_back(command.name);
+    }
+    commandsChanged = false;
+    spec = std::make_shared<const Spec>(options, parserOptions, ListSeparator, commands, config.get());
+    result.Reset(*spec);
+    result.Resolve();
+    InvalidateText();
+}
+
+ARGHAND_DECL Arghand& Arghand::Dispatch(int32_t id) {
+    Subcommand& command = subcommands[id];
+    if (!command.handler) {
+        command.handler = std::make_shared<Arghand>();
+        Arghand& child = *command.handler;
+        child.applicationName = applicationName + " " + command.name;
+        child.version = version;
+        child.versionFooter = versionFooter;
+        child.license = license;
+        child.output = output;
+        child.parserOptions = parserOptions;
+        child.ListSeparator = ListSeparator;
+        child.config = config;
+        child.RebuildSpec(std::vector<CmdOption>());
+        command.factory(child);
+    }
+    command.handler->result.diagnostics.Configure(result.diagnostics);
+    activeCommand = id;
+    return *command.handler;
+}
+
+ARGHAND_DECL std::string Arghand::RenderVersion(bool withLicense) const {
+    std::string text;
+    if (!version.empty()) {
+        // if no application name is set
+        text += applicationName.empty() ? "Version " : applicationName + " version ";
+        text += version + "\n";
+    }
+    if (withLicense && ParserOptionsExist(ParserOptions::VersionDisplayFooter)) {
+        text += versionFooter + "\n";
+    }
+    if (withLicense) {
+        text += license + "\n";
+    }
+    return text;
+}
+
+ARGHAND_DECL std::string Arghand::RenderHelp() const {
+    const std::vector<CmdOption>& cmdOptions = spec->GetCmdOptions();
+    bool use_unix_style = (QSTU64(parserOptions) & QSTU64(ParserOptions::StyleUnix)) != 0;
+    std::string prefix_lng = use_unix_style ? "--" : "/";
+    std::string prefix_sht = use_unix_style ? "-" : "/";
+
+    std::string text;
+    if(ParserOptionsExist(ParserOptions::HelpDisplayHeader)) {
+        text += helpHeader + "\n";
+    }
+    if(ParserOptionsExist(ParserOptions::HelpDisplayAppName)) {
+        text += applicationName + "\n";
+    }
+    if(ParserOptionsExist(ParserOptions::HelpDisplayVersion)) {
+        text += RenderVersion(false);
+    }
+
+    if(ParserOptionsExist(ParserOptions::HelpAutoGenerateArgumentUsageText)) {
+        text += "Usage: \n\t" + applicationName + " ";
+        for(const auto& option : cmdOptions) {
+            if(option.options & QSTU64(CmdOptionFlags::IsPositional)) continue;
+            bool exists_long_name = !option.long_name.empty();
+            bool exists_short_name = !option.short_name.empty();
+            bool takes_value = (option.options & QSTU64(CmdOptionFlags::IsValueRequired)) || (option.options & QSTU64(CmdOptionFlags::IsList));
+            char br_o = (option.options & QSTU64(CmdOptionFlags::IsRequired)) ? '{' : '[';
+            char br_c = (option.options & QSTU64(CmdOptionFlags::IsRequired)) ? '}' : ']';
+            if(takes_value) text += br_o;
+            text += br_o;
+            if(exists_short_name) text += prefix_sht + option.short_name;
+            if(exists_short_name && exists_long_name) text += " | ";
+            if(exists_long_name) text += prefix_lng + option.long_name;
+            text += br_c;
+            if(option.options & QSTU64(CmdOptionFlags::IsValueRequired)) {
+                text += " <value>";
+            } else if(option.options & QSTU64(CmdOptionFlags::IsList)) {
+                text += std::string(" <value1") + ListSeparator + "value2>";
+            }
+            if(takes_value) text += br_c;
+            text += " ";
+        }
+        // Positional slots follow the options, in the order they bind
+        for(const auto& option : cmdOptions) {
+            if(!(option.options & QSTU64(CmdOptionFlags::IsPositional))) continue;
+            bool required = (option.options & QSTU64(CmdOptionFlags::IsRequired)) && option.DefaultValue.empty();
+            bool tail = (option.options & QSTU64(CmdOptionFlags::IsList)) != 0;
+            text += required ? "<" + option.long_name + ">" : "[<" + option.long_name + ">]";
+            if(tail) text += "...";
+            text += " ";
+        }
+        if(!subcommands.empty()) text += "<command> [<args>]";
+        text += "\n\n";
+    }
+
+    std::vector<std::string> names;
+    names.reserve(cmdOptions.size());
+    size_t column = 0;
+    for (const auto& option : cmdOptions) {
+        if (option.options & QSTU64(CmdOptionFlags::IsPositional)) {
+            names.push_back("    <" + option.long_name + (option.options & QSTU64(CmdOptionFlags::IsList) ? ">..." : ">"));
+            column = std::max(column, names.back().size());
+            continue;
+        }
+        bool exists_long_name = !option.long_name.empty();
+        bool exists_short_name = !option.short_name.empty();
+        std::string name = exists_short_name ? prefix_sht + option.short_name : "    ";
+        if(exists_short_name && exists_long_name) name += ", ";
+        if(exists_long_name) name += prefix_lng + option.long_name;
+        column = std::max(column, name.size());
+        names.push_back(name);
+    }
+    for (const auto& command : subcommands) {
+        column = std::max(column, command.name.size());
+    }
+    column += 4;
+    for (size_t i = 0; i < cmdOptions.size(); ++i) {
+        text += names[i];
+        text.append(column - names[i].size(), ' ');
+        text += cmdOptions[i].description;
+        if(!cmdOptions[i].DefaultValue.empty()) text += " | Default value: " + cmdOptions[i].DefaultValue;
+        text += "\n";
+    }
+    if(!subcommands.empty()) {
+        text += "\nCommands:\n";
+        for (const auto& command : subcommands) {
+            text += command.name;
+            text.append(column - command.name.size(), ' ');
+            text += command.description + "\n";
+        }
+    }
+
+    if(ParserOptionsExist(ParserOptions::HelpDisplayFooter)) {
+        text += helpFooter + "\n";
+    }
+    if(ParserOptionsExist(ParserOptions::HelpDisplayLicense)) {
+        text += license + "\n";
+    }
+    return text;
+}
+
+// Arghand::Stream
+
+ARGHAND_DECL Arghand::ParseResult Arghand::Stream::Feed(const ArgView& token) {
+    if (status != ParseResult::Success) return status;
+    arena.Clear();
+    status = spec.FeedArgument(token, state, *this, 0);
+    ++state.index;
+    Report();
+
+    // The pending option's token may not outlive this call, keep a copy for error messages
+    if (state.pending >= 0 && state.pendingArg.data != pendingArg.data()) {
+        pendingArg.assign(state.pendingArg.data, state.pendingArg.size);
+        state.pendingArg = pendingArg;
+    }
+    return status;
+}
+
+// Arghand::Session
+
+ARGHAND_DECL void Arghand::Session::Edit(size_t offset, size_t erase, const ArgView& insert) {
+    offset = std::min(offset, line.size());
+    erase = std::min(erase, line.size() - offset);
+    const size_t old_end = offset + erase;
+    const size_t new_end = offset + insert.size;
+    const int64_t delta = static_cast<int64_t>(insert.size) - static_cast<int64_t>(erase);
+    line.replace(offset, erase, insert.data, insert.size);
+
+    // Tokens ending before the edit are unchanged, at least one whitespace character separates them from it.
+    // A token touching the edit may grow into it, so scanning starts at the first token ending at or after it.
+    size_t first = FindToken(offset);
+    size_t scan = first < tokens.size() ? std::min<size_t>(Begin(first), offset) : offset;
+    Context context = first < tokens.size() ? tokens[first].before : last;
+
+    // Re-tokenize until a token starts where an old token past the edit started, the tokenizer is in
+    // the same state at every token start, so from there on the tokens are the old ones shifted
+    arena.Clear();
+    fresh.clear();
+    size_t resync = first;
+    bool synced = false;
+    ArgTokenizer tokenizer(line.data() + scan, line.size() - scan, arena, windowsQuoting);
+    ArgView text;
+    while (tokenizer.Next(text)) {
+        ArgView raw = tokenizer.Raw();
+        size_t begin = static_cast<size_t>(raw.data - line.data());
+        if (begin >= new_end) {
+            while (resync < tokens.size() && (Begin(resync) < old_end || static_cast<int64_t>(Begin(resync)) + delta < static_cast<int64_t>(begin))) {
+                ++resync;
+            }
+            if (resync < tokens.size() && static_cast<int64_t>(Begin(resync)) + delta == static_cast<int64_t>(begin)) {
+                synced = true;
+                break;
+            }
+        }
+        fresh.push_back(MakeToken(begin, raw.size, text));
+    }
+    if (!synced) resync = tokens.size();
+
+    // Drop the replaced tokens, the ones after them move by delta
+    for (size_t i = first; i < resync; ++i) {
+        Forget(tokens[i]);
+    }
+    MoveShift(resync);
+    shiftBy += static_cast<uint32_t>(delta);
+    shiftFrom = first + fresh.size();
+    if (fresh.size() > resync - first) {
+        tokens.insert(tokens.begin() + resync, fresh.size() - (resync - first), Token());
+    } else {
+        tokens.erase(tokens.begin() + first + fresh.size(), tokens.begin() + resync);
+    }
+    std::copy(fresh.begin(), fresh.end(), tokens.begin() + first);
+
+    // Re-match until the state before an old token is the one it already had
+    size_t stop = first + fresh.size();
+    size_t i = first;
+    for (; i < tokens.size(); ++i) {
+        if (i >= stop && tokens[i].before == context) break;
+        Match(i, context);
+    }
+    rematched = i - first;
+    if (i == tokens.size()) {
+        last = context;
+        Finish();
+    }
+    if (unquoted.size() > 2 * unquotedLive + 4096) Compact();
+}
+
+ARGHAND_DECL size_t Arghand::Session::FindToken(size_t offset) const {
+    size_t low = 0;
+    size_t high = tokens.size();
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (End(mid) < offset) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+ARGHAND_DECL Arghand::Session::TokenInfo Arghand::Session::GetToken(size_t index) const {
+    const Token& token = tokens[index];
+    TokenInfo info;
+    info.begin = Begin(index);
+    info.end = End(index);
+    info.text = Text(index);
+    info.kind = token.kind;
+    info.option = token.option;
+    info.status = token.status;
+    return info;
+}
+
+ARGHAND_DECL bool Arghand::Session::GetDiagnostic(Diagnostic& diagnostic) const {
+    const Token* token = FirstStop();
+    if (!token) {
+        if (lastCode < 0) return false;
+        diagnostic.code = static_cast<DiagnosticCode>(lastCode);
+        diagnostic.option = lastOption;
+        if (diagnostic.code == DiagnosticCode::MissingPositional) {
+            // Reported after the last token, with the name of the slot
+            diagnostic.index = tokens.size();
+            diagnostic.token = spec.table.LongName(lastOption);
+            return true;
+        }
+        diagnostic.index = tokens.size() - 1;
+        diagnostic.token = Text(diagnostic.index);
+        return true;
+    }
+    if (token->code < 0) return false;
+    size_t index = static_cast<size_t>(token - tokens.data());
+    diagnostic.code = static_cast<DiagnosticCode>(token->code);
+    diagnostic.index = token->atPending ? index - 1 : index;
+    diagnostic.token = Text(diagnostic.index);
+    diagnostic.option = token->errorOption;
+    return true;
+}
+
+ARGHAND_DECL size_t Arghand::Session::Complete(size_t cursor, std::vector<Completion>& out, size_t limit) const {
+    out.clear();
+    cursor = std::min(cursor, line.size());
+    size_t index = FindToken(cursor);
+    size_t start = cursor;
+    ArgView word;
+    Context context = index < tokens.size() ? tokens[index].before : last;
+    if (index < tokens.size() && Begin(index) <= cursor) {
+        start = Begin(index);
+        // Quoted tokens are completed as a whole, plain ones up to the cursor
+        word = tokens[index].quoted ? Text(index) : ArgView(line.data() + start, cursor - start);
+    }
+    if (context.command || context.endOfOptions) return start;
+
+    bool looks_like_option = word.StartsWith(prefixLong) || word.StartsWith(prefixShort);
+    if (context.pending >= 0 && !looks_like_option) {
+        CompleteValue(context.pending, word, start, out, limit);
+        return start;
+    }
+    if (word.empty() || looks_like_option) {
+        ids.clear();
+        spec.CompletionNames().Candidates(word.data, word.size, limit, ids);
+        for (int32_t key : ids) {
+            Completion candidate;
+            candidate.option = key / 2;
+            candidate.prefix = key % 2 ? prefixLong : prefixShort;
+            candidate.name = key % 2 ? spec.table.LongName(candidate.option) : spec.table.ShortName(candidate.option);
+            candidate.kind = CompletionKind::Option;
+            out.push_back(candidate);
+        }
+    }
+    if (context.dispatch && !looks_like_option) {
+        for (size_t i = 0; i < spec.commandNames.size() && out.size() < limit; ++i) {
+            if (!StartsWith(spec.commandNames[i], word)) continue;
+            Completion candidate;
+            candidate.name = spec.commandNames[i];
+            candidate.kind = CompletionKind::Command;
+            candidate.option = static_cast<OptionId>(i);
+            out.push_back(candidate);
+        }
+    }
+    return start;
+}
+
+ARGHAND_DECL void Arghand::Session::Init() {
+    MatchState state;
+    spec.InitMatchState(state, nullptr, nullptr);
+    prefixLong = state.prefix_lng;
+    prefixShort = state.prefix_sht;
+    windowsQuoting = state.windowsQuoting;
+    foldCase = (QSTU64(spec.parserOptions) & QSTU64(ParserOptions::IgnoreCase)) != 0;
+    last.pending = -1;
+    last.dispatch = !spec.commandIndex.empty();
+    last.command = false;
+    last.endOfOptions = false;
+    last.positionals = 0;
+    diagnostics.capacity = 1;
+    diagnostics.records.reserve(1);
+    spec.CompletionNames(); // Built now rather than on the first tab
+}
+
+ARGHAND_DECL Arghand::Session::Token Arghand::Session::MakeToken(size_t begin, size_t raw_size, const ArgView& text) {
+    Token token = Token();
+    token.begin = static_cast<uint32_t>(begin);
+    token.end = static_cast<uint32_t>(begin + raw_size);
+    token.size = static_cast<uint32_t>(text.size);
+    // Plain tokens are views into the line, only unquoted ones need storage of their own
+    token.quoted = text.data != line.data() + begin;
+    if (token.quoted) {
+        token.text = static_cast<uint32_t>(unquoted.size());
+        unquoted.append(text.data, text.size);
+        unquotedLive += text.size;
+    }
+    token.status = ParseResult::Success;
+    token.code = -1;
+    token.option = token.errorOption = -1;
+    return token;
+}
+
+ARGHAND_DECL void Arghand::Session::MoveShift(size_t at) {
+    for (size_t i = shiftFrom; i < at && i < tokens.size(); ++i) {
+        tokens[i].begin += shiftBy;
+        tokens[i].end += shiftBy;
+    }
+    for (size_t i = at; i < shiftFrom && i < tokens.size(); ++i) {
+        tokens[i].begin -= shiftBy;
+        tokens[i].end -= shiftBy;
+    }
+    shiftFrom = at;
+}
+
+ARGHAND_DECL void Arghand::Session::Match(size_t index, Context& context) {
+    Token& token = tokens[index];
+    if (token.status != ParseResult::Success) --stops;
+    token.before = context;
+    token.status = ParseResult::Success;
+    token.code = -1;
+    token.atPending = false;
+    token.option = token.errorOption = -1;
+    token.kind = TokenKind::Positional;
+    if (context.command) return;
+
+    ArgView text = Text(index);
+    spec.InitMatchState(state, nullptr, nullptr);
+    state.diagnostics = &diagnostics;
+    state.index = index;
+    state.pending = context.pending;
+    state.pendingIndex = index - 1;
+    state.pendingArg = context.pending >= 0 ? Text(index - 1) : ArgView();
+    state.dispatch = context.dispatch;
+    state.endOfOptions = context.endOfOptions;
+    state.positionals = context.positionals;
+    diagnostics.Clear();
+
+    bool looks_like_option = !context.endOfOptions && (text.StartsWith(state.prefix_lng) || text.StartsWith(state.prefix_sht));
+    if (state.pending >= 0 && looks_like_option) {
+        // The pending option takes its default value, or is missing its value
+        ParseResult res = spec.CompleteValue(state, *this, nullptr);
+        if (res != ParseResult::Success) {
+            Stop(token, res);
+            token.atPending = true;
+            state.pending = -1;
+        }
+    }
+    if (state.pending >= 0) {
+        token.kind = TokenKind::Value;
+        token.option = state.pending;
+    } else if (looks_like_option) {
+        int32_t id = spec.FindOption(text, state);
+        token.kind = id >= 0 ? TokenKind::Option : TokenKind::Unknown;
+        token.option = id >= 0 ? id : -1;
+    }
+
+    ParseResult res = spec.MatchToken(text, state, *this);
+    if (res != ParseResult::Success) {
+        if (token.status == ParseResult::Success) Stop(token, res);
+        state.pending = -1;
+    }
+    if (state.command >= 0) {
+        token.kind = TokenKind::Command;
+        token.option = state.command;
+    } else if (state.endOfOptions && !context.endOfOptions) {
+        token.kind = TokenKind::EndOfOptions;
+        token.option = -1;
+    }
+    context.pending = state.pending;
+    context.dispatch = state.dispatch;
+    context.command = state.command >= 0;
+    context.endOfOptions = state.endOfOptions;
+    // Positional arguments past the slots all match alike, capping the count keeps later contexts equal
+    size_t slots = spec.positionalSlots.size() + (spec.positionalTail >= 0 ? 1 : 0);
+    context.positionals = static_cast<uint32_t>(std::min(state.positionals, slots));
+}
+
+ARGHAND_DECL void Arghand::Session::Finish() {
+    lastStatus = ParseResult::Success;
+    lastCode = -1;
+    lastOption = -1;
+    if (last.command) return;
+    spec.InitMatchState(state, nullptr, nullptr);
+    state.diagnostics = &diagnostics;
+    state.pending = last.pending;
+    state.index = tokens.size();
+    state.positionals = last.positionals;
+    if (last.pending >= 0) {
+        state.pendingIndex = tokens.size() - 1;
+        state.pendingArg = Text(tokens.size() - 1);
+    }
+    diagnostics.Clear();
+    lastStatus = spec.FinishArguments(state, *this);
+    if (lastStatus != ParseResult::Success && !diagnostics.records.empty()) {
+        lastCode = static_cast<int8_t>(diagnostics.records[0].code);
+        lastOption = diagnostics.records[0].option;
+    }
+}
+
+ARGHAND_DECL void Arghand::Session::CompleteValue(int32_t id, ArgView word, size_t& start, std::vector<Completion>& out, size_t limit) const {
+    uint64_t flags = spec.table.Flags(id);
+    if ((flags & QSTU64(CmdOptionFlags::IsList)) && !word.empty()) {
+        for (size_t i = word.size; i-- > 0;) {
+            if (word[i] != spec.ListSeparator) continue;
+            // Only a plain word maps back onto the line
+            if (word.data >= line.data() && word.data < line.data() + line.size()) start += i + 1;
+            word = ArgView(word.data + i + 1, word.size - i - 1);
+            break;
+        }
+    }
+
+    Completion candidate;
+    candidate.option = id;
+    candidate.kind = CompletionKind::Value;
+    if ((flags & QSTU64(CmdOptionFlags::IsEnum)) && spec.typed) {
+        const Spec::TypeRule& rule = spec.rules[id];
+        for (uint32_t c = 0; c < rule.choiceCount && out.size() < limit; ++c) {
+            candidate.name = spec.choices[rule.firstChoice + c];
+            if (StartsWith(candidate.name, word)) out.push_back(candidate);
+        }
+    } else if (flags & QSTU64(CmdOptionFlags::IsBoolean)) {
+        static const char* const values[] = { "false", "true" };
+        for (size_t v = 0; v < 2 && out.size() < limit; ++v) {
+            candidate.name = values[v];
+            if (StartsWith(candidate.name, word)) out.push_back(candidate);
+        }
+    } else if (limit) {
+        candidate.kind = CompletionKind::Hint;
+        candidate.name = spec.table.Allowed(id).empty() ? spec.table.DefaultValue(id) : spec.table.Allowed(id);
+        if (!candidate.name.empty()) out.push_back(candidate);
+    }
+}
+
+ARGHAND_DECL void Arghand::Session::Compact() {
+    std::string kept;
+    kept.reserve(unquotedLive);
+    for (Token& token : tokens) {
+        if (!token.quoted) continue;
+        uint32_t offset = static_cast<uint32_t>(kept.size());
+        kept.append(unquoted, token.text, token.size);
+        token.text = offset;
+    }
+    unquoted.swap(kept);
+}
+
+#undef ParserOptionsExist
+#undef ARGHAND_DECL
+#undef ARGHAND_AVX2
+#undef ARGHAND_SSE2
+#undef ARGHAND_NEON
+
+#endif // ARGHAND_INL
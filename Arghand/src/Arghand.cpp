@@ -0,0 +1,12 @@
+/*+++
+Arghand.cpp - Compiled part of the Arghand Argument Handler Library
+
+Only needed when ARGHAND_SEPARATE_COMPILATION is defined, see Arghand.h. Compile this file once
+into the program or a library and include Arghand.h everywhere else.
+
+Licensed under the BSD 2-Clause License. See LICENSE file in the project/package root for details.
+
+Author: Antonako1
+---*/
+#include <Arghand.h>
+#include <Arghand.inl>
@@ -0,0 +1,940 @@
+#include <Arghand.h>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <thread>
+
+// Parameterized microbenchmarks for the parser, the accessors and the conversion helpers.
+// Usage: arghand-bench [--format text|csv|json] [--quick] [--filter <benchmark>]
+// Every result row carries its parameters, the time per unit and the heap allocations per operation,
+// so runs can be compared across releases.
+
+// Counts heap allocations of the whole program, read around the measured code.
+// Atomic because the batch benchmark allocates from several threads.
+static std::atomic<size_t> allocationCount(0);
+
+static void* CountedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+// GCC pairs the inlined malloc and free with new and delete and warns about the mismatch
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedNs(Clock::time_point start, Clock::time_point end) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+// One result row, parameters that do not apply stay 0
+typedef struct BenchResult {
+    std::string benchmark;  // Benchmark name, e.g. "parse"
+    std::string variant;    // Variant within the benchmark, e.g. "zero_copy"
+    size_t options;         // Option table size
+    size_t args;            // Arguments per parse
+    size_t listSize;        // Elements per list value
+    bool ignoreCase;        // ParserOptions::IgnoreCase
+    bool windows;           // ParserOptions::StyleWindows instead of StyleUnix
+    double value;           // Measured value
+    std::string unit;       // Unit of value, e.g. "ns/arg" or "GB/s"
+    double allocs;          // Heap allocations per operation
+} BenchResult;
+
+static std::vector<BenchResult> results;
+
+static BenchResult& AddResult(const std::string& benchmark, const std::string& variant) {
+    results.push_back(BenchResult());
+    BenchResult& result = results.back();
+    result.benchmark = benchmark;
+    result.variant = variant;
+    result.options = result.args = result.listSize = 0;
+    result.ignoreCase = result.windows = false;
+    result.value = result.allocs = 0.0;
+    return result;
+}
+
+static ParserOptions MakeParserOptions(bool ignoreCase, bool windows, bool zeroCopy) {
+    ParserOptions options = windows ? ParserOptions::StyleWindows : ParserOptions::StyleUnix;
+    if (ignoreCase) options = options | ParserOptions::IgnoreCase;
+    if (zeroCopy) options = options | ParserOptions::ZeroCopy;
+    return options;
+}
+
+static std::vector<CmdOption> MakeOptions(size_t optionCount) {
+    std::vector<CmdOption> options;
+    for (size_t i = 0; i < optionCount; ++i) {
+        std::string n = std::to_string(i);
+        options.push_back(CMD_OPTION("s" + n, "option-" + n, InputDefault, "", "Generated option"));
+    }
+    return options;
+}
+
+// Owns a generated argv, alternating short and long options with one value each
+typedef struct BenchArgv {
+    std::vector<std::string> storage;
+    std::vector<char*> argv;
+
+    BenchArgv(size_t optionCount, size_t argCount, bool windows) {
+        storage.push_back("arghand-bench");
+        for (size_t i = 0; i < argCount / 2; ++i) {
+            std::string id = std::to_string((i * 7919) % optionCount);
+            storage.push_back((windows ? "/" : (i % 2 ? "--" : "-")) + std::string(i % 2 ? "option-" : "s") + id);
+            storage.push_back("value");
+        }
+        for (auto& s : storage) argv.push_back(&s[0]);
+    }
+    int argc() const { return static_cast<int>(argv.size()); }
+} BenchArgv;
+
+// Measures parse() time per argument and allocations per parse, over option count, argument count,
+// case folding, option style and parse mode. With the option index the cost per argument should stay flat.
+static void BenchParse(size_t optionCount, size_t argCount, bool ignoreCase, bool windows, bool zeroCopy) {
+    Arghand handler;
+    handler.SetCmdOptions(MakeOptions(optionCount));
+    handler.SetParserOptions(MakeParserOptions(ignoreCase, windows, zeroCopy));
+    BenchArgv args(optionCount, argCount, windows);
+
+    // Repeat small parses so every measurement covers about a million arguments
+    const size_t iterations = std::max<size_t>(1, 1000000 / std::max<size_t>(argCount, 1));
+    handler.parse(args.argc(), args.argv.data()); // Warm up, sizes the result buffers
+    size_t allocations = allocationCount;
+    Arghand::ParseResult res = Arghand::ParseResult::Success;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations && res == Arghand::ParseResult::Success; ++i) {
+        res = handler.parse(args.argc(), args.argv.data());
+    }
+    auto end = Clock::now();
+    allocations = allocationCount - allocations;
+
+    BenchResult& result = AddResult("parse", res == Arghand::ParseResult::Success ? (zeroCopy ? "zero_copy" : "owning") : "failed");
+    result.options = optionCount;
+    result.args = argCount;
+    result.ignoreCase = ignoreCase;
+    result.windows = windows;
+    result.value = ElapsedNs(start, end) / static_cast<double>(iterations * (args.argv.size() - 1));
+    result.unit = "ns/arg";
+    result.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+}
+
+// Measures the cost of instrumentation per argument: off, with stats, and with stats and a trace callback.
+static void BenchStats(size_t argCount) {
+    const size_t optionCount = 100;
+    const char* variants[] = { "off", "stats", "trace" };
+    BenchArgv args(optionCount, argCount, false);
+    const size_t iterations = std::max<size_t>(1, 1000000 / std::max<size_t>(argCount, 1));
+
+    for (int v = 0; v < 3; ++v) {
+        Arghand handler;
+        handler.SetCmdOptions(MakeOptions(optionCount));
+        handler.SetParserOptions(MakeParserOptions(false, false, true));
+        handler.EnableStats(v >= 1);
+        size_t traced = 0;
+        if (v == 2) handler.SetTraceCallback([&traced](const ArgView&, Arghand::TokenKind, Arghand::OptionId) { ++traced; });
+
+        handler.parse(args.argc(), args.argv.data());
+        size_t allocations = allocationCount;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            handler.parse(args.argc(), args.argv.data());
+        }
+        auto end = Clock::now();
+        allocations = allocationCount - allocations;
+
+        BenchResult& result = AddResult("stats", variants[v]);
+        result.options = optionCount;
+        result.args = argCount;
+        result.value = ElapsedNs(start, end) / static_cast<double>(iterations * (args.argv.size() - 1));
+        result.unit = "ns/arg";
+        result.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+    }
+}
+
+// Measures parses that fail on an unknown option against ones that succeed, per parse: the error
+// rendered as a message with suggestions, collected as a record, and dropped in quiet mode.
+static void BenchDiagnostics(size_t optionCount) {
+    const char* variants[] = { "success", "message", "collect", "quiet" };
+    const Arghand::Spec spec(MakeOptions(optionCount), MakeParserOptions(false, false, true));
+    const size_t iterations = 100000;
+
+    for (int v = 0; v < 4; ++v) {
+        Arghand::Result result;
+        std::string message;
+        if (v == 1) result.SetDiagnosticCallback([&](const Arghand::Diagnostic& d) { message = spec.FormatDiagnostic(d); });
+        if (v == 2) result.CollectDiagnostics(4);
+        if (v == 3) result.SetQuiet(true);
+        const ArgView command(v == 0 ? "--option-1 value input.dat --option-2 value" : "--option-1 value input.dat --optoin-2 value");
+
+        bool failed = spec.parse(command, result) != Arghand::ParseResult::Success;
+        size_t allocations = allocationCount;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            spec.parse(command, result);
+        }
+        auto end = Clock::now();
+        allocations = allocationCount - allocations;
+
+        BenchResult& row = AddResult("diagnostics", failed == (v != 0) ? variants[v] : "failed");
+        row.options = optionCount;
+        row.args = 4;
+        row.value = ElapsedNs(start, end) / static_cast<double>(iterations);
+        row.unit = "ns/parse";
+        row.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+    }
+}
+
+// Measures the accessors after a parse, once per option, for each query pattern.
+static void BenchQuery(size_t optionCount) {
+    Arghand handler;
+    std::vector<CmdOption> options = MakeOptions(optionCount);
+    handler.SetCmdOptions(options);
+    BenchArgv args(optionCount, optionCount, false);
+    handler.parse(args.argc(), args.argv.data());
+
+    std::vector<std::string> names;
+    std::vector<Arghand::OptionId> ids;
+    for (const auto& option : options) {
+        names.push_back(option.long_name);
+        ids.push_back(handler.GetOptionId(option.long_name));
+    }
+
+    const char* patterns[] = { "is_set_by_name", "is_set_by_id", "value_by_name", "value_by_id", "view_by_name", "view_by_id" };
+    for (int pattern = 0; pattern < 6; ++pattern) {
+        const size_t rounds = std::max<size_t>(1, 1000000 / optionCount);
+        size_t hits = 0;
+        size_t allocations = allocationCount;
+        auto start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < optionCount; ++i) {
+                switch (pattern) {
+                case 0: hits += handler[names[i]]; break;
+                case 1: hits += handler.IsSet(ids[i]); break;
+                case 2: hits += handler.GetValue(names[i]).size(); break;
+                case 3: hits += handler.GetValue(ids[i]).size(); break;
+                case 4: hits += handler.GetValueView(names[i]).size; break;
+                default: hits += handler.GetValueView(ids[i]).size; break;
+                }
+            }
+        }
+        auto end = Clock::now();
+        allocations = allocationCount - allocations;
+
+        BenchResult& result = AddResult("query", hits ? patterns[pattern] : "no_hits");
+        result.options = optionCount;
+        result.value = ElapsedNs(start, end) / static_cast<double>(rounds * optionCount);
+        result.unit = "ns/query";
+        result.allocs = static_cast<double>(allocations) / static_cast<double>(rounds * optionCount);
+    }
+}
+
+// Measures typed options: the parse with and without conversion at parse time, and reading an integer
+// by converting its string on every read against the typed getter.
+static void BenchTyped(size_t optionCount) {
+    std::vector<std::string> storage(1, "arghand-bench");
+    for (size_t i = 0; i < optionCount; ++i) {
+        storage.push_back("--option-" + std::to_string(i));
+        storage.push_back(std::to_string(i * 7919));
+    }
+    std::vector<char*> argv;
+    for (auto& arg : storage) argv.push_back(&arg[0]);
+
+    for (int typed = 0; typed < 2; ++typed) {
+        std::vector<CmdOption> options = MakeOptions(optionCount);
+        for (auto& option : options) {
+            if (typed) option.options |= QSTU64(CmdOptionFlags::IsInteger);
+        }
+        Arghand handler;
+        handler.SetCmdOptions(options);
+        handler.SetParserOptions(MakeParserOptions(false, false, false));
+        std::vector<Arghand::OptionId> ids;
+        for (const auto& option : options) {
+            ids.push_back(handler.GetOptionId(option.long_name));
+        }
+
+        const size_t iterations = std::max<size_t>(1, 100000 / optionCount);
+        Arghand::ParseResult res = handler.parse(static_cast<int>(argv.size()), argv.data());
+        size_t allocations = allocationCount;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            handler.parse(static_cast<int>(argv.size()), argv.data());
+        }
+        auto end = Clock::now();
+        BenchResult& parse = AddResult("typed", res != Arghand::ParseResult::Success ? "failed" : typed ? "parse_typed" : "parse_untyped");
+        parse.options = optionCount;
+        parse.args = argv.size() - 1;
+        parse.value = ElapsedNs(start, end) / static_cast<double>(iterations * (argv.size() - 1));
+        parse.unit = "ns/arg";
+        parse.allocs = static_cast<double>(allocationCount - allocations) / static_cast<double>(iterations);
+
+        // Reads every option repeatedly, as a hot loop would
+        const size_t rounds = std::max<size_t>(1, 1000000 / optionCount);
+        int64_t sum = 0;
+        Arghand::ConvertResult error = Arghand::ConvertResult::Success;
+        allocations = allocationCount;
+        start = Clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < optionCount; ++i) {
+                if (typed) sum += handler.Get<int64_t>(ids[i]);
+                else sum += Arghand::ToInteger(handler.GetValue(ids[i]), &error);
+            }
+        }
+        end = Clock::now();
+        BenchResult& query = AddResult("typed", error != Arghand::ConvertResult::Success || sum == 0 ? "failed" : typed ? "get_by_id" : "to_integer_by_id");
+        query.options = optionCount;
+        query.value = ElapsedNs(start, end) / static_cast<double>(rounds * optionCount);
+        query.unit = "ns/query";
+        query.allocs = static_cast<double>(allocationCount - allocations) / static_cast<double>(rounds * optionCount);
+    }
+}
+
+static constexpr StaticCmdOption staticOptions[] = {
+    STATIC_CMD_OPTION("h", "help",     HelpOptionDefault,      "",           "Display help information"),
+    STATIC_CMD_OPTION("v", "",         VersionOptionDefault,   "",           "Display version information"),
+    STATIC_CMD_OPTION("o", "output",   InputDefault,           "output.txt", "Specify output file"),
+    STATIC_CMD_OPTION("l", "list",     ListInputDefault,       "a,b",        "Specify a list of values (comma-separated)"),
+};
+static constexpr auto staticIndex = Arghand::MakeStaticIndex(staticOptions);
+
+// Measures the setup-and-parse cost of a short-lived tool, runtime table versus compile-time table.
+static void BenchStartup(size_t iterations) {
+    char arg0[] = "arghand-bench", arg1[] = "--output", arg2[] = "file.txt";
+    char* argv[] = { arg0, arg1, arg2 };
+
+    size_t allocations = allocationCount;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        Arghand handler;
+        handler.SetCmdOptions({
+            CMD_OPTION("h", "help",     HelpOptionDefault,      "",           "Display help information"),
+            CMD_OPTION("v", "",         VersionOptionDefault,   "",           "Display version information"),
+            CMD_OPTION("o", "output",   InputDefault,           "output.txt", "Specify output file"),
+            CMD_OPTION("l", "list",     ListInputDefault,       "a,b",        "Specify a list of values (comma-separated)"),
+        });
+        handler.parse(3, argv);
+    }
+    auto mid = Clock::now();
+    size_t runtimeAllocations = allocationCount - allocations;
+    size_t found = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        auto parser = Arghand::MakeStatic(staticOptions, staticIndex);
+        parser.parse(3, argv);
+        found += parser.Has(2);
+    }
+    auto end = Clock::now();
+    size_t staticAllocations = allocationCount - allocations - runtimeAllocations;
+
+    BenchResult& runtime = AddResult("startup", "runtime_table");
+    runtime.options = 4;
+    runtime.args = 2;
+    runtime.value = ElapsedNs(start, mid) / static_cast<double>(iterations);
+    runtime.unit = "ns";
+    runtime.allocs = static_cast<double>(runtimeAllocations) / static_cast<double>(iterations);
+
+    BenchResult& compiled = AddResult("startup", found == iterations ? "static_table" : "static_table_mismatch");
+    compiled.options = 4;
+    compiled.args = 2;
+    compiled.value = ElapsedNs(mid, end) / static_cast<double>(iterations);
+    compiled.unit = "ns";
+    compiled.allocs = static_cast<double>(staticAllocations) / static_cast<double>(iterations);
+}
+
+// Measures parsing a command string of about the given size, in GB/s of command text.
+static void BenchCommandString(size_t bytes, bool windows) {
+    std::vector<CmdOption> options = {
+        CMD_OPTION("o", "output",   InputDefault,           "output.txt", "Specify output file"),
+        CMD_OPTION("l", "list",     ListInputDefault,       "a,b",        "Specify a list of values (comma-separated)"),
+    };
+    const Arghand::Spec spec(options, MakeParserOptions(false, windows, true));
+    Arghand::Result result;
+
+    // Mostly plain tokens of mixed length, with a quoted value now and then
+    std::string command;
+    size_t tokens = 0;
+    const char* flag = windows ? "/output " : "--output ";
+    for (size_t i = 0; command.size() < bytes; ++i, ++tokens) {
+        if (i % 8 == 0) command += flag, ++tokens;
+        if (i % 16 == 5) command += "\"C:\\\\Program Files\\\\input file " + std::to_string(i) + ".txt\" ";
+        else command += "positional_argument_" + std::string(i % 23, 'x') + std::to_string(i) + " ";
+    }
+
+    const size_t iterations = (256u << 20) / command.size() + 1;
+    spec.parse(ArgView(command), result);
+    size_t allocations = allocationCount;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        spec.parse(ArgView(command), result);
+    }
+    auto end = Clock::now();
+    allocations = allocationCount - allocations;
+
+    BenchResult& row = AddResult("command_string", "bytes_" + std::to_string(command.size()));
+    row.args = tokens;
+    row.windows = windows;
+    row.value = static_cast<double>(command.size() * iterations) / ElapsedNs(start, end);
+    row.unit = "GB/s";
+    row.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+}
+
+// Parses into a caller-supplied buffer sized with Spec::RequiredMemory, against the heap, in ns per argument.
+// Once the buffer is sized neither argv nor a command string should allocate.
+static void BenchMemory(size_t optionCount, size_t argCount) {
+    const Arghand::Spec spec(MakeOptions(optionCount), MakeParserOptions(false, false, false));
+    BenchArgv args(optionCount, argCount, false);
+    std::string command;
+    for (size_t i = 1; i < args.storage.size(); ++i) command += args.storage[i] + " ";
+
+    const char* variants[] = { "heap", "fixed_buffer", "command_string" };
+    for (size_t v = 0; v < 3; ++v) {
+        std::vector<char> storage(v == 0 ? 1 : (v == 1 ? spec.RequiredMemory(args.argc(), args.argv.data()) : spec.RequiredMemory(ArgView(command))));
+        Arghand::MonotonicBuffer buffer(storage.data(), storage.size());
+        Arghand::Result result;
+        if (v != 0) result.SetMemory(&buffer);
+        auto run = [&]() {
+            return v == 2 ? spec.parse(ArgView(command), result) : spec.parse(args.argc(), args.argv.data(), result);
+        };
+
+        const size_t iterations = std::max<size_t>(1, 1000000 / std::max<size_t>(argCount, 1));
+        run();
+        size_t allocations = allocationCount;
+        Arghand::ParseResult res = Arghand::ParseResult::Success;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations && res == Arghand::ParseResult::Success; ++i) {
+            res = run();
+        }
+        auto end = Clock::now();
+        allocations = allocationCount - allocations;
+
+        BenchResult& row = AddResult("memory", res == Arghand::ParseResult::Success ? variants[v] : "failed");
+        row.options = optionCount;
+        row.args = argCount;
+        row.value = ElapsedNs(start, end) / static_cast<double>(iterations * argCount);
+        row.unit = "ns/arg";
+        row.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+    }
+}
+
+// File lists as positional arguments, in ns per argument: matched one by one, after "--", and after "--"
+// into a tail slot read back as a view. After "--" the arguments are taken in one pass without matching.
+static void BenchPositionals(size_t argCount) {
+    std::vector<CmdOption> options = MakeOptions(100);
+    options.push_back(CMD_OPTION("", "files", PositionalListDefault, "", "Input files"));
+    const Arghand::Spec plain(MakeOptions(100), MakeParserOptions(false, false, true) | ParserOptions::EndOfOptions);
+    const Arghand::Spec slots(options, MakeParserOptions(false, false, true) | ParserOptions::EndOfOptions);
+    const Arghand::OptionId files = slots.GetOptionId("files");
+
+    std::vector<std::string> storage;
+    storage.reserve(argCount + 2);
+    storage.push_back("arghand-bench");
+    storage.push_back("--");
+    for (size_t i = 0; i < argCount; ++i) storage.push_back("src/module" + std::to_string(i) + ".cpp");
+    std::vector<char*> argv;
+    std::vector<char*> matched; // Without "--", every argument goes through the option lookup
+    for (auto& s : storage) {
+        argv.push_back(&s[0]);
+        if (argv.size() != 2) matched.push_back(&s[0]);
+    }
+
+    const char* variants[] = { "matched", "end_of_options", "tail_slot" };
+    for (size_t v = 0; v < 3; ++v) {
+        const Arghand::Spec& spec = v == 2 ? slots : plain;
+        std::vector<char*>& args = v == 0 ? matched : argv;
+        Arghand::Result result;
+        size_t taken = 0;
+        auto run = [&]() {
+            Arghand::ParseResult res = spec.parse(static_cast<int>(args.size()), args.data(), result);
+            taken = v == 2 ? result.GetValuesView(files).size() : result.GetPositionalViews().size();
+            return res;
+        };
+
+        const size_t iterations = std::max<size_t>(1, 1000000 / std::max<size_t>(argCount, 1));
+        run();
+        size_t allocations = allocationCount;
+        Arghand::ParseResult res = Arghand::ParseResult::Success;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations && res == Arghand::ParseResult::Success; ++i) {
+            res = run();
+        }
+        auto end = Clock::now();
+        allocations = allocationCount - allocations;
+
+        BenchResult& row = AddResult("positionals", res == Arghand::ParseResult::Success && taken == argCount ? variants[v] : "failed");
+        row.options = spec.GetCmdOptions().size();
+        row.args = argCount;
+        row.value = ElapsedNs(start, end) / static_cast<double>(iterations * argCount);
+        row.unit = "ns/arg";
+        row.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+    }
+}
+
+// Keystrokes on a long interactive line: an incremental session against parsing the whole line each time
+static void BenchSession(size_t optionCount, size_t tokens) {
+    const Arghand::Spec spec(MakeOptions(optionCount), MakeParserOptions(false, false, true));
+    std::string line;
+    for (size_t i = 0; i < tokens; i += 2) {
+        std::string n = std::to_string(i % optionCount);
+        line += (i % 4 ? "-s" + n : "--option-" + n) + " value_" + std::to_string(i) + " ";
+    }
+
+    Arghand::Session session(spec);
+    session.SetLine(line);
+    Arghand::Result result;
+    const size_t iterations = 200000;
+    const size_t middle = line.size() / 2;
+    std::vector<Arghand::Session::Completion> candidates;
+
+    // Type a character into the middle of the line and delete it again, two keystrokes per iteration
+    size_t allocations = allocationCount;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        session.Edit(middle, 0, "x");
+        session.Edit(middle, 1, "");
+    }
+    auto end = Clock::now();
+    BenchResult& typed = AddResult("session", "keystroke_middle");
+    typed.options = optionCount;
+    typed.args = session.size();
+    typed.value = ElapsedNs(start, end) / static_cast<double>(2 * iterations);
+    typed.unit = "ns/keystroke";
+    typed.allocs = static_cast<double>(allocationCount - allocations) / static_cast<double>(2 * iterations);
+
+    // Start a new option at the end of the line and complete it
+    const std::string word = "--option-1";
+    allocations = allocationCount;
+    start = Clock::now();
+    for (size_t i = 0; i < iterations / 10; ++i) {
+        for (size_t c = 0; c < word.size(); ++c) {
+            session.Edit(session.GetLine().size(), 0, ArgView(&word[c], 1));
+        }
+        session.Complete(session.GetLine().size(), candidates, 8);
+        session.Edit(session.GetLine().size() - word.size(), word.size(), "");
+    }
+    end = Clock::now();
+    BenchResult& completed = AddResult("session", "type_and_complete");
+    completed.options = optionCount;
+    completed.args = session.size();
+    completed.value = ElapsedNs(start, end) / static_cast<double>(iterations / 10 * (word.size() + 2));
+    completed.unit = "ns/keystroke";
+    completed.allocs = static_cast<double>(allocationCount - allocations) / static_cast<double>(iterations / 10 * (word.size() + 2));
+
+    // What every keystroke cost before: parsing the whole line
+    const size_t reparses = std::max<size_t>(1, iterations / tokens);
+    spec.parse(ArgView(line), result);
+    allocations = allocationCount;
+    start = Clock::now();
+    for (size_t i = 0; i < reparses; ++i) {
+        spec.parse(ArgView(line), result);
+    }
+    end = Clock::now();
+    BenchResult& reparsed = AddResult("session", "full_reparse");
+    reparsed.options = optionCount;
+    reparsed.args = session.size();
+    reparsed.value = ElapsedNs(start, end) / static_cast<double>(reparses);
+    reparsed.unit = "ns/keystroke";
+    reparsed.allocs = static_cast<double>(allocationCount - allocations) / static_cast<double>(reparses);
+}
+
+// Measures matching unambiguous abbreviations of long names, in ns per argument, and unknown options
+// with spelling suggestions, in ns per error. Both should stay flat as the option table grows.
+static void BenchAbbreviation(size_t optionCount) {
+    std::vector<CmdOption> options;
+    for (size_t i = 0; i < optionCount; ++i) {
+        options.push_back(CMD_OPTION("", "generated-option-" + std::to_string(i * 7919 % 1000003) + "-name", NoInputDefault, "", "Generated option"));
+    }
+    const Arghand::Spec spec(options, MakeParserOptions(false, false, true) | ParserOptions::AllowAbbreviations);
+    Arghand::Result result;
+
+    // Each option abbreviated to its unique number, and the same names misspelled
+    std::vector<std::string> storage(1, "arghand-bench");
+    std::vector<std::string> typos;
+    for (size_t i = 0; i < 1000; ++i) {
+        const std::string& name = options[i * 7 % optionCount].long_name;
+        storage.push_back("--" + name.substr(0, name.size() - 4));
+        typos.push_back("--" + name.substr(0, 10) + name.substr(11));
+    }
+    std::vector<char*> argv;
+    for (auto& arg : storage) argv.push_back(&arg[0]);
+
+    const size_t iterations = 1000;
+    Arghand::ParseResult res = spec.parse(static_cast<int>(argv.size()), argv.data(), result);
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        spec.parse(static_cast<int>(argv.size()), argv.data(), result);
+    }
+    auto end = Clock::now();
+    BenchResult& row = AddResult("abbreviation", res == Arghand::ParseResult::Success ? "prefix" : "failed");
+    row.options = optionCount;
+    row.args = argv.size() - 1;
+    row.value = ElapsedNs(start, end) / static_cast<double>(iterations * (argv.size() - 1));
+    row.unit = "ns/arg";
+
+    std::vector<ArgView> views(typos.begin(), typos.end());
+    start = Clock::now();
+    std::vector<Arghand::BatchResult> items = spec.ParseBatch(views.data(), views.size(), 1);
+    std::vector<std::string> messages;
+    messages.reserve(items.size());
+    for (const Arghand::BatchResult& item : items) messages.push_back(spec.FormatDiagnostic(item.diagnostic));
+    end = Clock::now();
+    BenchResult& suggest = AddResult("abbreviation", messages[0].find("did you mean") != std::string::npos ? "suggest" : "failed");
+    suggest.options = optionCount;
+    suggest.args = 1;
+    suggest.value = ElapsedNs(start, end) / static_cast<double>(views.size());
+    suggest.unit = "ns/error";
+}
+
+// Measures loading a config file of the given number of keys, parsed from text and mapped from its snapshot.
+static void BenchConfig(size_t keys) {
+    const std::string path = "arghand-bench-config.ini";
+    const std::string snapshot = path + ".cache";
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return;
+    for (size_t i = 0; i < keys; ++i) {
+        if (i % 100 == 0) std::fprintf(file, "[section-%zu]\n", i / 100);
+        std::fprintf(file, "key-%zu = value number %zu\n", i % 100, i);
+    }
+    std::fclose(file);
+    std::remove(snapshot.c_str());
+
+    const size_t iterations = keys >= 100000 ? 10 : 100;
+    for (int cached = 0; cached < 2; ++cached) {
+        if (cached) {
+            Arghand::Config writer;
+            writer.Load(path, snapshot);
+        }
+        bool loaded = true;
+        size_t allocations = allocationCount;
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            Arghand::Config config;
+            loaded = config.Load(path, cached ? snapshot : std::string()) && config.size() == keys && config.FromSnapshot() == (cached != 0) && loaded;
+        }
+        auto end = Clock::now();
+        BenchResult& row = AddResult("config", !loaded ? "failed" : cached ? "snapshot" : "parse");
+        row.options = keys;
+        row.value = ElapsedNs(start, end) / 1000.0 / static_cast<double>(iterations);
+        row.unit = "us/load";
+        row.allocs = static_cast<double>(allocationCount - allocations) / static_cast<double>(iterations);
+    }
+    std::remove(path.c_str());
+    std::remove(snapshot.c_str());
+}
+
+// Measures batch validation of many short command strings, in command lines per second, over thread counts.
+static void BenchBatch(size_t count, unsigned threads) {
+    std::vector<CmdOption> options = MakeOptions(100);
+    const Arghand::Spec spec(options, MakeParserOptions(false, false, false));
+
+    // Typical job command lines, with an unknown option in every tenth
+    std::vector<std::string> commands;
+    for (size_t i = 0; i < count; ++i) {
+        std::string id = std::to_string(i % 100);
+        commands.push_back("--option-" + id + " value-" + std::to_string(i) + " -s" + id + " x input_" + std::to_string(i) + ".dat" + (i % 10 == 9 ? " --unknown" : ""));
+    }
+    std::vector<ArgView> views(commands.begin(), commands.end());
+
+    spec.ParseBatch(views.data(), views.size(), threads);
+    size_t allocations = allocationCount;
+    auto start = Clock::now();
+    std::vector<Arghand::BatchResult> items = spec.ParseBatch(views.data(), views.size(), threads);
+    auto end = Clock::now();
+    allocations = allocationCount - allocations;
+
+    size_t failures = 0;
+    for (const auto& item : items) failures += item.result != Arghand::ParseResult::Success;
+    BenchResult& row = AddResult("batch", failures == count / 10 ? "threads_" + std::to_string(threads) : "failed");
+    row.options = options.size();
+    row.args = count;
+    row.value = static_cast<double>(count) * 1e9 / ElapsedNs(start, end);
+    row.unit = "lines/s";
+    row.allocs = static_cast<double>(allocations) / static_cast<double>(count);
+}
+
+// Measures parsing and walking one list option with many elements, split eagerly versus lazily.
+static void BenchList(size_t elements, bool lazy) {
+    std::vector<CmdOption> options = {
+        CMD_OPTION("i", "ids",      ListInputDefault,       "",           "Specify a list of IDs (comma-separated)"),
+    };
+    ParserOptions parserOptions = ParserOptions::DefaultOptions | ParserOptions::ZeroCopy;
+    if (lazy) parserOptions = parserOptions | ParserOptions::LazyLists;
+    const Arghand::Spec spec(options, parserOptions);
+    Arghand::Result result;
+
+    std::string ids;
+    for (size_t i = 0; i < elements; ++i) {
+        ids += std::to_string(100000 + i * 7919 % 900000);
+        ids += ',';
+    }
+    ids.pop_back();
+    char arg0[] = "arghand-bench", arg1[] = "--ids";
+    char* argv[] = { arg0, arg1, &ids[0] };
+
+    const size_t iterations = std::max<size_t>(1, 20000000 / elements);
+    size_t bytes = 0;
+    spec.parse(3, argv, result);
+    size_t allocations = allocationCount;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        spec.parse(3, argv, result);
+        for (const ArgView& id : result.GetListView("ids")) bytes += id.size;
+    }
+    auto end = Clock::now();
+    allocations = allocationCount - allocations;
+
+    BenchResult& row = AddResult("list", bytes ? (lazy ? "lazy" : "eager") : "empty");
+    row.options = 1;
+    row.args = 2;
+    row.listSize = elements;
+    row.value = ElapsedNs(start, end) / static_cast<double>(iterations * elements);
+    row.unit = "ns/element";
+    row.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+}
+
+// Measures converting a numeric list: std::stoi per ToList element, ToList alone, and the batch ToIntegers.
+static void BenchConvert(size_t elements) {
+    std::string list;
+    for (size_t i = 0; i < elements; ++i) {
+        list += std::to_string(static_cast<int64_t>(i * 2654435761u % 2000000) - 1000000);
+        list += ',';
+    }
+    list.pop_back();
+
+    int64_t checksum = 0;
+    size_t allocations = allocationCount;
+    auto start = Clock::now();
+    for (const std::string& item : Arghand::ToList(list, ',')) {
+        checksum += std::stoi(item);
+    }
+    auto mid = Clock::now();
+    size_t stoiAllocations = allocationCount - allocations;
+    std::vector<int64_t> values;
+    Arghand::ConvertResult res = Arghand::ToIntegers(ArgSplitView(list, ','), values);
+    for (int64_t value : values) checksum -= value;
+    auto end = Clock::now();
+    size_t batchAllocations = allocationCount - allocations - stoiAllocations;
+
+    BenchResult& stoi = AddResult("convert", "stoi");
+    stoi.listSize = elements;
+    stoi.value = ElapsedNs(start, mid) / static_cast<double>(elements);
+    stoi.unit = "ns/element";
+    stoi.allocs = static_cast<double>(stoiAllocations);
+
+    BenchResult& batch = AddResult("convert", res == Arghand::ConvertResult::Success && checksum == 0 ? "batch" : "batch_mismatch");
+    batch.listSize = elements;
+    batch.value = ElapsedNs(mid, end) / static_cast<double>(elements);
+    batch.unit = "ns/element";
+    batch.allocs = static_cast<double>(batchAllocations);
+
+    // 17 significant digits miss the exact double path and take the correctly rounded one
+    std::string reals;
+    for (size_t i = 0; i < elements; ++i) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.17g", static_cast<double>(i * 2654435761u % 2000000) / 7.0);
+        reals += text;
+        reals += ',';
+    }
+    reals.pop_back();
+    std::vector<double> doubles;
+    doubles.reserve(elements);
+    allocations = allocationCount;
+    start = Clock::now();
+    res = Arghand::ToDoubles(ArgSplitView(reals, ','), doubles);
+    end = Clock::now();
+    allocations = allocationCount - allocations;
+
+    BenchResult& rounded = AddResult("convert", res == Arghand::ConvertResult::Success && doubles.size() == elements ? "doubles_rounded" : "doubles_failed");
+    rounded.listSize = elements;
+    rounded.value = ElapsedNs(start, end) / static_cast<double>(elements);
+    rounded.unit = "ns/element";
+    rounded.allocs = static_cast<double>(allocations);
+}
+
+// Measures PrintHelp for a large option table, first render versus the cached text.
+static void BenchHelp(size_t optionCount, size_t iterations) {
+    Arghand handler;
+    handler.SetCmdOptions(MakeOptions(optionCount));
+    std::string text;
+    handler.SetOutput(Arghand::Output::ToString(text));
+
+    auto start = Clock::now();
+    handler.PrintHelp();
+    auto mid = Clock::now();
+    text.reserve(text.size());
+    size_t allocations = allocationCount;
+    for (size_t i = 0; i < iterations; ++i) {
+        text.clear();
+        handler.PrintHelp();
+    }
+    auto end = Clock::now();
+    allocations = allocationCount - allocations;
+
+    BenchResult& first = AddResult("help", "first");
+    first.options = optionCount;
+    first.value = ElapsedNs(start, mid);
+    first.unit = "ns";
+
+    BenchResult& cached = AddResult("help", "cached");
+    cached.options = optionCount;
+    cached.value = ElapsedNs(mid, end) / static_cast<double>(iterations);
+    cached.unit = "ns";
+    cached.allocs = static_cast<double>(allocations) / static_cast<double>(iterations);
+}
+
+static void WriteResults(const std::string& format) {
+    if (format == "json") {
+        std::cout << "[" << std::endl;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            std::cout << "  {\"benchmark\": \"" << r.benchmark << "\", \"variant\": \"" << r.variant
+                      << "\", \"options\": " << r.options << ", \"args\": " << r.args << ", \"list_size\": " << r.listSize
+                      << ", \"ignore_case\": " << (r.ignoreCase ? "true" : "false") << ", \"style\": \"" << (r.windows ? "windows" : "unix")
+                      << "\", \"value\": " << r.value << ", \"unit\": \"" << r.unit << "\", \"allocs_per_op\": " << r.allocs << "}"
+                      << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        std::cout << "]" << std::endl;
+        return;
+    }
+
+    const char* sep = format == "csv" ? "," : "\t";
+    std::cout << "benchmark" << sep << "variant" << sep << "options" << sep << "args" << sep << "list_size" << sep
+              << "ignore_case" << sep << "style" << sep << "value" << sep << "unit" << sep << "allocs_per_op" << std::endl;
+    for (const BenchResult& r : results) {
+        std::cout << r.benchmark << sep << r.variant << sep << r.options << sep << r.args << sep << r.listSize << sep
+                  << r.ignoreCase << sep << (r.windows ? "windows" : "unix") << sep << r.value << sep << r.unit << sep << r.allocs << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Arghand handler;
+    handler.SetCmdOptions({
+        CMD_OPTION("h", "help",     HelpOptionDefault,      "",           "Display help information"),
+        CMD_OPTION("f", "format",   InputDefault,           "text",       "Output format: text, csv or json"),
+        CMD_OPTION("q", "quick",    0,                      "",           "Run only the small sizes"),
+        CMD_OPTION("b", "filter",   InputDefault,           "",           "Run only the named benchmark (parse, stats, diagnostics, batch, abbreviation, config, query, typed, startup, command_string, session, memory, positionals, list, convert, help)"),
+    });
+    handler.SetApplicationName("arghand-bench");
+    handler.SetParserOptions(ParserOptions::DefaultOptions & ~ParserOptions::HelpDisplayLicense & ~ParserOptions::HelpDisplayHeader & ~ParserOptions::HelpDisplayFooter);
+    Arghand::ParseResult res = handler.parse(argc, argv);
+    if (res == Arghand::ParseResult::SuccessWithHelp) return 0;
+    if (res != Arghand::ParseResult::Success) return 1;
+
+    const std::string format = handler.GetValue("format");
+    const std::string filter = handler.GetValue("filter");
+    const bool quick = handler["quick"];
+    auto enabled = [&filter](const char* name) { return filter.empty() || filter == name; };
+
+    if (enabled("parse")) {
+        std::vector<size_t> optionCounts = quick ? std::vector<size_t>{ 10, 100 } : std::vector<size_t>{ 10, 100, 1000, 10000 };
+        std::vector<size_t> argCounts = quick ? std::vector<size_t>{ 10, 1000 } : std::vector<size_t>{ 10, 1000, 100000, 1000000 };
+        for (size_t o : optionCounts) {
+            for (size_t a : argCounts) {
+                for (int ic = 0; ic < 2; ++ic) {
+                    for (int win = 0; win < 2; ++win) {
+                        for (int zc = 0; zc < 2; ++zc) {
+                            BenchParse(o, a, ic != 0, win != 0, zc != 0);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (enabled("stats")) {
+        for (size_t a : quick ? std::vector<size_t>{ 10, 1000 } : std::vector<size_t>{ 10, 1000, 100000 }) {
+            BenchStats(a);
+        }
+    }
+
+    if (enabled("diagnostics")) {
+        for (size_t o : quick ? std::vector<size_t>{ 10, 100 } : std::vector<size_t>{ 10, 100, 1000, 10000 }) {
+            BenchDiagnostics(o);
+        }
+    }
+
+    if (enabled("batch")) {
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; threads <= cores; threads *= 2) {
+            BenchBatch(quick ? 10000 : 1000000, threads);
+        }
+        if ((cores & (cores - 1)) != 0) BenchBatch(quick ? 10000 : 1000000, cores);
+    }
+
+    if (enabled("abbreviation")) {
+        for (size_t o : quick ? std::vector<size_t>{ 1000 } : std::vector<size_t>{ 1000, 10000, 100000 }) {
+            BenchAbbreviation(o);
+        }
+    }
+
+    if (enabled("config")) {
+        for (size_t keys : quick ? std::vector<size_t>{ 100, 10000 } : std::vector<size_t>{ 100, 10000, 1000000 }) {
+            BenchConfig(keys);
+        }
+    }
+
+    if (enabled("query")) {
+        for (size_t o : quick ? std::vector<size_t>{ 10, 100 } : std::vector<size_t>{ 10, 100, 1000, 10000 }) {
+            BenchQuery(o);
+        }
+    }
+
+    if (enabled("typed")) {
+        for (size_t o : quick ? std::vector<size_t>{ 10, 100 } : std::vector<size_t>{ 10, 100, 1000, 10000 }) {
+            BenchTyped(o);
+        }
+    }
+
+    if (enabled("startup")) BenchStartup(quick ? 10000 : 100000);
+
+    if (enabled("command_string")) {
+        for (size_t bytes : quick ? std::vector<size_t>{ 4096 } : std::vector<size_t>{ 4096, 65536, 1048576 }) {
+            BenchCommandString(bytes, false);
+            BenchCommandString(bytes, true);
+        }
+    }
+
+    if (enabled("session")) {
+        for (size_t t : quick ? std::vector<size_t>{ 100, 1000 } : std::vector<size_t>{ 100, 1000, 10000, 100000 }) {
+            BenchSession(100, t);
+        }
+    }
+
+    if (enabled("memory")) {
+        for (size_t a : quick ? std::vector<size_t>{ 10, 1000 } : std::vector<size_t>{ 10, 1000, 100000 }) {
+            BenchMemory(100, a);
+        }
+    }
+
+    if (enabled("positionals")) {
+        for (size_t a : quick ? std::vector<size_t>{ 1000 } : std::vector<size_t>{ 1000, 100000, 1000000 }) {
+            BenchPositionals(a);
+        }
+    }
+
+    if (enabled("list")) {
+        for (size_t elements : quick ? std::vector<size_t>{ 10, 1000 } : std::vector<size_t>{ 10, 1000, 100000, 1000000 }) {
+            BenchList(elements, false);
+            BenchList(elements, true);
+        }
+    }
+
+    if (enabled("convert")) BenchConvert(quick ? 10000 : 1000000);
+
+    if (enabled("help")) BenchHelp(quick ? 100 : 1000, 1000);
+
+    WriteResults(format);
+    return 0;
+}
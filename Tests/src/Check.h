@@ -0,0 +1,111 @@
+// Minimal assertion-based test registry for arghand-tests, no dependencies beyond the standard library.
+// Every TEST registers itself, Test.cpp runs them all and fails the process if any CHECK failed.
+// Usage:
+//     TEST(LongOptionTakesValue) {
+//         ...
+//         CHECK(handler["output"]);
+//         CHECK_EQ(handler.GetValueView("output"), ArgView("x.txt"));
+//     }
+#ifndef ARGHAND_TESTS_CHECK_H
+#define ARGHAND_TESTS_CHECK_H
+
+#include <Arghand.h>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace check {
+
+typedef void (*TestFn)();
+
+struct TestCase {
+    const char* name;
+    TestFn fn;
+};
+
+inline std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct Registrar {
+    Registrar(const char* name, TestFn fn) { Registry().push_back(TestCase{ name, fn }); }
+};
+
+inline void Fail(const char* file, int line, const std::string& what) {
+    ++Failures();
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, what.c_str());
+}
+
+// Renders a checked value for the failure message
+inline std::string Show(const std::string& value) { return "\"" + value + "\""; }
+inline std::string Show(const char* value) { return "\"" + std::string(value) + "\""; }
+inline std::string Show(const ArgView& value) { return "\"" + value.str() + "\""; }
+inline std::string Show(bool value) { return value ? "true" : "false"; }
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, std::string>::type Show(const T& value) { return std::to_string(value); }
+template<typename T>
+typename std::enable_if<std::is_enum<T>::value, std::string>::type Show(const T& value) { return std::to_string(static_cast<long long>(value)); }
+
+// Owns an argv built from strings, the program name first
+struct Argv {
+    std::vector<std::string> storage;
+    std::vector<char*> pointers;
+
+    Argv(std::initializer_list<const char*> args) {
+        storage.push_back("arghand-tests");
+        for (const char* arg : args) storage.push_back(arg);
+        for (auto& s : storage) pointers.push_back(&s[0]);
+        pointers.push_back(nullptr);
+    }
+    int argc() const { return static_cast<int>(storage.size()); }
+    char** argv() { return pointers.data(); }
+};
+
+// Owns views of an argument list without the program name, for the ArgViewList overloads
+struct Args {
+    std::vector<ArgView> views;
+
+    Args(std::initializer_list<const char*> args) {
+        for (const char* arg : args) views.push_back(ArgView(arg));
+    }
+    operator ArgViewList() const { return ArgViewList(views.data(), views.size()); }
+};
+
+// Writes a scratch file in the working directory, the build directory under ctest
+inline std::string WriteFile(const std::string& name, const std::string& content) {
+    std::string path = "arghand-test-" + name;
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file) {
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::fclose(file);
+    }
+    return path;
+}
+
+} // namespace check
+
+#define TEST(name) \
+    static void name(); \
+    static check::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) check::Fail(__FILE__, __LINE__, "CHECK(" #condition ")"); } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const auto& actual_ = (actual); \
+        const auto& expected_ = (expected); \
+        if (!(actual_ == expected_)) { \
+            check::Fail(__FILE__, __LINE__, "CHECK_EQ(" #actual ", " #expected "): " + check::Show(actual_) + " != " + check::Show(expected_)); \
+        } \
+    } while (0)
+
+#endif // ARGHAND_TESTS_CHECK_H
@@ -1,44 +1,17 @@
-#include <Arghand.h>
+// Runs the behaviour tests of the Test*.cpp files.
+// Usage: arghand-tests [<test name>]
+#include "Check.h"
+#include <cstring>
 
 int main(int argc, char* argv[]) {
-    Arghand handler;
-    std::vector<CmdOption> options = {
-        CMD_OPTION("h", "help",     HelpOptionDefault,      "",           "Display help information"),
-        CMD_OPTION("v", "",  VersionOptionDefault,   "",           "Display version information"),
-        CMD_OPTION("o", "output",   InputDefault,           "output.txt", "Specify output file"),
-        CMD_OPTION("l", "list",     ListInputDefault,       "a,b",           "Specify a list of values (comma-separated)"),
-    };
-    handler.SetCmdOptions(options);
-    handler.SetSeparator(',');
-    handler.SetParserOptions(
-        (ParserOptions::DefaultOptions |
-        ParserOptions::VersionDisplayFooter )
-//        & ~ParserOptions::HelpDisplayHeader
-    );
-
-    handler.SetApplicationName("Arghand-test_app");
-    handler.SetHelpHeader("Arghand - A simple command line argument handler.");
-    handler.SetHelpFooter("\nMaintained at https://github.com/Antonako1/Arghand.");
-    handler.SetLicense("Licensed under the BSD-2-Clause License.");
-    handler.SetVersion(handler.VersionNumToString(1, 0, 0));
-    handler.SetVersionFooter("Maintained at https://github.com/Antonako1/Arghand.");
-    
-    Arghand::ParseResult res = handler.parse(argc, argv);
-    if(res == Arghand::ParseResult::Error){
-        std::cerr << "Error parsing command line arguments." << std::endl;
-        return 1;
-    }
-    
-    if(handler["o"]){
-        std::cout << "Output file specified: " << handler.GetValue("o") << std::endl;
-    } else if(handler["list"]){
-        std::vector<std::string> listValues = handler.GetValues("l");
-        std::cout << "List values specified: ";
-        for (const auto& value : listValues) {
-            std::cout << value << ", ";
-        }
-        std::cout << std::endl;
+    size_t run = 0;
+    for (const check::TestCase& test : check::Registry()) {
+        if (argc > 1 && std::strcmp(argv[1], test.name) != 0) continue;
+        int before = check::Failures();
+        test.fn();
+        ++run;
+        if (check::Failures() != before) std::fprintf(stderr, "FAILED %s\n", test.name);
     }
-    
-    return 0;
-}
\ No newline at end of file
+    std::printf("%zu tests, %d failed checks\n", run, check::Failures());
+    return check::Failures() == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// Environment and config file fallbacks, their precedence, and the config snapshot
+#include "Check.h"
+#include <cstdlib>
+
+using check::Argv;
+
+static void SetVariable(const char* name, const char* value) {
+#if defined(_WIN32)
+    _putenv_s(name, value ? value : "");
+#else
+    if (value) setenv(name, value, 1);
+    else unsetenv(name);
+#endif
+}
+
+static std::vector<CmdOption> BoundOptions() {
+    return {
+        CMD_OPTION_BOUND("o", "output", InputDefault, "default.txt", "Output file", "ARGHAND_TEST_OUTPUT", "paths.output"),
+        CMD_OPTION_BOUND("j", "jobs",   InputDefault, "1",           "Jobs",        "ARGHAND_TEST_JOBS",   "jobs"),
+        CMD_OPTION_BOUND("m", "mode",   InputDefault, "fast",        "Mode",        "",                    "mode"),
+        CMD_OPTION("v", "verbose", NoInputDefault, "", "Verbose output"),
+    };
+}
+
+TEST(ConfigFilesParseSectionsAndQuotes) {
+    Arghand::Config config;
+    config.Parse(ArgView("# comment\ntop = 1\n[paths]\n  output = \"a b.txt\"  \n; other comment\nempty =\ntop = 2\n[]\ntop=3\n"));
+    ArgView value;
+    CHECK(config.Find("paths.output", value));
+    CHECK_EQ(value, ArgView("a b.txt"));
+    CHECK(config.Find("paths.empty", value));
+    CHECK_EQ(value, ArgView(""));
+    CHECK(config.Find("top", value));
+    CHECK_EQ(value, ArgView("3"));
+    CHECK(config.Find("paths.top", value));
+    CHECK_EQ(value, ArgView("2"));
+    CHECK(!config.Find("output", value));
+}
+
+TEST(CommandLineBeatsEnvironmentBeatsConfigBeatsDefault) {
+    std::string path = check::WriteFile("precedence.ini", "jobs = 8\nmode = safe\n[paths]\noutput = config.txt\n");
+    SetVariable("ARGHAND_TEST_OUTPUT", "env.txt");
+    SetVariable("ARGHAND_TEST_JOBS", nullptr);
+
+    Arghand handler;
+    handler.SetCmdOptions(BoundOptions());
+    CHECK(handler.LoadConfig(path));
+    Argv args({ "-m", "cli" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("mode"), "cli");
+    CHECK_EQ(handler.GetSource("mode"), Arghand::ValueSource::CommandLine);
+    CHECK_EQ(handler.GetValue("output"), "env.txt");
+    CHECK_EQ(handler.GetSource("output"), Arghand::ValueSource::Environment);
+    CHECK_EQ(handler.GetValue("jobs"), "8");
+    CHECK_EQ(handler.GetSource("jobs"), Arghand::ValueSource::ConfigFile);
+    CHECK_EQ(handler.GetValue("verbose"), "");
+    CHECK_EQ(handler.GetSource("verbose"), Arghand::ValueSource::Default);
+
+    // Fallbacks are read when the spec is built, so the environment change needs a rebuild
+    SetVariable("ARGHAND_TEST_OUTPUT", nullptr);
+    handler.SetCmdOptions(BoundOptions());
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("output"), "config.txt");
+    CHECK_EQ(handler.GetSource("output"), Arghand::ValueSource::ConfigFile);
+}
+
+TEST(BindingsCanBeSetAfterTheOptions) {
+    SetVariable("ARGHAND_TEST_VERBOSE", "yes");
+    Arghand handler;
+    handler.SetCmdOptions(BoundOptions());
+    CHECK(handler.SetEnvironmentVariable("verbose", "ARGHAND_TEST_VERBOSE"));
+    CHECK(!handler.SetEnvironmentVariable("missing", "ARGHAND_TEST_VERBOSE"));
+    Argv args({});
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("verbose"), "yes");
+    CHECK_EQ(handler.GetSource("verbose"), Arghand::ValueSource::Environment);
+
+    CHECK(handler.SetEnvironmentVariable("v", ""));
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetSource("verbose"), Arghand::ValueSource::Default);
+    SetVariable("ARGHAND_TEST_VERBOSE", nullptr);
+}
+
+TEST(ManyBindingsAreSetAtOnce) {
+    std::string path = check::WriteFile("bindings.ini", "[generated]\nkey-7 = from-config\n");
+    SetVariable("ARGHAND_TEST_GENERATED_3", "from-env");
+    std::vector<CmdOption> options;
+    std::vector<Arghand::Binding> variables;
+    std::vector<Arghand::Binding> keys;
+    for (int i = 0; i < 500; ++i) {
+        std::string n = std::to_string(i);
+        options.push_back(CMD_OPTION("", "option-" + n, InputDefault, "default", "Generated"));
+        variables.push_back(Arghand::Binding("option-" + n, "ARGHAND_TEST_GENERATED_" + n));
+        keys.push_back(Arghand::Binding("option-" + n, "generated.key-" + n));
+    }
+    Arghand handler;
+    handler.SetCmdOptions(options);
+    CHECK(handler.LoadConfig(path));
+    std::shared_ptr<const Arghand::Spec> before = handler.GetSpec();
+    CHECK(handler.SetEnvironmentVariables(variables));
+    CHECK(handler.SetConfigKeys(keys));
+    CHECK_EQ(handler.GetCmdOptions()[499].environment, "ARGHAND_TEST_GENERATED_499");
+    CHECK(handler.GetSpec() != before);
+
+    Argv args({});
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("option-3"), "from-env");
+    CHECK_EQ(handler.GetValue("option-7"), "from-config");
+    CHECK_EQ(handler.GetValue("option-8"), "default");
+
+    // One unknown name binds nothing
+    std::shared_ptr<const Arghand::Spec> bound = handler.GetSpec();
+    CHECK(!handler.SetConfigKeys({ Arghand::Binding("option-1", ""), Arghand::Binding("nope", "x") }));
+    CHECK(handler.GetSpec() == bound);
+    CHECK_EQ(handler.GetCmdOptions()[1].configKey, "generated.key-1");
+    SetVariable("ARGHAND_TEST_GENERATED_3", nullptr);
+}
+
+TEST(MissingConfigFileKeepsThePreviousOne) {
+    std::string path = check::WriteFile("keep.ini", "mode = kept\n");
+    Arghand handler;
+    handler.SetCmdOptions(BoundOptions());
+    CHECK(handler.LoadConfig(path));
+    CHECK(!handler.LoadConfig("arghand-test-no-such.ini"));
+    CHECK(handler.GetConfig() != nullptr);
+    Argv args({});
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("mode"), "kept");
+}
+
+TEST(SnapshotServesLaterLoads) {
+    std::string path = check::WriteFile("snap.ini", "[a]\nx = 1\ny = two words\n");
+    std::string snapshot = "arghand-test-snap.ini.cache";
+    std::remove(snapshot.c_str());
+
+    Arghand::Config first;
+    CHECK(first.Load(path, snapshot));
+    CHECK(!first.FromSnapshot());
+    Arghand::Config second;
+    CHECK(second.Load(path, snapshot));
+    CHECK(second.FromSnapshot());
+    CHECK_EQ(second.size(), 2u);
+    ArgView value;
+    CHECK(second.Find("a.y", value));
+    CHECK_EQ(value, ArgView("two words"));
+
+    // A corrupt snapshot is ignored and rewritten
+    check::WriteFile("snap.ini.cache", "garbage");
+    Arghand::Config third;
+    CHECK(third.Load(path, snapshot));
+    CHECK(!third.FromSnapshot());
+    CHECK(third.Find("a.x", value));
+    CHECK_EQ(value, ArgView("1"));
+
+    // An entry count that wraps the size check is corrupt too
+    std::FILE* file = std::fopen(snapshot.c_str(), "r+b");
+    CHECK(file != nullptr);
+    if (file) {
+        uint64_t count = 0;
+        std::fseek(file, 24, SEEK_SET); // magic, version, mtime and source size come first
+        CHECK_EQ(std::fread(&count, sizeof(count), 1, file), 1u);
+        count += 1ull << 60;
+        std::fseek(file, 24, SEEK_SET);
+        std::fwrite(&count, sizeof(count), 1, file);
+        std::fclose(file);
+    }
+    Arghand::Config fourth;
+    CHECK(fourth.Load(path, snapshot));
+    CHECK(!fourth.FromSnapshot());
+    CHECK(fourth.Find("a.y", value));
+    CHECK_EQ(value, ArgView("two words"));
+}
@@ -0,0 +1,235 @@
+// Value conversion: integers, doubles, booleans, durations, sizes and whole lists
+#include "Check.h"
+#include <cmath>
+#include <limits>
+
+typedef Arghand::ConvertResult CR;
+
+TEST(IntegersCheckRangeAndSign) {
+    int32_t i32 = 7;
+    CHECK_EQ(Arghand::Convert(ArgView("-2147483648"), i32), CR::Success);
+    CHECK_EQ(i32, std::numeric_limits<int32_t>::min());
+    CHECK_EQ(Arghand::Convert(ArgView("2147483648"), i32), CR::OutOfRange);
+    CHECK_EQ(i32, std::numeric_limits<int32_t>::min());
+
+    uint8_t u8 = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("+255"), u8), CR::Success);
+    CHECK_EQ(u8, 255);
+    CHECK_EQ(Arghand::Convert(ArgView("256"), u8), CR::OutOfRange);
+    CHECK_EQ(Arghand::Convert(ArgView("-1"), u8), CR::OutOfRange);
+    CHECK_EQ(Arghand::Convert(ArgView("-0"), u8), CR::Success);
+    CHECK_EQ(u8, 0);
+
+    uint64_t u64 = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("18446744073709551615"), u64), CR::Success);
+    CHECK_EQ(u64, std::numeric_limits<uint64_t>::max());
+    CHECK_EQ(Arghand::Convert(ArgView("18446744073709551616"), u64), CR::OutOfRange);
+    int64_t i64 = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("-9223372036854775808"), i64), CR::Success);
+    CHECK_EQ(i64, std::numeric_limits<int64_t>::min());
+    CHECK_EQ(Arghand::Convert(ArgView("9223372036854775808"), i64), CR::OutOfRange);
+}
+
+TEST(IntegersRejectAnythingButDigits) {
+    int value = 42;
+    CHECK_EQ(Arghand::Convert(ArgView(""), value), CR::Empty);
+    CHECK_EQ(Arghand::Convert(ArgView("-"), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView(" 1"), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("1 "), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("0x10"), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("1.0"), value), CR::Invalid);
+    CHECK_EQ(value, 42);
+
+    Arghand::ConvertResult error = CR::Success;
+    CHECK_EQ(Arghand::ToInteger("12a", &error), 0);
+    CHECK_EQ(error, CR::Invalid);
+    CHECK_EQ(Arghand::ToInteger("-12", &error), -12);
+    CHECK_EQ(error, CR::Success);
+}
+
+TEST(DoublesParseExactly) {
+    double value = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("1.5"), value), CR::Success);
+    CHECK_EQ(value, 1.5);
+    CHECK_EQ(Arghand::Convert(ArgView("-0.1"), value), CR::Success);
+    CHECK_EQ(value, -0.1);
+    CHECK_EQ(Arghand::Convert(ArgView("2.5e-3"), value), CR::Success);
+    CHECK_EQ(value, 2.5e-3);
+    CHECK_EQ(Arghand::Convert(ArgView(".5"), value), CR::Success);
+    CHECK_EQ(value, 0.5);
+    CHECK_EQ(Arghand::Convert(ArgView("7."), value), CR::Success);
+    CHECK_EQ(value, 7.0);
+    CHECK_EQ(Arghand::Convert(ArgView("1E10"), value), CR::Success);
+    CHECK_EQ(value, 1e10);
+    CHECK_EQ(Arghand::Convert(ArgView("-0"), value), CR::Success);
+    CHECK(value == 0 && std::signbit(value));
+}
+
+TEST(DoublesOutsideTheFastPathRoundCorrectly) {
+    double value = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("3.141592653589793238"), value), CR::Success);
+    CHECK_EQ(value, 3.141592653589793238);
+    CHECK_EQ(Arghand::Convert(ArgView("1.7976931348623157e308"), value), CR::Success);
+    CHECK_EQ(value, std::numeric_limits<double>::max());
+    CHECK_EQ(Arghand::Convert(ArgView("4.9406564584124654e-324"), value), CR::Success);
+    CHECK_EQ(value, std::numeric_limits<double>::denorm_min());
+    CHECK_EQ(Arghand::Convert(ArgView("2.2250738585072014e-308"), value), CR::Success);
+    CHECK_EQ(value, std::numeric_limits<double>::min());
+    CHECK_EQ(Arghand::Convert(ArgView("1e400"), value), CR::OutOfRange);
+    CHECK_EQ(Arghand::Convert(ArgView("1.7976931348623159e308"), value), CR::OutOfRange);
+}
+
+TEST(DoublesRoundHalfwayCasesToEven) {
+    double value = 0;
+    // 2^53 + 1 is halfway between two doubles and goes to the even one, any further digit goes up
+    CHECK_EQ(Arghand::Convert(ArgView("9007199254740993"), value), CR::Success);
+    CHECK_EQ(value, 9007199254740992.0);
+    CHECK_EQ(Arghand::Convert(ArgView("9007199254740993.000000000000000000000000000001"), value), CR::Success);
+    CHECK_EQ(value, 9007199254740994.0);
+    CHECK_EQ(Arghand::Convert(ArgView("9007199254740995"), value), CR::Success);
+    CHECK_EQ(value, 9007199254740996.0);
+
+    // More digits than the buffer keeps still decide the rounding
+    std::string digits = "9007199254740993." + std::string(1000, '0') + "1";
+    CHECK_EQ(Arghand::Convert(ArgView(digits), value), CR::Success);
+    CHECK_EQ(value, 9007199254740994.0);
+    digits = "0." + std::string(400, '0') + "1e400";
+    CHECK_EQ(Arghand::Convert(ArgView(digits), value), CR::Success);
+    CHECK_EQ(value, 0.1);
+}
+
+TEST(DoublesTooSmallBecomeZero) {
+    double value = 1;
+    CHECK_EQ(Arghand::Convert(ArgView("2.4703282292062327e-324"), value), CR::Success);
+    CHECK_EQ(value, 0.0);
+    CHECK_EQ(Arghand::Convert(ArgView("2.4703282292062328e-324"), value), CR::Success);
+    CHECK_EQ(value, std::numeric_limits<double>::denorm_min());
+    CHECK_EQ(Arghand::Convert(ArgView("-1e-400"), value), CR::Success);
+    CHECK(value == 0 && std::signbit(value));
+}
+
+TEST(DoublesAcceptInfinityAndNan) {
+    double value = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("inf"), value), CR::Success);
+    CHECK(std::isinf(value) && value > 0);
+    CHECK_EQ(Arghand::Convert(ArgView("-Infinity"), value), CR::Success);
+    CHECK(std::isinf(value) && value < 0);
+    CHECK_EQ(Arghand::Convert(ArgView("NaN"), value), CR::Success);
+    CHECK(std::isnan(value));
+}
+
+TEST(DoublesRejectMalformedValues) {
+    double value = 3;
+    CHECK_EQ(Arghand::Convert(ArgView(""), value), CR::Empty);
+    CHECK_EQ(Arghand::Convert(ArgView("."), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("1e"), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("1,5"), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("infinit"), value), CR::Invalid);
+    CHECK_EQ(Arghand::Convert(ArgView("0x1p3"), value), CR::Invalid);
+    CHECK_EQ(value, 3.0);
+
+    float single = 0;
+    CHECK_EQ(Arghand::Convert(ArgView("0.25"), single), CR::Success);
+    CHECK_EQ(single, 0.25f);
+    CHECK_EQ(Arghand::Convert(ArgView("1e39"), single), CR::OutOfRange);
+}
+
+TEST(BooleansAcceptBothSpellings) {
+    bool value = false;
+    CHECK_EQ(Arghand::Convert(ArgView("YES"), value), CR::Success);
+    CHECK(value);
+    CHECK_EQ(Arghand::Convert(ArgView("off"), value), CR::Success);
+    CHECK(!value);
+    CHECK_EQ(Arghand::Convert(ArgView("1"), value), CR::Success);
+    CHECK(value);
+    CHECK_EQ(Arghand::Convert(ArgView("maybe"), value), CR::Invalid);
+    CHECK(value);
+    CHECK(Arghand::ToBoolean("True"));
+    CHECK(!Arghand::ToBoolean("2"));
+}
+
+TEST(DurationsCombineUnits) {
+    std::chrono::milliseconds ms(0);
+    CHECK_EQ(Arghand::ToDuration(ArgView("1h30m"), ms), CR::Success);
+    CHECK_EQ(ms.count(), 5400000);
+    CHECK_EQ(Arghand::ToDuration(ArgView("1.5s"), ms), CR::Success);
+    CHECK_EQ(ms.count(), 1500);
+    CHECK_EQ(Arghand::ToDuration(ArgView("-10ms"), ms), CR::Success);
+    CHECK_EQ(ms.count(), -10);
+    CHECK_EQ(Arghand::ToDuration(ArgView("0"), ms), CR::Success);
+    CHECK_EQ(ms.count(), 0);
+    std::chrono::seconds s(5);
+    CHECK_EQ(Arghand::ToDuration(ArgView("999ms"), s), CR::Success);
+    CHECK_EQ(s.count(), 0);
+
+    CHECK_EQ(Arghand::ToDuration(ArgView("10"), ms), CR::Invalid);
+    CHECK_EQ(Arghand::ToDuration(ArgView("10x"), ms), CR::Invalid);
+    CHECK_EQ(Arghand::ToDuration(ArgView(""), ms), CR::Empty);
+    CHECK_EQ(Arghand::ToDuration(ArgView("300000000h"), ms), CR::OutOfRange);
+}
+
+TEST(SizesUseBinaryAndDecimalUnits) {
+    uint64_t bytes = 0;
+    CHECK_EQ(Arghand::ToSize(ArgView("512"), bytes), CR::Success);
+    CHECK_EQ(bytes, 512u);
+    CHECK_EQ(Arghand::ToSize(ArgView("64K"), bytes), CR::Success);
+    CHECK_EQ(bytes, 65536u);
+    CHECK_EQ(Arghand::ToSize(ArgView("4GiB"), bytes), CR::Success);
+    CHECK_EQ(bytes, 4ull << 30);
+    CHECK_EQ(Arghand::ToSize(ArgView("2kb"), bytes), CR::Success);
+    CHECK_EQ(bytes, 2000u);
+    CHECK_EQ(Arghand::ToSize(ArgView("1.5M"), bytes), CR::Success);
+    CHECK_EQ(bytes, 1572864u);
+    CHECK_EQ(Arghand::ToSize(ArgView("100B"), bytes), CR::Success);
+    CHECK_EQ(bytes, 100u);
+
+    // Fractions are exact even where a double would lose the low digits
+    CHECK_EQ(Arghand::ToSize(ArgView("1.3EiB"), bytes), CR::Success);
+    CHECK_EQ(bytes, 1498797955988901068u);
+    CHECK_EQ(Arghand::ToSize(ArgView("0.123456789012345678T"), bytes), CR::Success);
+    CHECK_EQ(bytes, 135742175046u);
+    CHECK_EQ(Arghand::ToSize(ArgView("15.999999999999999999E"), bytes), CR::Success);
+    CHECK_EQ(bytes, 18446744073709551614u);
+
+    CHECK_EQ(Arghand::ToSize(ArgView("16E"), bytes), CR::OutOfRange);
+    CHECK_EQ(Arghand::ToSize(ArgView("1Q"), bytes), CR::Invalid);
+    CHECK_EQ(Arghand::ToSize(ArgView("-1K"), bytes), CR::Invalid);
+    CHECK_EQ(bytes, 18446744073709551614u);
+}
+
+TEST(WholeListsConvertInOnePass) {
+    std::vector<int64_t> integers;
+    CHECK_EQ(Arghand::ToIntegers(ArgSplitView(ArgView("1,-2,30"), ','), integers), CR::Success);
+    CHECK_EQ(integers.size(), 3u);
+    if (integers.size() == 3) CHECK_EQ(integers[1], -2);
+
+    integers.clear();
+    CHECK_EQ(Arghand::ToIntegers(ArgSplitView(ArgView("4,,5"), ','), integers), CR::Empty);
+    CHECK_EQ(integers.size(), 1u);
+    integers.clear();
+    CHECK_EQ(Arghand::ToIntegers(ArgSplitView(ArgView(""), ','), integers), CR::Success);
+    CHECK(integers.empty());
+
+    // Several values are split in turn, empty ones included
+    ArgView values[] = { ArgView("1,2"), ArgView(""), ArgView("3") };
+    ArgSplitView several(ArgViewList(values, 3), ',');
+    CHECK_EQ(several.size(), 4u);
+    std::vector<std::string> elements;
+    for (const ArgView& item : several) elements.push_back(item.str());
+    CHECK_EQ(elements.size(), 4u);
+    if (elements.size() == 4) {
+        CHECK_EQ(elements[1], "2");
+        CHECK_EQ(elements[2], "");
+        CHECK_EQ(elements[3], "3");
+    }
+    ArgView numbers[] = { ArgView("1,2"), ArgView("-3") };
+    integers.clear();
+    CHECK_EQ(Arghand::ToIntegers(ArgSplitView(ArgViewList(numbers, 2), ','), integers), CR::Success);
+    CHECK_EQ(integers.size(), 3u);
+    if (integers.size() == 3) CHECK_EQ(integers[2], -3);
+
+    std::vector<double> doubles;
+    CHECK_EQ(Arghand::ToDoubles(ArgSplitView(ArgView("0.5|1e2|x"), '|'), doubles), CR::Invalid);
+    CHECK_EQ(doubles.size(), 2u);
+    if (doubles.size() == 2) CHECK_EQ(doubles[1], 100.0);
+}
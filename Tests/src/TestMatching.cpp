@@ -0,0 +1,229 @@
+// Abbreviations, suggestions, subcommands, typed options, diagnostics, streams, sessions and memory
+#include "Check.h"
+
+using check::Argv;
+using check::Args;
+
+static std::vector<CmdOption> ToolOptions() {
+    return {
+        CMD_OPTION("h", "help",        HelpOptionDefault, "",    "Display help information"),
+        CMD_OPTION("o", "output",      InputDefault,      "",    "Output file"),
+        CMD_OPTION("",  "output-dir",  InputDefault,      "",    "Output directory"),
+        CMD_OPTION("v", "verbose",     NoInputDefault,    "",    "Verbose output"),
+        CMD_OPTION("l", "list",        ListInputDefault,  "",    "List of values"),
+        CMD_OPTION_TYPED("j", "jobs",  InputDefault | QSTU64(CmdOptionFlags::IsInteger), "4",    "Jobs",  "1..64"),
+        CMD_OPTION_TYPED("m", "mode",  InputDefault | QSTU64(CmdOptionFlags::IsEnum),    "fast", "Mode",  "fast|safe|off"),
+        CMD_OPTION_TYPED("r", "ratio", InputDefault | QSTU64(CmdOptionFlags::IsDouble),  "0.5",  "Ratio", ""),
+        CMD_OPTION_TYPED("",  "ports", ListInputDefault | QSTU64(CmdOptionFlags::IsInteger), "80,443", "Ports", ""),
+    };
+}
+
+TEST(AbbreviationsResolveUniquePrefixes) {
+    const Arghand::Spec spec(ToolOptions(), ParserOptions::DefaultOptions | ParserOptions::AllowAbbreviations);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "--verb", "--output-d", "dir" }), result), Arghand::ParseResult::Success);
+    CHECK(result["verbose"]);
+    CHECK_EQ(result.GetValue("output-dir"), "dir");
+
+    // An exact name wins over the longer names it prefixes
+    CHECK_EQ(spec.parse(Args({ "--output", "file" }), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValue("output"), "file");
+
+    result.CollectDiagnostics(2);
+    CHECK_EQ(spec.parse(Args({ "--out", "x" }), result), Arghand::ParseResult::Error);
+    CHECK_EQ(result.GetDiagnostics().size(), 1u);
+    if (!result.GetDiagnostics().empty()) CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::AmbiguousOption);
+
+    // Without the option prefixes are unknown
+    const Arghand::Spec exact(ToolOptions());
+    Arghand::Result other;
+    other.SetQuiet(true);
+    CHECK_EQ(exact.parse(Args({ "--verb" }), other), Arghand::ParseResult::Error);
+}
+
+TEST(UnknownOptionsSuggestTheClosestName) {
+    const Arghand::Spec spec(ToolOptions());
+    Arghand::Result result;
+    std::vector<std::string> messages;
+    result.SetDiagnosticCallback([&](const Arghand::Diagnostic& diagnostic) {
+        CHECK_EQ(diagnostic.code, Arghand::DiagnosticCode::UnknownOption);
+        CHECK_EQ(diagnostic.index, 1u);
+        CHECK_EQ(diagnostic.option, -1);
+        messages.push_back(spec.FormatDiagnostic(diagnostic));
+    });
+    CHECK_EQ(spec.parse(Args({ "-v", "--verbsoe" }), result), Arghand::ParseResult::Error);
+    CHECK_EQ(messages.size(), 1u);
+    if (!messages.empty()) {
+        CHECK(messages[0].find("--verbsoe") != std::string::npos);
+        CHECK(messages[0].find("--verbose") != std::string::npos);
+    }
+}
+
+TEST(TypedOptionsConvertOnce) {
+    const Arghand::Spec spec(ToolOptions());
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "-j", "16", "--mode", "off", "--ports", "1,2,3" }), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.Get<int>("jobs"), 16);
+    CHECK_EQ(result.Get<int>("mode"), 2);
+    CHECK_EQ(result.Get<double>("ratio"), 0.5);
+    std::vector<int> ports;
+    for (int port : result.GetList<int>("ports")) ports.push_back(port);
+    CHECK_EQ(ports.size(), 3u);
+    if (ports.size() == 3) CHECK_EQ(ports[2], 3);
+
+    CHECK_EQ(spec.parse(Args({}), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.Get<int>("jobs"), 4);
+    ports.clear();
+    for (int port : result.GetList<int>("ports")) ports.push_back(port);
+    CHECK_EQ(ports.size(), 2u);
+}
+
+TEST(TypedOptionsRejectBadValues) {
+    const Arghand::Spec spec(ToolOptions());
+    Arghand::Result result;
+    result.CollectDiagnostics(4);
+    CHECK_EQ(spec.parse(Args({ "-j", "65" }), result), Arghand::ParseResult::Error);
+    CHECK_EQ(result.GetDiagnostics().size(), 1u);
+    if (!result.GetDiagnostics().empty()) {
+        CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::ValueOutOfRange);
+        CHECK_EQ(result.GetDiagnostics()[0].option, spec.GetOptionId("jobs"));
+    }
+    CHECK_EQ(spec.parse(Args({ "-m", "slow" }), result), Arghand::ParseResult::Error);
+    if (!result.GetDiagnostics().empty()) CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::InvalidValue);
+    CHECK_EQ(spec.parse(Args({ "--ports", "1,x" }), result), Arghand::ParseResult::Error);
+    if (!result.GetDiagnostics().empty()) {
+        CHECK_EQ(result.GetDiagnostics()[0].token, ArgView("x"));
+        CHECK_EQ(result.GetDiagnostics()[0].index, 1u);
+    }
+}
+
+TEST(SubcommandsTakeTheRestOfTheArguments) {
+    int built = 0;
+    Arghand handler;
+    handler.SetCmdOptions(ToolOptions());
+    handler.AddSubcommand("add", "Add files", [&](Arghand& command) {
+        ++built;
+        command.SetCmdOptions({ CMD_OPTION("f", "force", NoInputDefault, "", "Force") });
+    });
+    handler.AddSubcommand("remove", "Remove files", [&](Arghand& command) {
+        ++built;
+        command.SetCmdOptions({ CMD_OPTION("r", "recursive", NoInputDefault, "", "Recursive") });
+    });
+    CHECK_EQ(built, 0);
+
+    Argv args({ "-v", "add", "-f", "file" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(built, 1);
+    CHECK(handler["verbose"]);
+    CHECK_EQ(handler.GetSubcommandName(), "add");
+    Arghand* command = handler.GetSubcommand();
+    CHECK(command != nullptr);
+    if (command) {
+        CHECK((*command)["force"]);
+        CHECK_EQ(command->GetPositionalViews().size(), 1u);
+    }
+
+    // The subcommand handler is built once and options after the name belong to it
+    Argv again({ "add", "-v" });
+    handler.SetQuiet(true);
+    CHECK_EQ(handler.parse(again.argc(), again.argv()), Arghand::ParseResult::Error);
+    CHECK_EQ(built, 1);
+
+    Argv none({ "file" });
+    CHECK_EQ(handler.parse(none.argc(), none.argv()), Arghand::ParseResult::Success);
+    CHECK(handler.GetSubcommand() == nullptr);
+    CHECK_EQ(handler.GetSubcommandName(), "");
+}
+
+TEST(StreamsRunHandlersAsTokensArrive) {
+    const Arghand::Spec spec(ToolOptions());
+    Arghand::Stream stream(spec);
+    std::vector<std::string> seen;
+    stream.SetHandler("output", [&](Arghand::OptionId, ArgViewList values) { seen.push_back("output=" + values[0].str()); });
+    stream.SetVisitor([&](Arghand::OptionId id, ArgViewList values) { seen.push_back(std::to_string(id) + ":" + std::to_string(values.size())); });
+    stream.SetPositionalHandler([&](const ArgView& arg) { seen.push_back("file=" + arg.str()); });
+
+    CHECK_EQ(stream.Feed(ArgView("-o")), Arghand::ParseResult::Success);
+    CHECK(seen.empty());
+    const char* rest[] = { "out", "a", "-l", "x,y" };
+    CHECK_EQ(stream.Feed(rest, rest + 4), Arghand::ParseResult::Success);
+    CHECK_EQ(stream.Finish(), Arghand::ParseResult::Success);
+    CHECK_EQ(seen.size(), 3u);
+    if (seen.size() == 3) {
+        CHECK_EQ(seen[0], "output=out");
+        CHECK_EQ(seen[1], "file=a");
+        CHECK_EQ(seen[2], std::to_string(spec.GetOptionId("list")) + ":2");
+    }
+
+    stream.SetQuiet(true);
+    CHECK_EQ(stream.Feed(ArgView("--nope")), Arghand::ParseResult::Error);
+    CHECK_EQ(stream.Feed(ArgView("-v")), Arghand::ParseResult::Error);
+    CHECK_EQ(stream.Finish(), Arghand::ParseResult::Error);
+    CHECK_EQ(stream.Feed(ArgView("-o")), Arghand::ParseResult::Success);
+    CHECK_EQ(stream.Finish(), Arghand::ParseResult::MissingValue);
+}
+
+TEST(SessionsFollowEditsAndComplete) {
+    const Arghand::Spec spec(ToolOptions());
+    Arghand::Session session(spec);
+    session.SetLine(ArgView("-o out --mode"));
+    CHECK_EQ(session.size(), 3u);
+    CHECK_EQ(session.GetToken(0).kind, Arghand::TokenKind::Option);
+    CHECK_EQ(session.GetToken(1).kind, Arghand::TokenKind::Value);
+    CHECK_EQ(session.GetStatus(), Arghand::ParseResult::Success);
+
+    std::vector<Arghand::Session::Completion> candidates;
+    session.SetLine(ArgView("-o out --mode "));
+    size_t offset = session.Complete(session.GetLine().size(), candidates);
+    CHECK_EQ(offset, session.GetLine().size());
+    CHECK_EQ(candidates.size(), 3u);
+    if (candidates.size() == 3) CHECK_EQ(candidates[0].str(), "fast");
+
+    session.SetLine(ArgView("--outp"));
+    CHECK_EQ(session.Complete(6, candidates), 0u);
+    CHECK_EQ(candidates.size(), 2u);
+    if (candidates.size() == 2) {
+        CHECK_EQ(candidates[0].str(), "--output");
+        CHECK_EQ(candidates[1].str(), "--output-dir");
+    }
+
+    session.SetLine(ArgView("-v --nope"));
+    CHECK_EQ(session.GetStatus(), Arghand::ParseResult::Error);
+    Arghand::Diagnostic diagnostic{};
+    CHECK(session.GetDiagnostic(diagnostic));
+    CHECK_EQ(diagnostic.index, 1u);
+    session.Edit(3, 6, ArgView("-j 2"));
+    CHECK_EQ(session.GetLine(), "-v -j 2");
+    CHECK_EQ(session.GetStatus(), Arghand::ParseResult::Success);
+}
+
+TEST(ParsingIntoATooSmallBufferFails) {
+    const Arghand::Spec spec(ToolOptions());
+    Args args({ "-o", "out", "-l", "a,b,c", "file", "--ports", "1,2" });
+    size_t needed = spec.RequiredMemory(args);
+    CHECK(needed > 0);
+
+    std::vector<char> storage(needed);
+    Arghand::MonotonicBuffer fits(storage.data(), storage.size());
+    Arghand::Result result;
+    result.SetMemory(&fits);
+    CHECK_EQ(spec.parse(args, result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValueView("output"), ArgView("out"));
+    CHECK_EQ(result.GetValuesView("list").size(), 3u);
+    CHECK_EQ(result.GetPositionalViews().size(), 1u);
+
+    char tiny[16];
+    Arghand::MonotonicBuffer small(tiny, sizeof(tiny));
+    Arghand::Result starved;
+    starved.SetMemory(&small);
+    starved.CollectDiagnostics(1);
+    CHECK_EQ(spec.parse(args, starved), Arghand::ParseResult::Error);
+    CHECK_EQ(starved.GetDiagnostics().size(), 1u);
+    if (!starved.GetDiagnostics().empty()) CHECK_EQ(starved.GetDiagnostics()[0].code, Arghand::DiagnosticCode::MemoryExhausted);
+    CHECK(!starved["output"]);
+
+    // The same result parses again once it has enough memory
+    starved.SetMemory(&fits);
+    CHECK_EQ(spec.parse(args, starved), Arghand::ParseResult::Success);
+    CHECK(starved["output"]);
+}
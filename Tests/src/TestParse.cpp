@@ -0,0 +1,314 @@
+// Option lookup, case folding, option styles, parse modes and the query table
+#include "Check.h"
+
+using check::Argv;
+using check::Args;
+
+static std::vector<CmdOption> FileOptions() {
+    return {
+        CMD_OPTION("h", "help",     HelpOptionDefault,  "",        "Display help information"),
+        CMD_OPTION("v", "verbose",  NoInputDefault,     "",        "Verbose output"),
+        CMD_OPTION("o", "output",   InputDefault,       "out.txt", "Output file"),
+        CMD_OPTION("l", "list",     ListInputDefault,   "a,b",     "List of values"),
+        CMD_OPTION("n", "name",     InputDefault,       "",        "Name without a default"),
+    };
+}
+
+TEST(ShortAndLongNamesResolveToOneOption) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    Argv args({ "-o", "x.txt", "--verbose" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK(handler["o"]);
+    CHECK(handler["output"]);
+    CHECK(handler["v"]);
+    CHECK(!handler["list"]);
+    CHECK_EQ(handler.GetValue("output"), "x.txt");
+    CHECK_EQ(handler.GetValue("o"), "x.txt");
+    CHECK_EQ(handler.GetOptionId("o"), handler.GetOptionId("output"));
+    CHECK_EQ(handler.GetOptionId("missing"), -1);
+}
+
+TEST(DefaultsApplyToOptionsNotGiven) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    Argv args({});
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK(!handler["output"]);
+    CHECK_EQ(handler.GetValue("output"), "out.txt");
+    CHECK_EQ(handler.GetValues("list").size(), 2u);
+    CHECK_EQ(handler.GetValues("list")[1], "b");
+    CHECK_EQ(handler.GetValue("name"), "");
+    CHECK_EQ(handler.GetValue("no-such-option"), "");
+    CHECK(handler.GetValues("no-such-option").empty());
+}
+
+TEST(FirstOccurrenceWins) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    Argv args({ "-o", "first", "--output", "second" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("output"), "first");
+}
+
+TEST(UnknownOptionAndMissingValueFail) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    handler.SetQuiet(true);
+    Argv unknown({ "--outptu", "x" });
+    CHECK_EQ(handler.parse(unknown.argc(), unknown.argv()), Arghand::ParseResult::Error);
+    Argv missing({ "--name" });
+    CHECK_EQ(handler.parse(missing.argc(), missing.argv()), Arghand::ParseResult::MissingValue);
+    // An option value that looks like an option does not count, the default stands in
+    Argv defaulted({ "--output", "-v" });
+    CHECK_EQ(handler.parse(defaulted.argc(), defaulted.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("output"), "out.txt");
+    CHECK(handler["v"]);
+}
+
+TEST(HelpAndVersionStopTheParse) {
+    Arghand handler;
+    std::string printed;
+    handler.SetOutput(Arghand::Output::ToString(printed));
+    handler.SetCmdOptions({ CMD_OPTION("h", "help", HelpOptionDefault, "", "Help"), CMD_OPTION("V", "version", VersionOptionDefault, "", "Version") });
+    handler.SetVersion("1.2.3");
+    Argv help({ "--help" });
+    CHECK_EQ(handler.parse(help.argc(), help.argv()), Arghand::ParseResult::SuccessWithHelp);
+    CHECK(printed.find("--help") != std::string::npos);
+    printed.clear();
+    Argv version({ "-V" });
+    CHECK_EQ(handler.parse(version.argc(), version.argv()), Arghand::ParseResult::SuccessWithVersion);
+    CHECK(printed.find("1.2.3") != std::string::npos);
+}
+
+TEST(IgnoreCaseFoldsAsciiNames) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    handler.SetParserOptions(ParserOptions::DefaultOptions | ParserOptions::IgnoreCase);
+    Argv args({ "--OUTPUT", "x", "-V" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("output"), "x");
+    CHECK(handler["verbose"]);
+
+    // Without folding the same names are unknown
+    handler.SetParserOptions(ParserOptions::DefaultOptions);
+    handler.SetQuiet(true);
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Error);
+}
+
+TEST(WindowsStyleUsesSlashPrefix) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    handler.SetParserOptions(ParserOptions::StyleWindows);
+    Argv args({ "/output", "x", "/v" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("output"), "x");
+    CHECK(handler["verbose"]);
+}
+
+TEST(ManyOptionsAreFoundByHash) {
+    std::vector<CmdOption> options;
+    for (int i = 0; i < 2000; ++i) {
+        std::string n = std::to_string(i);
+        options.push_back(CMD_OPTION("s" + n, "option-" + n, InputDefault, "", "Generated"));
+    }
+    const Arghand::Spec spec(options);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "--option-1999", "a", "-s0", "b", "--option-1000", "c" }), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValueView("option-1999"), ArgView("a"));
+    CHECK_EQ(result.GetValueView("s0"), ArgView("b"));
+    CHECK_EQ(result.GetValueView(spec.GetOptionId("option-1000")), ArgView("c"));
+    CHECK(!result["option-5"]);
+}
+
+TEST(ListsSplitOnTheSeparator) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    handler.SetSeparator(';');
+    Argv args({ "--list", "x;y;;z" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    const std::vector<std::string>& values = handler.GetValues("list");
+    CHECK_EQ(values.size(), 4u);
+    CHECK_EQ(values[2], "");
+    CHECK_EQ(handler.GetValuesView("list").size(), 4u);
+    CHECK_EQ(handler.GetListView("list").size(), 4u);
+}
+
+TEST(LazyListsKeepTheValueWhole) {
+    const Arghand::Spec spec(FileOptions(), ParserOptions::DefaultOptions | ParserOptions::LazyLists);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "-l", "1,2,3" }), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValuesView("list").size(), 1u);
+    std::vector<std::string> split;
+    for (ArgView item : result.GetListView("list")) split.push_back(item.str());
+    CHECK_EQ(split.size(), 3u);
+    CHECK_EQ(split[2], "3");
+}
+
+TEST(ZeroCopyViewsPointIntoArgv) {
+    Arghand handler;
+    handler.SetCmdOptions(FileOptions());
+    handler.SetParserOptions(ParserOptions::DefaultOptions | ParserOptions::ZeroCopy);
+    Argv args({ "-o", "x.txt", "-l", "p,q" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    ArgView output = handler.GetValueView("output");
+    CHECK_EQ(output, ArgView("x.txt"));
+    CHECK(output.data == args.argv()[2]);
+    CHECK_EQ(handler.GetValuesView("list")[1], ArgView("q"));
+    CHECK(handler.GetValuesView("list")[1].data == args.argv()[4] + 2);
+    CHECK_EQ(handler.GetValueView("name"), ArgView(""));
+}
+
+TEST(SpecIsSharedByManyResults) {
+    const Arghand::Spec spec(FileOptions());
+    Arghand::Result first;
+    Arghand::Result second;
+    CHECK_EQ(spec.parse(Args({ "-o", "1" }), first), Arghand::ParseResult::Success);
+    CHECK_EQ(spec.parse(Args({ "-v" }), second), Arghand::ParseResult::Success);
+    CHECK_EQ(first.GetValue("output"), "1");
+    CHECK(!first["verbose"]);
+    CHECK_EQ(second.GetValue("output"), "out.txt");
+    CHECK(second["verbose"]);
+
+    // A reused result forgets the previous parse
+    CHECK_EQ(spec.parse(Args({}), first), Arghand::ParseResult::Success);
+    CHECK(!first["output"]);
+    CHECK_EQ(first.GetValue("output"), "out.txt");
+
+    Arghand::Result copy = second;
+    CHECK(copy["verbose"]);
+}
+
+TEST(BatchParsesKeepInputOrder) {
+    const Arghand::Spec spec(FileOptions());
+    std::vector<Args> lines;
+    for (int i = 0; i < 600; ++i) lines.push_back(i % 3 ? Args({ "-o", "x", "file" }) : Args({ "--bad" }));
+    std::vector<ArgViewList> argvs(lines.begin(), lines.end());
+    std::vector<Arghand::BatchResult> results = spec.ParseBatch(argvs.data(), argvs.size(), 4);
+    CHECK_EQ(results.size(), lines.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i % 3) {
+            CHECK_EQ(results[i].result, Arghand::ParseResult::Success);
+            CHECK_EQ(results[i].options, 1u);
+            CHECK_EQ(results[i].positionals, 1u);
+        } else {
+            CHECK_EQ(results[i].result, Arghand::ParseResult::Error);
+            CHECK_EQ(results[i].diagnostic.code, Arghand::DiagnosticCode::UnknownOption);
+            CHECK_EQ(results[i].diagnostic.index, 0u);
+            CHECK(spec.FormatDiagnostic(results[i].diagnostic).find("--bad") != std::string::npos);
+        }
+    }
+
+    // Tokens of a command string point into it, unless the parse rewrote them
+    ArgView commands[] = { ArgView("-o x --bad"), ArgView("-o x '--bad'") };
+    results = spec.ParseBatch(commands, 2, 1);
+    CHECK(results[0].diagnostic.token.data == commands[0].data + 5);
+    CHECK(results[1].diagnostic.token.empty());
+    CHECK_EQ(results[1].diagnostic.index, 2u);
+}
+
+TEST(StaticTableParsesWithoutHeap) {
+    static constexpr StaticCmdOption table[] = {
+        STATIC_CMD_OPTION("o", "output", InputDefault, "out.txt", "Output file"),
+        STATIC_CMD_OPTION("v", "verbose", NoInputDefault, "", "Verbose"),
+    };
+    auto parser = Arghand::MakeStatic(table);
+    Argv args({ "--output", "x", "file" });
+    CHECK_EQ(parser.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(parser.Find("--output"), 0u);
+    CHECK_EQ(parser.Find("-v"), 1u);
+    CHECK(parser.Find("--nope") == parser.npos);
+    CHECK(parser.Has(0));
+    CHECK_EQ(std::string(parser.GetValue(0)), "x");
+    CHECK(!parser.Has(1));
+
+    Argv bad({ "-v", "--nope" });
+    CHECK_EQ(parser.parse(bad.argc(), bad.argv()), Arghand::ParseResult::Error);
+    CHECK_EQ(parser.GetErrorIndex(), 2);
+    CHECK_EQ(std::string(parser.GetValue(0)), "out.txt");
+}
+
+TEST(StaticIndexIsBuiltAtCompileTime) {
+    static constexpr StaticCmdOption table[] = {
+        STATIC_CMD_OPTION("o", "output", InputDefault, "out.txt", "Output file"),
+        STATIC_CMD_OPTION("", "Verbose", NoInputDefault, "", "Verbose"),
+        STATIC_CMD_OPTION("q", "output", NoInputDefault, "", "Shadowed by the first --output"),
+    };
+    static constexpr auto index = Arghand::MakeStaticIndex(table);
+    typedef Arghand::StaticIndex<3> Index;
+    static_assert(index.first[Index::Buckets] == 5, "every non-empty name is indexed");
+    static_assert(!index.named[2] && index.named[3], "names are numbered option ID << 1 | is long name");
+    static_assert(index.hashes[3] == Index::Hash("verbose"), "hashes fold ASCII case");
+
+    // The startup path lays the index out the same way
+    Index filled = Index::Fill(table);
+    CHECK(std::memcmp(filled.first, index.first, sizeof(index.first)) == 0);
+    CHECK(std::memcmp(filled.entries, index.entries, sizeof(index.entries)) == 0);
+    CHECK(std::memcmp(filled.hashes, index.hashes, sizeof(index.hashes)) == 0);
+
+    auto parser = Arghand::MakeStatic(table, index);
+    CHECK_EQ(parser.Find("--output"), 0u);
+    CHECK_EQ(parser.Find("-q"), 2u);
+    CHECK_EQ(parser.Find("--Verbose"), 1u);
+    CHECK(parser.Find("--verbose") == parser.npos);
+    CHECK(parser.Find("-output") == parser.npos);
+
+    auto folding = Arghand::MakeStatic(table, index, ParserOptions::StyleUnix | ParserOptions::IgnoreCase);
+    CHECK_EQ(folding.Find("--VERBOSE"), 1u);
+
+    // One prefix for both kinds of names: table order decides
+    auto windows = Arghand::MakeStatic(table, index, ParserOptions::StyleWindows);
+    CHECK_EQ(windows.Find("/o"), 0u);
+    CHECK_EQ(windows.Find("/output"), 0u);
+    CHECK(windows.Find("--output") == windows.npos);
+}
+
+TEST(StaticHelpAlignsLikeTheHelpText) {
+    static constexpr StaticCmdOption table[] = {
+        STATIC_CMD_OPTION("o", "output", InputDefault, "out.txt", "Output file"),
+        STATIC_CMD_OPTION("", "verbose-logging", NoInputDefault, "", "Verbose"),
+    };
+    std::string text;
+    Arghand::MakeStatic(table).PrintHelp(Arghand::Output::ToString(text));
+    CHECK_EQ(text, "-o, --output             Output file | Default value: out.txt\n"
+                   "    --verbose-logging    Verbose\n");
+
+    Arghand handler;
+    handler.SetParserOptions(ParserOptions::StyleUnix);
+    handler.SetCmdOptions({ CMD_OPTION("o", "output", InputDefault, "out.txt", "Output file"),
+                            CMD_OPTION("", "verbose-logging", NoInputDefault, "", "Verbose") });
+    CHECK(handler.GetHelpText().find(text) != std::string::npos);
+}
+
+TEST(HelpTextListsEveryOption) {
+    Arghand handler;
+    handler.SetApplicationName("tool");
+    handler.SetCmdOptions(FileOptions());
+    const std::string& text = handler.GetHelpText();
+    CHECK(text.find("Usage:") != std::string::npos);
+    CHECK(text.find("-o, --output") != std::string::npos);
+    CHECK(text.find("Default value: out.txt") != std::string::npos);
+    // Cached until the next Set* call
+    CHECK(&handler.GetHelpText() == &text);
+    handler.SetHelpFooter("footer-text");
+    CHECK(handler.GetHelpText().find("footer-text") != std::string::npos);
+}
+
+TEST(ZeroCopyKeepsOwningAccessorsForDefaults) {
+    const Arghand::Spec spec(FileOptions(), ParserOptions::DefaultOptions | ParserOptions::ZeroCopy);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "-o", "x.txt" }), result), Arghand::ParseResult::Success);
+    // Options not given still have their owning defaults
+    CHECK_EQ(result.GetValue("name"), "");
+    CHECK_EQ(result.GetValues("list").size(), 2u);
+#ifdef NDEBUG
+    // A given option has no owning copy, which asserts in debug builds and reads as empty otherwise
+    CHECK_EQ(result.GetValue("output"), "");
+    CHECK(result.GetValues("output").empty());
+#endif
+    CHECK_EQ(result.GetValueView("output"), ArgView("x.txt"));
+
+    // The next parse that does not give the option relinks its default
+    CHECK_EQ(spec.parse(Args({}), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValue("output"), "out.txt");
+}
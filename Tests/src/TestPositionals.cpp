@@ -0,0 +1,205 @@
+// Positional arguments, "--" and positional slots
+#include "Check.h"
+
+using check::Argv;
+using check::Args;
+
+static const ParserOptions WithEndOfOptions = ParserOptions::DefaultOptions | ParserOptions::EndOfOptions;
+
+static std::vector<CmdOption> CopyOptions() {
+    return {
+        CMD_OPTION("v", "verbose", NoInputDefault,        "",     "Verbose output"),
+        CMD_OPTION("o", "output",  InputDefault,          "",     "Output file"),
+        CMD_OPTION("",  "source",  PositionalDefault,     "",     "Source file"),
+        CMD_OPTION("",  "mode",    QSTU64(CmdOptionFlags::IsPositional), "copy", "Mode, optional"),
+        CMD_OPTION("",  "files",   PositionalListDefault, "",     "More files"),
+    };
+}
+
+TEST(PositionalsKeepTheirOrder) {
+    const Arghand::Spec spec({ CMD_OPTION("v", "verbose", NoInputDefault, "", "Verbose output") });
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "a", "-v", "b", "c d", "" }), result), Arghand::ParseResult::Success);
+    ArgViewList rest = result.GetPositionalViews();
+    CHECK_EQ(rest.size(), 4u);
+    if (rest.size() == 4) {
+        CHECK_EQ(rest[0], ArgView("a"));
+        CHECK_EQ(rest[2], ArgView("c d"));
+        CHECK_EQ(rest[3], ArgView(""));
+    }
+}
+
+TEST(DoubleDashEndsTheOptions) {
+    const Arghand::Spec spec({ CMD_OPTION("v", "verbose", NoInputDefault, "", "Verbose output"),
+                               CMD_OPTION("o", "output", InputDefault, "", "Output file") }, WithEndOfOptions);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "-v", "--", "-o", "--", "x" }), result), Arghand::ParseResult::Success);
+    CHECK(result["verbose"]);
+    CHECK(!result["output"]);
+    ArgViewList rest = result.GetPositionalViews();
+    CHECK_EQ(rest.size(), 3u);
+    if (rest.size() == 3) {
+        CHECK_EQ(rest[0], ArgView("-o"));
+        CHECK_EQ(rest[1], ArgView("--"));
+    }
+
+    // "--" is no value for a pending option, like any other option
+    result.SetQuiet(true);
+    CHECK_EQ(spec.parse(Args({ "-o", "--", "x" }), result), Arghand::ParseResult::MissingValue);
+
+    // The parser option is opt-in, by default "--" is an unknown option
+    const Arghand::Spec plain({ CMD_OPTION("v", "verbose", NoInputDefault, "", "Verbose output") });
+    CHECK_EQ(plain.parse(Args({ "--", "-v" }), result), Arghand::ParseResult::Error);
+}
+
+TEST(SlotsTakePositionalsInOrder) {
+    Arghand handler;
+    handler.SetCmdOptions(CopyOptions());
+    Argv args({ "in.txt", "-v", "move" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK(handler["source"]);
+    CHECK_EQ(handler.GetValue("source"), "in.txt");
+    CHECK_EQ(handler.GetValueView("mode"), ArgView("move"));
+    CHECK(!handler["files"]);
+    CHECK_EQ(handler.GetPositionalViews().size(), 2u);
+
+    // An optional slot not given falls back to its default
+    Argv one({ "in.txt" });
+    CHECK_EQ(handler.parse(one.argc(), one.argv()), Arghand::ParseResult::Success);
+    CHECK(!handler["mode"]);
+    CHECK_EQ(handler.GetValue("mode"), "copy");
+}
+
+TEST(MissingAndUnexpectedPositionalsFail) {
+    const Arghand::Spec spec(CopyOptions());
+    Arghand::Result result;
+    result.CollectDiagnostics(2);
+    CHECK_EQ(spec.parse(Args({ "-v" }), result), Arghand::ParseResult::MissingValue);
+    CHECK_EQ(result.GetDiagnostics().size(), 1u);
+    if (!result.GetDiagnostics().empty()) {
+        CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::MissingPositional);
+        CHECK_EQ(result.GetDiagnostics()[0].option, spec.GetOptionId("source"));
+    }
+
+    const Arghand::Spec fixed({ CMD_OPTION("", "source", PositionalDefault, "", "Source file") });
+    CHECK_EQ(fixed.parse(Args({ "a", "b" }), result), Arghand::ParseResult::Error);
+    CHECK_EQ(result.GetDiagnostics().size(), 1u);
+    if (!result.GetDiagnostics().empty()) {
+        CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::UnexpectedPositional);
+        CHECK_EQ(result.GetDiagnostics()[0].token, ArgView("b"));
+        CHECK_EQ(result.GetDiagnostics()[0].index, 1u);
+    }
+}
+
+TEST(SlotsAreNotOptionNames) {
+    const Arghand::Spec spec(CopyOptions());
+    Arghand::Result result;
+    result.SetQuiet(true);
+    CHECK_EQ(spec.parse(Args({ "--source", "x" }), result), Arghand::ParseResult::Error);
+    Arghand handler;
+    handler.SetCmdOptions(CopyOptions());
+    CHECK(handler.GetHelpText().find("source") != std::string::npos);
+}
+
+TEST(TailViewsFollowTheSlots) {
+    const Arghand::Spec spec(CopyOptions(), WithEndOfOptions);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "in", "copy", "a", "--", "-b" }), result), Arghand::ParseResult::Success);
+    CHECK(result["files"]);
+    ArgViewList files = result.GetValuesView("files");
+    CHECK_EQ(files.size(), 2u);
+    if (files.size() == 2) {
+        CHECK_EQ(files[0], ArgView("a"));
+        CHECK_EQ(files[1], ArgView("-b"));
+    }
+}
+
+TEST(TailAnswersEveryAccessor) {
+    Arghand handler;
+    handler.SetParserOptions(WithEndOfOptions);
+    handler.SetCmdOptions(CopyOptions());
+    Argv args({ "in", "move", "a", "b,c", "--", "-d" });
+    CHECK_EQ(handler.parse(args.argc(), args.argv()), Arghand::ParseResult::Success);
+    CHECK_EQ(handler.GetValue("source"), "in");
+    CHECK_EQ(handler.GetValues("mode").size(), 1u);
+    CHECK(handler["files"]);
+    CHECK_EQ(handler.GetValue("files"), "a");
+    CHECK_EQ(handler.GetValueView("files"), ArgView("a"));
+    const std::vector<std::string>& values = handler.GetValues("files");
+    CHECK_EQ(values.size(), 3u);
+    if (values.size() == 3) {
+        CHECK_EQ(values[1], "b,c");
+        CHECK_EQ(values[2], "-d");
+    }
+    CHECK_EQ(handler.GetValuesView("files").size(), 3u);
+
+    // Every argument is one element of the list, separators inside it included
+    std::vector<std::string> list;
+    for (const ArgView& item : handler.GetListView("files")) list.push_back(item.str());
+    CHECK_EQ(list.size(), 3u);
+    if (list.size() == 3) {
+        CHECK_EQ(list[0], "a");
+        CHECK_EQ(list[1], "b,c");
+        CHECK_EQ(list[2], "-d");
+    }
+    CHECK_EQ(handler.GetListView("files").size(), 3u);
+
+    // Without tail arguments the tail falls back to its default
+    Argv none({ "in" });
+    CHECK_EQ(handler.parse(none.argc(), none.argv()), Arghand::ParseResult::Success);
+    CHECK(!handler["files"]);
+    CHECK_EQ(handler.GetValue("files"), "");
+}
+
+TEST(TypedTailConvertsEveryArgument) {
+    const Arghand::Spec spec({ CMD_OPTION("", "name", PositionalDefault, "", "Name"),
+                               CMD_OPTION("", "counts", PositionalListDefault | QSTU64(CmdOptionFlags::IsInteger), "", "Counts") },
+                             WithEndOfOptions);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "x", "1", "--", "-2", "30" }), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.Get<int>("counts"), 1);
+    Arghand::TypedList<int64_t> counts = result.GetList<int64_t>("counts");
+    CHECK_EQ(counts.size(), 3u);
+    if (counts.size() == 3) {
+        CHECK_EQ(counts[1], -2);
+        CHECK_EQ(counts[2], 30);
+    }
+    CHECK_EQ(result.GetValues("counts").size(), 3u);
+    std::vector<int64_t> integers;
+    CHECK_EQ(Arghand::ToIntegers(result.GetListView("counts"), integers), Arghand::ConvertResult::Success);
+    CHECK_EQ(integers.size(), 3u);
+    if (integers.size() == 3) CHECK_EQ(integers[1], -2);
+
+    result.CollectDiagnostics(1);
+    CHECK_EQ(spec.parse(Args({ "x", "1", "2", "x" }), result), Arghand::ParseResult::Error);
+    CHECK_EQ(result.GetDiagnostics().size(), 1u);
+    if (!result.GetDiagnostics().empty()) {
+        CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::InvalidValue);
+        CHECK_EQ(result.GetDiagnostics()[0].token, ArgView("x"));
+        CHECK_EQ(result.GetDiagnostics()[0].index, 3u);
+        CHECK_EQ(result.GetDiagnostics()[0].option, spec.GetOptionId("counts"));
+    }
+    CHECK_EQ(spec.parse(Args({ "x", "--", "1", "y" }), result), Arghand::ParseResult::Error);
+
+    // Streams check the tail like parse does
+    const char* tokens[] = { "x", "4", "z" };
+    Arghand::Stream stream(spec);
+    stream.SetQuiet(true);
+    CHECK_EQ(stream.Feed(tokens, tokens + 3), Arghand::ParseResult::Error);
+}
+
+TEST(ZeroCopyTailIsViewsOnly) {
+    const Arghand::Spec spec(CopyOptions(), ParserOptions::DefaultOptions | ParserOptions::ZeroCopy);
+    Arghand::Result result;
+    Args args({ "in", "copy", "a", "b" });
+    CHECK_EQ(spec.parse(args, result), Arghand::ParseResult::Success);
+    CHECK(result.GetValueView("files").data == args.views[2].data);
+    CHECK_EQ(result.GetValuesView("files").size(), 2u);
+    // The list walks the arguments themselves
+    ArgSplitView list = result.GetListView("files");
+    CHECK_EQ(list.size(), 2u);
+    ArgSplitView::iterator item = list.begin();
+    CHECK((*item).data == args.views[2].data);
+    CHECK((*++item).data == args.views[3].data);
+    CHECK(++item == list.end());
+}
@@ -0,0 +1,111 @@
+// Command strings with POSIX and Windows quoting, and @response files
+#include "Check.h"
+
+using check::Args;
+
+static std::vector<CmdOption> TokenOptions() {
+    return {
+        CMD_OPTION("o", "output",   InputDefault,       "",  "Output file"),
+        CMD_OPTION("v", "verbose",  NoInputDefault,     "",  "Verbose output"),
+        CMD_OPTION("l", "list",     ListInputDefault,   "",  "List of values"),
+    };
+}
+
+static std::vector<std::string> Positionals(const Arghand::Result& result) {
+    std::vector<std::string> out;
+    for (const ArgView& arg : result.GetPositionalViews()) out.push_back(arg.str());
+    return out;
+}
+
+TEST(PosixQuotingRules) {
+    const Arghand::Spec spec(TokenOptions());
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(ArgView("-o 'a b'  \"c \\\"d\\\"\" e\\ f 'g\\h' \"\" -v"), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValue("output"), "a b");
+    CHECK(result["verbose"]);
+    std::vector<std::string> rest = Positionals(result);
+    CHECK_EQ(rest.size(), 4u);
+    if (rest.size() == 4) {
+        CHECK_EQ(rest[0], "c \"d\"");
+        CHECK_EQ(rest[1], "e f");
+        CHECK_EQ(rest[2], "g\\h");
+        CHECK_EQ(rest[3], "");
+    }
+}
+
+TEST(WindowsQuotingRules) {
+    const Arghand::Spec spec(TokenOptions(), ParserOptions::StyleWindows);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(ArgView("/output \"C:\\Program Files\\x\" a\\b \"q\\\"uote\" 'single' c\\\\\"d e\""), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValue("output"), "C:\\Program Files\\x");
+    std::vector<std::string> rest = Positionals(result);
+    CHECK_EQ(rest.size(), 4u);
+    if (rest.size() == 4) {
+        CHECK_EQ(rest[0], "a\\b");
+        CHECK_EQ(rest[1], "q\"uote");
+        CHECK_EQ(rest[2], "'single'");
+        CHECK_EQ(rest[3], "c\\d e");
+    }
+}
+
+TEST(PlainTokensAreViewsIntoTheCommand) {
+    const Arghand::Spec spec(TokenOptions(), ParserOptions::DefaultOptions | ParserOptions::ZeroCopy);
+    Arghand::Result result;
+    std::string command = "  -o   out.bin\tfile\n";
+    CHECK_EQ(spec.parse(ArgView(command), result), Arghand::ParseResult::Success);
+    CHECK(result.GetValueView("output").data == command.data() + 7);
+    CHECK_EQ(result.GetPositionalViews().size(), 1u);
+    CHECK_EQ(result.GetPositionalViews()[0], ArgView("file"));
+}
+
+TEST(ResponseFilesExpandInPlace) {
+    std::string inner = check::WriteFile("inner.rsp", "-v\n'quoted file'\n");
+    std::string outer = check::WriteFile("outer.rsp", "-o from-file @" + inner + " after");
+    const Arghand::Spec spec(TokenOptions(), ParserOptions::DefaultOptions | ParserOptions::ResponseFiles);
+    Arghand::Result result;
+    std::string arg = "@" + outer;
+    CHECK_EQ(spec.parse(Args({ "first", arg.c_str(), "last" }), result), Arghand::ParseResult::Success);
+    CHECK_EQ(result.GetValue("output"), "from-file");
+    CHECK(result["verbose"]);
+    std::vector<std::string> rest = Positionals(result);
+    CHECK_EQ(rest.size(), 4u);
+    if (rest.size() == 4) {
+        CHECK_EQ(rest[0], "first");
+        CHECK_EQ(rest[1], "quoted file");
+        CHECK_EQ(rest[2], "after");
+        CHECK_EQ(rest[3], "last");
+    }
+}
+
+TEST(ResponseFilesAreOffByDefault) {
+    std::string path = check::WriteFile("off.rsp", "-v");
+    const Arghand::Spec spec(TokenOptions());
+    Arghand::Result result;
+    std::string arg = "@" + path;
+    CHECK_EQ(spec.parse(Args({ arg.c_str() }), result), Arghand::ParseResult::Success);
+    CHECK(!result["verbose"]);
+    CHECK_EQ(Positionals(result).size(), 1u);
+}
+
+TEST(MissingResponseFileIsLiteral) {
+    const Arghand::Spec spec(TokenOptions(), ParserOptions::DefaultOptions | ParserOptions::ResponseFiles);
+    Arghand::Result result;
+    CHECK_EQ(spec.parse(Args({ "@arghand-test-does-not-exist" }), result), Arghand::ParseResult::Success);
+    std::vector<std::string> rest = Positionals(result);
+    CHECK_EQ(rest.size(), 1u);
+    if (!rest.empty()) CHECK_EQ(rest[0], "@arghand-test-does-not-exist");
+}
+
+TEST(ResponseFileCyclesStopAtTheDepthLimit) {
+    std::string path = check::WriteFile("cycle.rsp", "-v @arghand-test-cycle.rsp");
+    const Arghand::Spec spec(TokenOptions(), ParserOptions::DefaultOptions | ParserOptions::ResponseFiles);
+    Arghand::Result result;
+    result.CollectDiagnostics(4);
+    std::string arg = "@" + path;
+    CHECK_EQ(spec.parse(Args({ "x", arg.c_str() }), result), Arghand::ParseResult::Error);
+    CHECK_EQ(result.GetDiagnostics().size(), 1u);
+    if (!result.GetDiagnostics().empty()) {
+        CHECK_EQ(result.GetDiagnostics()[0].code, Arghand::DiagnosticCode::ResponseFileDepth);
+        CHECK_EQ(result.GetDiagnostics()[0].index, 1u);
+    }
+}
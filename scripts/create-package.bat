@@ -17,11 +17,13 @@ set _package=Arghand-%_version%
 rem Create package directory
 mkdir "%_package%"
 mkdir "%_package%\include"
+mkdir "%_package%\src"
 
 rem Copy files
 copy LICENSE "%_package%\LICENSE.txt"
 copy README.md "%_package%\README.md"
 copy Arghand\Include\*.h "%_package%\include\"
+copy Arghand\src\*.cpp "%_package%\src\"
 
 echo.
 echo Created package: %_package%
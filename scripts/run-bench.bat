@@ -0,0 +1,10 @@
+@echo off
+setlocal
+cd /d %~dp0
+cd ..\Tests
+if not exist build mkdir build
+cd build
+cmake ..
+cmake --build . --config Release
+call .\Release\arghand-bench.exe %*
+echo %ERRORLEVEL%